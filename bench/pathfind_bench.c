@@ -0,0 +1,1139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <raylib.h>
+#include <raymath.h>
+
+#include "collisions.h"
+#include "level_file.h"
+#include "level_geometry.h"
+#include "level_occupancy.h"
+#include "utils.h"
+
+#define BENCH_JOINT_SPACING 100.f
+#define BENCH_ROW_SPACING 300.f
+#define BENCH_SEED 1337
+#define BENCH_QUERY_COUNT 2000
+#define BENCH_HOT_POINT_COUNT 6
+#define BENCH_LANDMARK_COUNT 8
+#define BENCH_REPLAN_AGENT_COUNT 32
+#define BENCH_REPLAN_TOGGLE_COUNT 20
+#define BENCH_NEAREST_QUERY_COUNT 200
+#define BENCH_NEAREST_GOAL_COUNT 8
+#define BENCH_CHASE_QUERY_COUNT 200
+#define BENCH_CHASE_STEP_COUNT 16
+#define BENCH_CHASE_MAX_EXPANSIONS 256
+#define BENCH_CHASE_MAX_STRETCH 1.1f
+#define BENCH_PLAN_STEP_EXPANSIONS 256
+#define BENCH_KERNEL_POINT_COUNT 200
+#define BENCH_SNAP_NOISE 0.05f
+#define BENCH_MIN_DESTINATION_DISTANCE 2.25f
+#define BENCH_CROWD_COUNT 4000
+#define BENCH_CROWD_FRAMES 16
+#define BENCH_CROWD_STEP 5.f
+#define BENCH_CROWD_SEPARATION 10.f
+#define BENCH_RAY_COUNT 20000
+#define BENCH_RAY_LENGTH 1000.f
+#define BENCH_LEVEL_FILE_PATH "pathfind_bench.re2d"
+
+typedef struct {
+    const char *name;
+    int rows;
+    int columns;
+} Bench_Level_Desc;
+
+static const Bench_Level_Desc BENCH_LEVELS[] = {
+    { "small",  4,   64  },
+    { "medium", 16,  256 },
+    { "large",  64,  512 },
+};
+
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Connections bench_empty_connections(void) {
+    return (Connections){ .up = -1, .straight = -1, .down = -1, .fall = -1 };
+}
+
+// Builds a level out of `rows` horizontal runs of `columns` joints. Runs are
+// broken up by the occasional gap (with a fall into the row below) and
+// neighbouring rows are linked with slopes going up and down.
+static Geometry_Joint *bench_make_joints(int rows, int columns) {
+    Geometry_Joint *joints = malloc(rows * columns * sizeof(Geometry_Joint));
+
+    #define JOINT(_r, _c) (&joints[(_r) * columns + (_c)])
+    #define INDEX(_r, _c) ((_r) * columns + (_c))
+
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            Geometry_Joint *j = JOINT(r, c);
+            j->position = vec2(c * BENCH_JOINT_SPACING, r * BENCH_ROW_SPACING);
+            j->connections[JOINT_LEFT] = bench_empty_connections();
+            j->connections[JOINT_RIGHT] = bench_empty_connections();
+        }
+    }
+
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c + 1 < columns; ++c) {
+            Geometry_Joint *a = JOINT(r, c);
+            Geometry_Joint *b = JOINT(r, c + 1);
+
+            if (rand() % 12 == 0) {
+                if (r + 1 < rows) {
+                    a->connections[JOINT_RIGHT].fall = INDEX(r + 1, c);
+                }
+                continue;
+            }
+
+            a->connections[JOINT_RIGHT].straight = INDEX(r, c + 1);
+            b->connections[JOINT_LEFT].straight = INDEX(r, c);
+        }
+    }
+
+    for (int r = 0; r + 1 < rows; ++r) {
+        for (int c = 0; c + 1 < columns; ++c) {
+            if (rand() % 16 != 0) continue;
+
+            Geometry_Joint *top = JOINT(r, c);
+            Geometry_Joint *bottom = JOINT(r + 1, c + 1);
+            if (top->connections[JOINT_RIGHT].down != -1) continue;
+            if (bottom->connections[JOINT_LEFT].up != -1) continue;
+
+            top->connections[JOINT_RIGHT].down = INDEX(r + 1, c + 1);
+            bottom->connections[JOINT_LEFT].up = INDEX(r, c);
+        }
+    }
+
+    #undef JOINT
+    #undef INDEX
+
+    return joints;
+}
+
+// Picks a point half way along a random straight connection so it's
+// guaranteed to be found by `level_find_floor`.
+static Vector2 bench_random_point(Level_Geometry *level) {
+    for (;;) {
+        Geometry_Joint *j = &level->joints[rand() % level->num_joints];
+        int other = j->connections[JOINT_RIGHT].straight;
+        if (other == -1) continue;
+        return lerpv(j->position, level->joints[other].position, 0.5f);
+    }
+}
+
+static float bench_path_length(Vector2 start, Vec_Vector2 path) {
+    float length = 0.f;
+    Vector2 previous = start;
+    for (size_t i = path.count; i > 0; --i) {
+        length += Vector2Distance(previous, path.items[i - 1]);
+        previous = path.items[i - 1];
+    }
+    return length;
+}
+
+// Runs every query through plain A* on `level`. Fills `lengths` with the
+// path lengths if it's given, otherwise compares against `flat_lengths`.
+// Returns the time taken.
+static double bench_flat(Level_Geometry *level, const char *name, const char *label, Vector2 *starts, Vector2 *ends, float *lengths, float *flat_lengths) {
+    Pathfind_Query query = pathfind_query_make();
+    size_t paths_found = 0;
+    size_t expanded = 0;
+    double length_ratio = 0.0;
+    size_t length_ratio_count = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vec_Vector2 path = level_geometry_pathfind_with_query(level, &query, starts[i], ends[i]);
+        if (path.count != 0) ++paths_found;
+        expanded += query.nodes_expanded;
+
+        float length = bench_path_length(starts[i], path);
+        if (lengths) {
+            lengths[i] = length;
+        } else if (flat_lengths[i] > 0.f) {
+            length_ratio += length / flat_lengths[i];
+            ++length_ratio_count;
+        }
+        vec_free(&path);
+    }
+    double elapsed = bench_now() - begin;
+
+    printf("%-8s %-13s found=%-5zu expanded=%-9zu time=%8.3fms  %8.2f us/query  %10.0f nodes/s",
+        name,
+        label,
+        paths_found,
+        expanded,
+        elapsed * 1e3,
+        elapsed * 1e6 / BENCH_QUERY_COUNT,
+        expanded / elapsed
+    );
+    if (length_ratio_count) printf("  avg length vs flat=%.3f", length_ratio / length_ratio_count);
+    printf("\n");
+
+    pathfind_query_free(&query);
+    return elapsed;
+}
+
+// Runs every query through bidirectional A* on `level` and compares the
+// path lengths against `flat_lengths`. Returns the time taken.
+static double bench_bidirectional(Level_Geometry *level, const char *name, const char *label, Vector2 *starts, Vector2 *ends, float *flat_lengths) {
+    Pathfind_Query forward = pathfind_query_make();
+    Pathfind_Query backward = pathfind_query_make();
+    size_t paths_found = 0;
+    size_t expanded = 0;
+    double length_ratio = 0.0;
+    size_t length_ratio_count = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vec_Vector2 path = level_geometry_pathfind_bidirectional(level, &forward, &backward, starts[i], ends[i]);
+        if (path.count != 0) ++paths_found;
+        expanded += forward.nodes_expanded + backward.nodes_expanded;
+
+        if (flat_lengths[i] > 0.f) {
+            length_ratio += bench_path_length(starts[i], path) / flat_lengths[i];
+            ++length_ratio_count;
+        }
+        vec_free(&path);
+    }
+    double elapsed = bench_now() - begin;
+
+    printf("%-8s %-13s found=%-5zu expanded=%-9zu time=%8.3fms  %8.2f us/query  %10.0f nodes/s  avg length vs flat=%.3f\n",
+        name,
+        label,
+        paths_found,
+        expanded,
+        elapsed * 1e3,
+        elapsed * 1e6 / BENCH_QUERY_COUNT,
+        expanded / elapsed,
+        length_ratio_count ? length_ratio / length_ratio_count : 1.0
+    );
+
+    pathfind_query_free(&backward);
+    pathfind_query_free(&forward);
+    return elapsed;
+}
+
+static double bench_hierarchical(Level_Geometry *level, const char *name, Vector2 *starts, Vector2 *ends, float *flat_lengths) {
+    Hierarchy_Query query = hierarchy_query_make();
+    Vec_int joints = {0};
+    size_t paths_found = 0;
+    size_t expanded = 0;
+    double length_ratio = 0.0;
+    size_t length_ratio_count = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Floor start_floor = level_find_floor(level, starts[i]);
+        Floor end_floor = level_find_floor(level, ends[i]);
+        if (floor_contains_point(start_floor, ends[i])) {
+            ++paths_found;
+            continue;
+        }
+
+        int start_joints[2] = { start_floor.left - level->joints, start_floor.right - level->joints };
+        int end_joints[2] = { end_floor.left - level->joints, end_floor.right - level->joints };
+        bool found = pathfind_hierarchy_search_joints(level, &query, starts[i], start_joints, ends[i], end_joints, &joints);
+        expanded += query.nodes_expanded;
+        if (!found) continue;
+
+        ++paths_found;
+        Vec_Vector2 path = level_geometry_path_from_joints(level, starts[i], ends[i], joints.count, joints.items);
+        if (flat_lengths[i] > 0.f) {
+            length_ratio += bench_path_length(starts[i], path) / flat_lengths[i];
+            ++length_ratio_count;
+        }
+        vec_free(&path);
+    }
+    double elapsed = bench_now() - begin;
+
+    printf("%-8s hierarchical: found=%-5zu expanded=%-9zu time=%8.3fms  %8.2f us/query  avg length vs flat=%.3f\n",
+        name,
+        paths_found,
+        expanded,
+        elapsed * 1e3,
+        elapsed * 1e6 / BENCH_QUERY_COUNT,
+        length_ratio_count ? length_ratio / length_ratio_count : 1.0
+    );
+
+    vec_free(&joints);
+    hierarchy_query_free(&query);
+    return elapsed;
+}
+
+// The same queries for every agent profile. Lengths are compared with the
+// default profile, which is what the flat search finds.
+static void bench_profiles(Level_Geometry *level, const char *name, Vector2 *starts, Vector2 *ends, float *flat_lengths) {
+    static const char *labels[Pathfind_Profile_COUNT] = {
+        [Pathfind_Profile_DEFAULT] = "default",
+        [Pathfind_Profile_NO_FALLS] = "no falls",
+        [Pathfind_Profile_AVOIDS_SLOPES] = "avoids slopes",
+        [Pathfind_Profile_HAS_KEY] = "has key",
+    };
+
+    Pathfind_Query query = pathfind_query_make();
+
+    for (int profile = 0; profile < Pathfind_Profile_COUNT; ++profile) {
+        size_t paths_found = 0;
+        size_t expanded = 0;
+        double length_ratio = 0.0;
+        size_t length_ratio_count = 0;
+
+        double begin = bench_now();
+        for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+            Vec_Vector2 path = level_geometry_pathfind_with_profile(level, &query, starts[i], ends[i], profile);
+            expanded += query.nodes_expanded;
+            if (path.count != 0) {
+                ++paths_found;
+                if (flat_lengths[i] > 0.f) {
+                    length_ratio += bench_path_length(starts[i], path) / flat_lengths[i];
+                    ++length_ratio_count;
+                }
+            }
+            vec_free(&path);
+        }
+        double elapsed = bench_now() - begin;
+
+        printf("%-8s profile:      %-13s found=%-5zu expanded=%-9zu time=%8.3fms  avg length vs flat=%.3f\n",
+            name,
+            labels[profile],
+            paths_found,
+            expanded,
+            elapsed * 1e3,
+            length_ratio_count ? length_ratio / length_ratio_count : 1.0
+        );
+    }
+
+    pathfind_query_free(&query);
+}
+
+// Finds the floor under every query's start and end, which every search
+// does before it gets going.
+static void bench_find_floor(Level_Geometry *level, const char *name, Vector2 *starts, Vector2 *ends) {
+    size_t found = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        if (level_find_floor(level, starts[i]).left) ++found;
+        if (level_find_floor(level, ends[i]).left) ++found;
+    }
+    double elapsed = bench_now() - begin;
+
+    Level_Floor_Grid *grid = &level->floor_grid;
+    printf("%-8s find floor:   found=%-5zu cells=%dx%d time=%8.3fms  %8.2f us/lookup\n",
+        name,
+        found,
+        grid->num_columns,
+        grid->num_rows,
+        elapsed * 1e3,
+        elapsed * 1e6 / (2 * BENCH_QUERY_COUNT)
+    );
+}
+
+// The floor containment test on its own: every floor of the level tested
+// against a few points one `floor_contains_point` at a time, then through
+// the structure of arrays copy one floor and one lane at a time, and then
+// the grid lookups with and without the kernel. `mismatches` counts answers
+// that differ from testing one floor at a time.
+static void bench_floor_kernel(Level_Geometry *level, const char *name, Vector2 *starts) {
+    Level_Floor_Segments all = {0};
+    size_t num_floors = 0;
+    for (size_t i = 0; i < level->num_joints; ++i) {
+        Geometry_Joint *joint = &level->joints[i];
+        for (int side = 0; side < JOINT_COUNT; ++side) {
+            for (int kind = 0; kind < CONN_COUNT; ++kind) {
+                int other = joint->connections[side].connections[kind];
+                if (other == -1) continue;
+                level_floor_segments_append(&all, joint->position, level->joints[other].position, num_floors++);
+            }
+        }
+    }
+    level_floor_segments_pad(&all);
+
+    int *expected = malloc(BENCH_KERNEL_POINT_COUNT * sizeof(int));
+    size_t mismatches = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_KERNEL_POINT_COUNT; ++i) {
+        expected[i] = -1;
+        size_t index = 0;
+        for (size_t j = 0; j < level->num_joints && expected[i] == -1; ++j) {
+            Geometry_Joint *joint = &level->joints[j];
+            for (int side = 0; side < JOINT_COUNT && expected[i] == -1; ++side) {
+                for (int kind = 0; kind < CONN_COUNT; ++kind) {
+                    int other = joint->connections[side].connections[kind];
+                    if (other == -1) continue;
+                    if (floor_contains_point(floor_make(joint, &level->joints[other]), starts[i])) {
+                        expected[i] = index;
+                        break;
+                    }
+                    ++index;
+                }
+            }
+        }
+    }
+    double floors_elapsed = bench_now() - begin;
+
+    begin = bench_now();
+    for (int i = 0; i < BENCH_KERNEL_POINT_COUNT; ++i) {
+        int found = level_floor_segments_find_scalar(&all, 0, all.count, starts[i]);
+        if (found != expected[i]) ++mismatches;
+    }
+    double scalar_elapsed = bench_now() - begin;
+
+    begin = bench_now();
+    for (int i = 0; i < BENCH_KERNEL_POINT_COUNT; ++i) {
+        int found = level_floor_segments_find(&all, 0, all.count, starts[i]);
+        if (found != expected[i]) ++mismatches;
+    }
+    double lanes_elapsed = bench_now() - begin;
+
+    printf("%-8s floor scan:   floors=%-6zu floor_contains_point=%8.3fms  scalar=%8.3fms  lanes(%d)=%8.3fms  mismatches=%zu\n",
+        name,
+        num_floors,
+        floors_elapsed * 1e3,
+        scalar_elapsed * 1e3,
+        LEVEL_FLOOR_LANE_COUNT,
+        lanes_elapsed * 1e3,
+        mismatches
+    );
+
+    Level_Floor_Grid *grid = &level->floor_grid;
+    mismatches = 0;
+    size_t scalar_found = 0;
+
+    begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        int cell = level_floor_grid_cell(grid, starts[i]);
+        if (cell == -1) continue;
+        int found = level_floor_segments_find_scalar(&grid->floors, grid->cell_offsets[cell], grid->cell_offsets[cell + 1], starts[i]);
+        if (found != -1) ++scalar_found;
+    }
+    scalar_elapsed = bench_now() - begin;
+
+    Floor *floors = malloc(BENCH_QUERY_COUNT * sizeof(Floor));
+    begin = bench_now();
+    level_find_floors(level, BENCH_QUERY_COUNT, starts, floors);
+    lanes_elapsed = bench_now() - begin;
+
+    size_t lanes_found = 0;
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        if (floors[i].left) ++lanes_found;
+    }
+    if (lanes_found != scalar_found) ++mismatches;
+
+    printf("%-8s floor grid:   found=%-5zu scalar=%8.2f us/lookup  lanes(%d)=%8.2f us/lookup  mismatches=%zu\n",
+        name,
+        lanes_found,
+        scalar_elapsed * 1e6 / BENCH_QUERY_COUNT,
+        LEVEL_FLOOR_LANE_COUNT,
+        lanes_elapsed * 1e6 / BENCH_QUERY_COUNT,
+        mismatches
+    );
+
+    free(floors);
+    free(expected);
+    level_floor_segments_free(&all);
+}
+
+// Nudges every start off its floor by a little, like an enemy that's been
+// moving along it for a while, and snaps it back on.
+static void bench_snap(Level_Geometry *level, const char *name, Vector2 *starts) {
+    Vector2 *points = malloc(BENCH_QUERY_COUNT * sizeof(Vector2));
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        float dx = ((float)rand() / RAND_MAX * 2.f - 1.f) * BENCH_SNAP_NOISE;
+        float dy = ((float)rand() / RAND_MAX * 2.f - 1.f) * BENCH_SNAP_NOISE;
+        points[i] = Vector2Add(starts[i], vec2(dx, dy));
+    }
+
+    size_t exact = 0;
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Floor floor = level_find_floor(level, points[i]);
+        if (floor.left && floor_contains_point(floor, points[i])) ++exact;
+    }
+
+    size_t snapped = 0;
+    float worst = 0.f;
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Floor_Position position;
+        if (!level_snap_to_floor(level, points[i], LEVEL_FLOOR_SNAP_TOLERANCE, &position)) continue;
+        ++snapped;
+        worst = fmaxf(worst, Vector2Distance(level_floor_position_point(level, position), points[i]));
+    }
+    double elapsed = bench_now() - begin;
+
+    printf("%-8s snap:         on a floor=%-5zu snapped=%-5zu worst=%.3f time=%8.3fms  %8.2f us/snap\n",
+        name,
+        exact,
+        snapped,
+        worst,
+        elapsed * 1e3,
+        elapsed * 1e6 / BENCH_QUERY_COUNT
+    );
+
+    free(points);
+}
+
+// Random positions anywhere on the level, then ones a walker at each start
+// can actually reach. `off a floor` counts positions that didn't snap back
+// onto a floor and `too close` reachable ones nearer than
+// `BENCH_MIN_DESTINATION_DISTANCE`.
+static void bench_random_position(Level_Geometry *level, const char *name, Vector2 *starts) {
+    size_t off_floor = 0;
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vector2 position = level_geometry_random_position(level);
+        Floor_Position snapped;
+        if (!level_snap_to_floor(level, position, LEVEL_FLOOR_SNAP_TOLERANCE, &snapped)) ++off_floor;
+    }
+    double elapsed = bench_now() - begin;
+
+    size_t too_close = 0;
+    double reachable_begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vector2 position = level_geometry_random_reachable_position(level, starts[i], BENCH_MIN_DESTINATION_DISTANCE);
+        if (Vector2Distance(position, starts[i]) < BENCH_MIN_DESTINATION_DISTANCE) ++too_close;
+    }
+    double reachable_elapsed = bench_now() - reachable_begin;
+
+    printf("%-8s random:       off a floor=%-5zu too close=%-5zu time=%8.3fms  %8.2f us/position  %8.2f us/reachable\n",
+        name,
+        off_floor,
+        too_close,
+        (elapsed + reachable_elapsed) * 1e3,
+        elapsed * 1e6 / BENCH_QUERY_COUNT,
+        reachable_elapsed * 1e6 / BENCH_QUERY_COUNT
+    );
+}
+
+// A crowd milling about, finding everyone close enough to push apart every
+// frame, against checking every pair.
+static void bench_occupancy(Level_Geometry *level, const char *name) {
+    Floor_Position *crowd = malloc(BENCH_CROWD_COUNT * sizeof(Floor_Position));
+    Floor_Position *canonical = malloc(BENCH_CROWD_COUNT * sizeof(Floor_Position));
+    for (int i = 0; i < BENCH_CROWD_COUNT; ++i) {
+        Vector2 position = level_geometry_random_position(level);
+        level_snap_to_floor(level, position, LEVEL_FLOOR_SNAP_TOLERANCE, &crowd[i]);
+    }
+
+    Level_Occupancy occupancy = level_occupancy_make(level);
+    Vec_Level_Occupant_Pair pairs = {0};
+    size_t swept = 0;
+    size_t brute = 0;
+    double update_elapsed = 0.0;
+    double sweep_elapsed = 0.0;
+    double brute_elapsed = 0.0;
+
+    for (int frame = 0; frame < BENCH_CROWD_FRAMES; ++frame) {
+        for (int i = 0; i < BENCH_CROWD_COUNT; ++i) {
+            float dx = ((float)rand() / RAND_MAX * 2.f - 1.f) * BENCH_CROWD_STEP;
+            Floor_Movement movement = level_floor_walk(level, crowd[i], dx, Floor_Step_AHEAD);
+            if (!movement.falling) crowd[i] = movement.position;
+        }
+
+        double begin = bench_now();
+        for (int i = 0; i < BENCH_CROWD_COUNT; ++i) {
+            level_occupancy_update(&occupancy, level, Level_Occupant_ENEMY, i, crowd[i]);
+        }
+        update_elapsed += bench_now() - begin;
+
+        begin = bench_now();
+        vec_clear(&pairs);
+        level_occupancy_pairs(&occupancy, level, BENCH_CROWD_SEPARATION, &pairs);
+        swept += pairs.count;
+        sweep_elapsed += bench_now() - begin;
+
+        begin = bench_now();
+        for (int i = 0; i < BENCH_CROWD_COUNT; ++i) {
+            canonical[i] = level_floor_position_canonical(level, crowd[i]);
+        }
+        for (int i = 0; i < BENCH_CROWD_COUNT; ++i) {
+            float length = level_edge_length(level, canonical[i].edge);
+            for (int j = i + 1; j < BENCH_CROWD_COUNT; ++j) {
+                if (canonical[j].edge != canonical[i].edge) continue;
+                if (fabsf(canonical[j].t - canonical[i].t) * length <= BENCH_CROWD_SEPARATION) ++brute;
+            }
+        }
+        brute_elapsed += bench_now() - begin;
+    }
+
+    printf("%-8s crowd:        pairs=%-7zu all pairs=%-7zu update=%8.3fms sweep=%8.3fms all pairs=%8.3fms\n",
+        name,
+        swept,
+        brute,
+        update_elapsed * 1e3,
+        sweep_elapsed * 1e3,
+        brute_elapsed * 1e3
+    );
+
+    vec_free(&pairs);
+    level_occupancy_free(&occupancy);
+    free(crowd);
+    free(canonical);
+}
+
+// The first floor each ray crosses by checking every floor, to hold the grid
+// walk to.
+static float bench_raycast_brute(Level_Geometry *level, Vector2 from, Vector2 to) {
+    Vector2 delta = Vector2Subtract(to, from);
+    float best = INFINITY;
+
+    for (size_t edge = 0; edge < level->num_joints * JOINT_ALL_CONN_COUNT; ++edge) {
+        int other = level_edge_other(level, edge);
+        if (other == -1 || FLOOR_EDGE_KIND(edge) == CONN_FALL) continue;
+
+        Vector2 a = level->joints[FLOOR_EDGE_JOINT(edge)].position;
+        Vector2 along = Vector2Subtract(level->joints[other].position, a);
+        Vector2 offset = Vector2Subtract(a, from);
+        float denominator = delta.x * along.y - delta.y * along.x;
+        if (denominator == 0.f) continue;
+
+        float t = (offset.x * along.y - offset.y * along.x) / denominator;
+        float u = (offset.x * delta.y - offset.y * delta.x) / denominator;
+        if (t >= 0.f && t <= 1.f && u >= 0.f && u <= 1.f && t < best) best = t;
+    }
+
+    return best;
+}
+
+static void bench_raycast(Level_Geometry *level, const char *name) {
+    Vector2 *from = malloc(BENCH_RAY_COUNT * sizeof(Vector2));
+    Vector2 *to = malloc(BENCH_RAY_COUNT * sizeof(Vector2));
+    Collision *collisions = malloc(BENCH_RAY_COUNT * sizeof(Collision));
+
+    for (int i = 0; i < BENCH_RAY_COUNT; ++i) {
+        float angle = (float)rand() / RAND_MAX * 2.f * PI;
+        from[i] = Vector2Add(level_geometry_random_position(level), vec2(0.f, -BENCH_ROW_SPACING / 2.f));
+        to[i] = Vector2Add(from[i], Vector2Scale(vec2(cosf(angle), sinf(angle)), BENCH_RAY_LENGTH));
+    }
+
+    size_t hits = 0;
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_RAY_COUNT; ++i) {
+        collisions[i] = level_raycast(level, from[i], to[i]);
+        if (collisions[i].hit) ++hits;
+    }
+    double elapsed = bench_now() - begin;
+
+    begin = bench_now();
+    level_raycast_batch(level, BENCH_RAY_COUNT, from, to, collisions);
+    double batch_elapsed = bench_now() - begin;
+
+    // Only a handful are checked against every floor, it takes a while.
+    size_t mismatches = 0;
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        float t = bench_raycast_brute(level, from[i], to[i]);
+        float distance = t * Vector2Distance(from[i], to[i]);
+        if (collisions[i].hit != (t != INFINITY) || (collisions[i].hit && fabsf(collisions[i].distance - distance) > 1e-2f)) {
+            ++mismatches;
+        }
+    }
+
+    printf("%-8s raycast:      hits=%-6zu mismatches=%-3zu time=%8.3fms  %8.2f us/ray  batch=%8.3fms\n",
+        name,
+        hits,
+        mismatches,
+        elapsed * 1e3,
+        elapsed * 1e6 / BENCH_RAY_COUNT,
+        batch_elapsed * 1e3
+    );
+
+    free(from);
+    free(to);
+    free(collisions);
+}
+
+// Starting a level from scratch against mapping one that was written out.
+static void bench_level_file(const char *name, size_t num_joints, Geometry_Joint *joints) {
+    double begin = bench_now();
+    Level_Geometry built = level_geometry_make(num_joints, joints);
+    double build_elapsed = bench_now() - begin;
+
+    if (!level_file_save(BENCH_LEVEL_FILE_PATH, &built, NULL)) {
+        level_geometry_free(&built);
+        return;
+    }
+
+    begin = bench_now();
+    Level_File file;
+    if (!level_file_open(BENCH_LEVEL_FILE_PATH, &file)) {
+        level_geometry_free(&built);
+        return;
+    }
+    double open_elapsed = bench_now() - begin;
+    Level_Geometry loaded = level_file_geometry(&file, level_geometry_default_options());
+    double load_elapsed = bench_now() - begin;
+
+    printf("%-8s level file:   size=%zuKB build=%8.3fms open=%8.3fms open+indices=%8.3fms\n",
+        name,
+        file.size / 1024,
+        build_elapsed * 1e3,
+        open_elapsed * 1e3,
+        load_elapsed * 1e3
+    );
+
+    level_geometry_free(&loaded);
+    level_file_close(&file);
+    level_geometry_free(&built);
+    remove(BENCH_LEVEL_FILE_PATH);
+}
+
+// Every query heads for the same goal, once with A* per query and once by
+// following a single flow field.
+static void bench_flow_field(Level_Geometry *level, const char *name, Vector2 *starts) {
+    Vector2 goal = bench_random_point(level);
+    Pathfind_Query query = pathfind_query_make();
+    size_t astar_found = 0;
+    size_t astar_expanded = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vec_Vector2 path = level_geometry_pathfind_with_query(level, &query, starts[i], goal);
+        if (path.count != 0) ++astar_found;
+        astar_expanded += query.nodes_expanded;
+        vec_free(&path);
+    }
+    double astar_elapsed = bench_now() - begin;
+
+    // NOTE: Agents following the field already know where they are on
+    //       the floors, so snapping isn't part of the timing.
+    Floor_Position goal_position;
+    level_snap_to_floor(level, goal, LEVEL_FLOOR_SNAP_TOLERANCE, &goal_position);
+    Floor_Position *start_positions = malloc(BENCH_QUERY_COUNT * sizeof(Floor_Position));
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        level_snap_to_floor(level, starts[i], LEVEL_FLOOR_SNAP_TOLERANCE, &start_positions[i]);
+    }
+
+    Pathfind_Flow_Field field = pathfind_flow_field_make();
+    size_t field_found = 0;
+
+    begin = bench_now();
+    pathfind_flow_field_update(level, &field, goal_position);
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vec_Vector2 path = pathfind_flow_field_path(level, &field, start_positions[i]);
+        if (path.count != 0) ++field_found;
+        vec_free(&path);
+    }
+    double field_elapsed = bench_now() - begin;
+
+    printf("%-8s one goal:     a*: found=%-5zu expanded=%-9zu time=%8.3fms  flow field: found=%-5zu expanded=%-9zu time=%8.3fms\n",
+        name,
+        astar_found,
+        astar_expanded,
+        astar_elapsed * 1e3,
+        field_found,
+        field.query.nodes_expanded,
+        field_elapsed * 1e3
+    );
+
+    free(start_positions);
+    pathfind_flow_field_free(&field);
+    pathfind_query_free(&query);
+}
+
+// Every query looks for the closest of a few goals, once with a search per
+// goal and once with a single search towards all of them. `worse` counts
+// the times the single search settled on a longer path.
+static void bench_nearest(Level_Geometry *level, const char *name, Vector2 *starts) {
+    Vector2 goals[BENCH_NEAREST_GOAL_COUNT];
+    for (int i = 0; i < BENCH_NEAREST_GOAL_COUNT; ++i) {
+        goals[i] = bench_random_point(level);
+    }
+
+    Pathfind_Query query = pathfind_query_make();
+    float *each_lengths = malloc(BENCH_NEAREST_QUERY_COUNT * sizeof(float));
+    size_t each_found = 0;
+    size_t each_expanded = 0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_NEAREST_QUERY_COUNT; ++i) {
+        each_lengths[i] = INFINITY;
+        for (int g = 0; g < BENCH_NEAREST_GOAL_COUNT; ++g) {
+            Vec_Vector2 path = level_geometry_pathfind_with_query(level, &query, starts[i], goals[g]);
+            each_expanded += query.nodes_expanded;
+            if (path.count != 0) {
+                each_lengths[i] = fminf(each_lengths[i], bench_path_length(starts[i], path));
+            }
+            vec_free(&path);
+        }
+        if (each_lengths[i] != INFINITY) ++each_found;
+    }
+    double each_elapsed = bench_now() - begin;
+
+    size_t nearest_found = 0;
+    size_t nearest_expanded = 0;
+    size_t worse = 0;
+
+    begin = bench_now();
+    for (int i = 0; i < BENCH_NEAREST_QUERY_COUNT; ++i) {
+        int goal_index;
+        Vec_Vector2 path = level_geometry_pathfind_nearest_with_query(level, &query, starts[i], BENCH_NEAREST_GOAL_COUNT, goals, &goal_index);
+        nearest_expanded += query.nodes_expanded;
+        if (goal_index != -1) {
+            ++nearest_found;
+            if (bench_path_length(starts[i], path) > each_lengths[i] + 1e-2f) ++worse;
+        }
+        vec_free(&path);
+    }
+    double nearest_elapsed = bench_now() - begin;
+
+    printf("%-8s nearest of %d: each: found=%-5zu expanded=%-9zu time=%8.3fms  one search: found=%-5zu expanded=%-9zu time=%8.3fms  worse=%zu\n",
+        name,
+        BENCH_NEAREST_GOAL_COUNT,
+        each_found,
+        each_expanded,
+        each_elapsed * 1e3,
+        nearest_found,
+        nearest_expanded,
+        nearest_elapsed * 1e3,
+        worse
+    );
+
+    free(each_lengths);
+    pathfind_query_free(&query);
+}
+
+// A chaser stands still while its target walks right one floor at a time.
+// Every step the chaser's path is either searched for from scratch or
+// repaired, falling back to a full search when the repair gives up.
+static void bench_chase(Level_Geometry *level, const char *name, Vector2 *starts, Vector2 *ends) {
+    Pathfind_Query query = pathfind_query_make();
+    size_t steps = 0;
+    size_t full_expanded = 0;
+    size_t repaired = 0;
+    double full_elapsed = 0.0;
+    double repair_elapsed = 0.0;
+    double length_ratio = 0.0;
+
+    for (int i = 0; i < BENCH_CHASE_QUERY_COUNT; ++i) {
+        Vec_Vector2 path = level_geometry_pathfind(level, starts[i], ends[i]);
+        if (path.count == 0) {
+            vec_free(&path);
+            continue;
+        }
+        int target = path.count - 1;
+
+        Floor_Position from;
+        level_snap_to_floor(level, starts[i], LEVEL_FLOOR_SNAP_TOLERANCE, &from);
+        float stretch = level_geometry_path_stretch(level, from, path, target);
+
+        Floor floor = level_find_floor(level, ends[i]);
+        int joint = (floor.left->position.x > floor.right->position.x ? floor.left : floor.right) - level->joints;
+
+        for (int s = 0; s < BENCH_CHASE_STEP_COUNT; ++s) {
+            int next = level->joints[joint].connections[JOINT_RIGHT].straight;
+            if (next == -1) break;
+
+            Vector2 end = lerpv(level->joints[joint].position, level->joints[next].position, 0.5f);
+            joint = next;
+
+            double begin = bench_now();
+            Vec_Vector2 full = level_geometry_pathfind_with_query(level, &query, starts[i], end);
+            full_elapsed += bench_now() - begin;
+            full_expanded += query.nodes_expanded;
+            if (full.count == 0) {
+                vec_free(&full);
+                break;
+            }
+
+            begin = bench_now();
+            if (level_geometry_repair_path(level, from, &path, &target, end, BENCH_CHASE_MAX_EXPANSIONS, BENCH_CHASE_MAX_STRETCH * stretch, Pathfind_Profile_DEFAULT)) {
+                ++repaired;
+            } else {
+                vec_free(&path);
+                path = level_geometry_pathfind(level, starts[i], end);
+                target = path.count - 1;
+                stretch = level_geometry_path_stretch(level, from, path, target);
+            }
+            repair_elapsed += bench_now() - begin;
+
+            ++steps;
+            float full_length = bench_path_length(starts[i], full);
+            length_ratio += full_length > 0.f ? bench_path_length(starts[i], path) / full_length : 1.f;
+            vec_free(&full);
+        }
+
+        vec_free(&path);
+    }
+
+    printf("%-8s chase:        steps=%-5zu full: expanded=%-9zu time=%8.3fms  repair: repaired=%-5zu time=%8.3fms  avg length vs full=%.3f\n",
+        name,
+        steps,
+        full_expanded,
+        full_elapsed * 1e3,
+        repaired,
+        repair_elapsed * 1e3,
+        steps ? length_ratio / steps : 1.0
+    );
+
+    pathfind_query_free(&query);
+}
+
+// The same queries again, planned a few nodes at a time. What matters is
+// the longest stretch spent on a single call, which is what lands on one
+// frame.
+static void bench_budgeted(Level_Geometry *level, const char *name, Vector2 *starts, Vector2 *ends) {
+    Pathfind_Query query = pathfind_query_make();
+    double longest_query = 0.0;
+
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        double begin = bench_now();
+        Vec_Vector2 path = level_geometry_pathfind_with_query(level, &query, starts[i], ends[i]);
+        double elapsed = bench_now() - begin;
+        if (elapsed > longest_query) longest_query = elapsed;
+        vec_free(&path);
+    }
+
+    Pathfind_Plan plan = pathfind_plan_make();
+    size_t paths_found = 0;
+    size_t steps = 0;
+    double longest_step = 0.0;
+
+    double begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vec_Vector2 path = {0};
+        pathfind_plan_begin(&plan, starts[i], ends[i]);
+
+        Pathfind_Status status;
+        do {
+            double step_begin = bench_now();
+            status = level_geometry_plan_step(level, &plan, BENCH_PLAN_STEP_EXPANSIONS, 0.0, &path);
+            double elapsed = bench_now() - step_begin;
+            if (elapsed > longest_step) longest_step = elapsed;
+            ++steps;
+        } while (status == Pathfind_Status_IN_PROGRESS);
+
+        if (status == Pathfind_Status_FOUND) ++paths_found;
+        vec_free(&path);
+    }
+    double elapsed = bench_now() - begin;
+
+    printf("%-8s budgeted:     found=%-5zu steps=%-7zu time=%8.3fms  longest step=%7.3fms  longest query=%7.3fms\n",
+        name,
+        paths_found,
+        steps,
+        elapsed * 1e3,
+        longest_step * 1e3,
+        longest_query * 1e3
+    );
+
+    pathfind_plan_free(&plan);
+    pathfind_query_free(&query);
+}
+
+// A handful of agents hold paths while random straight connections get
+// locked and unlocked. After every toggle each agent replans, either from
+// scratch with A* or by repairing its D* Lite search.
+static void bench_replanning(Level_Geometry *level, const char *name, Vector2 *starts, Vector2 *ends) {
+    Pathfind_Replanner replanners[BENCH_REPLAN_AGENT_COUNT];
+    Pathfind_Query query = pathfind_query_make();
+    Vec_Vector2 path = {0};
+
+    for (int i = 0; i < BENCH_REPLAN_AGENT_COUNT; ++i) {
+        replanners[i] = pathfind_replanner_make(Pathfind_Profile_DEFAULT);
+        pathfind_replanner_plan(level, &replanners[i], starts[i], ends[i], &path);
+    }
+
+    size_t astar_expanded = 0;
+    size_t replan_expanded = 0;
+    size_t mismatches = 0;
+    double astar_elapsed = 0.0;
+    double replan_elapsed = 0.0;
+
+    for (int t = 0; t < BENCH_REPLAN_TOGGLE_COUNT; ++t) {
+        int joint;
+        do {
+            joint = rand() % level->num_joints;
+        } while (level->joints[joint].connections[JOINT_RIGHT].straight == -1);
+
+        bool locked = level->joints[joint].connections[JOINT_RIGHT].locked.straight;
+        level_geometry_set_locked(level, joint, JOINT_RIGHT, CONN_STRAIGHT, !locked);
+
+        for (int i = 0; i < BENCH_REPLAN_AGENT_COUNT; ++i) {
+            double begin = bench_now();
+            Vec_Vector2 astar_path = level_geometry_pathfind_with_query(level, &query, starts[i], ends[i]);
+            astar_elapsed += bench_now() - begin;
+            astar_expanded += query.nodes_expanded;
+
+            begin = bench_now();
+            pathfind_replanner_plan(level, &replanners[i], starts[i], ends[i], &path);
+            replan_elapsed += bench_now() - begin;
+            replan_expanded += replanners[i].nodes_expanded;
+
+            float astar_length = bench_path_length(starts[i], astar_path);
+            float replan_length = bench_path_length(starts[i], path);
+            if ((astar_path.count == 0) != (path.count == 0) || replan_length > astar_length + 1e-2f) {
+                ++mismatches;
+            }
+            vec_free(&astar_path);
+        }
+    }
+
+    int replans = BENCH_REPLAN_AGENT_COUNT * BENCH_REPLAN_TOGGLE_COUNT;
+    printf("%-8s replanning:   a*: expanded=%-9zu %8.2f us/replan  d* lite: expanded=%-9zu %8.2f us/replan  longer than a*=%zu\n",
+        name,
+        astar_expanded,
+        astar_elapsed * 1e6 / replans,
+        replan_expanded,
+        replan_elapsed * 1e6 / replans,
+        mismatches
+    );
+
+    for (int i = 0; i < BENCH_REPLAN_AGENT_COUNT; ++i) {
+        pathfind_replanner_free(&replanners[i]);
+    }
+    vec_free(&path);
+    pathfind_query_free(&query);
+}
+
+static void bench_level(const Bench_Level_Desc *desc) {
+    srand(BENCH_SEED);
+
+    size_t num_joints = desc->rows * desc->columns;
+    Geometry_Joint *joints = bench_make_joints(desc->rows, desc->columns);
+    // No landmarks here so plain A* is measured with the straight line
+    // distance as its heuristic.
+    Level_Geometry_Options options = { .cluster_size = PATHFIND_DEFAULT_CLUSTER_SIZE };
+    Level_Geometry level = level_geometry_make_with_options(num_joints, joints, options);
+    printf("%-8s joints=%zu entrances=%zu queries=%d\n", desc->name, num_joints, level.hierarchy.entrances.count, BENCH_QUERY_COUNT);
+
+    Vector2 *starts = malloc(BENCH_QUERY_COUNT * sizeof(Vector2));
+    Vector2 *ends = malloc(BENCH_QUERY_COUNT * sizeof(Vector2));
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        starts[i] = bench_random_point(&level);
+        ends[i] = bench_random_point(&level);
+    }
+
+    Pathfind_Reachability *reachability = &level.reachability;
+    double begin = bench_now();
+    pathfind_reachability_build(&level);
+    double elapsed = bench_now() - begin;
+
+    size_t reachable = 0;
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        if (level_geometry_is_reachable(&level, starts[i], ends[i])) ++reachable;
+    }
+
+    printf("%-8s reachability: components=%zu closure=%zuKB build=%.3fms reachable=%zu\n",
+        desc->name,
+        reachability->num_components,
+        reachability->num_components * reachability->words_per_component * sizeof(uint64_t) / 1024,
+        elapsed * 1e3,
+        reachable
+    );
+
+    bench_find_floor(&level, desc->name, starts, ends);
+    bench_floor_kernel(&level, desc->name, starts);
+    bench_snap(&level, desc->name, starts);
+    bench_random_position(&level, desc->name, starts);
+    bench_occupancy(&level, desc->name);
+    bench_raycast(&level, desc->name);
+    bench_level_file(desc->name, num_joints, joints);
+
+    // Which search answers the same queries fastest on this level.
+    const char *labels[] = { "flat", "flat (ALT)", "flat (corr)", "hierarchical", "bidir", "bidir (ALT)" };
+    double times[sizeof(labels) / sizeof(labels[0])];
+
+    float *flat_lengths = malloc(BENCH_QUERY_COUNT * sizeof(float));
+    times[0] = bench_flat(&level, desc->name, "flat:", starts, ends, flat_lengths, NULL);
+
+    // Same joints, but with landmarks so A* gets the ALT heuristic instead
+    // of the straight line distance.
+    Level_Geometry_Options alt_options = { .num_landmarks = BENCH_LANDMARK_COUNT };
+    Level_Geometry alt_level = level_geometry_make_with_options(num_joints, joints, alt_options);
+    times[1] = bench_flat(&alt_level, desc->name, "flat (ALT):", starts, ends, NULL, flat_lengths);
+
+    // Same joints again, with chains of joints collapsed into corridors.
+    Level_Geometry_Options corridor_options = { .contract_corridors = true };
+    Level_Geometry corridor_level = level_geometry_make_with_options(num_joints, joints, corridor_options);
+    times[2] = bench_flat(&corridor_level, desc->name, "flat (corr):", starts, ends, NULL, flat_lengths);
+    level_geometry_free(&corridor_level);
+
+    times[3] = bench_hierarchical(&level, desc->name, starts, ends, flat_lengths);
+    times[4] = bench_bidirectional(&level, desc->name, "bidir:", starts, ends, flat_lengths);
+    times[5] = bench_bidirectional(&alt_level, desc->name, "bidir (ALT):", starts, ends, flat_lengths);
+    level_geometry_free(&alt_level);
+
+    size_t winner = 0;
+    for (size_t i = 1; i < sizeof(times) / sizeof(times[0]); ++i) {
+        if (times[i] < times[winner]) winner = i;
+    }
+    printf("%-8s winner:       %s\n", desc->name, labels[winner]);
+
+    bench_profiles(&level, desc->name, starts, ends, flat_lengths);
+    bench_flow_field(&level, desc->name, starts);
+    bench_nearest(&level, desc->name, starts);
+    bench_chase(&level, desc->name, starts, ends);
+    bench_budgeted(&level, desc->name, starts, ends);
+
+    // Enemies mostly travel between the same handful of floors so replay
+    // the queries between a few hot points through the path cache.
+    Vector2 hot_points[BENCH_HOT_POINT_COUNT];
+    for (int i = 0; i < BENCH_HOT_POINT_COUNT; ++i) {
+        hot_points[i] = bench_random_point(&level);
+    }
+
+    begin = bench_now();
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        Vector2 start = hot_points[rand() % BENCH_HOT_POINT_COUNT];
+        Vector2 end = hot_points[rand() % BENCH_HOT_POINT_COUNT];
+        Vec_Vector2 path = level_geometry_pathfind_cached(&level, start, end);
+        vec_free(&path);
+    }
+    elapsed = bench_now() - begin;
+
+    Path_Cache *cache = &level.path_cache;
+    printf("%-8s cached:       hits=%zu misses=%zu hit-rate=%.1f%%  %8.2f us/query\n",
+        desc->name,
+        cache->hits,
+        cache->misses,
+        100.0 * cache->hits / (cache->hits + cache->misses),
+        elapsed * 1e6 / BENCH_QUERY_COUNT
+    );
+
+    // The same random queries as the flat search, in one batch. Nearly all
+    // of them miss the cache so this measures the worker pool.
+    Vec_Vector2 *paths = malloc(BENCH_QUERY_COUNT * sizeof(Vec_Vector2));
+    begin = bench_now();
+    level_geometry_pathfind_batch(&level, BENCH_QUERY_COUNT, starts, ends, paths);
+    elapsed = bench_now() - begin;
+
+    size_t paths_found = 0;
+    for (int i = 0; i < BENCH_QUERY_COUNT; ++i) {
+        if (paths[i].count != 0) ++paths_found;
+        vec_free(&paths[i]);
+    }
+    free(paths);
+
+    printf("%-8s batch:        found=%-5zu workers=%d time=%8.3fms  %8.2f us/query\n",
+        desc->name,
+        paths_found,
+        level.pool->num_workers,
+        elapsed * 1e3,
+        elapsed * 1e6 / BENCH_QUERY_COUNT
+    );
+
+    // Last because it leaves locks behind.
+    bench_replanning(&level, desc->name, starts, ends);
+
+    free(flat_lengths);
+    free(starts);
+    free(ends);
+    level_geometry_free(&level);
+    free(joints);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_ERROR);
+
+    for (size_t i = 0; i < sizeof(BENCH_LEVELS) / sizeof(BENCH_LEVELS[0]); ++i) {
+        bench_level(&BENCH_LEVELS[i]);
+    }
+
+    return 0;
+}
@@ -75,3 +75,41 @@ project "re2d-editor"
         targetdir "bin/release"
         optimize "Speed"
 
+
+project "re2d-bench"
+    kind "ConsoleApp"
+    language "C"
+    cdialect "C11"
+    toolset "clang"
+
+    files { "src/**.c", "bench/**.c" }
+    removefiles { "src/main.c" }
+
+    includedirs {
+        "src",
+        "/opt/homebrew/Cellar/raylib/4.5.0/include"
+    }
+
+    libdirs {
+        "/opt/homebrew/Cellar/raylib/4.5.0/lib"
+    }
+
+    links { "raylib" }
+
+    filter "action:gmake2"
+        buildoptions {
+            "-Wpedantic",
+            "-Wall",
+            "-Wextra",
+            "-Werror"
+        }
+
+    filter "configurations:debug"
+        defines { "DEBUG" }
+        targetdir "bin/debug"
+        symbols "On"
+        optimize "Debug"
+
+    filter "configurations:release"
+        targetdir "bin/release"
+        optimize "Speed"
@@ -2,8 +2,73 @@
 
 #include <raymath.h>
 
+#include "pathfind_pool.h"
+
 #include "utils.h"
 
 bool check_overlap(float a_min, float a_max, float b_min, float b_max) {
     return b_min <= a_max && b_max >= a_min;
 }
+
+Collision level_raycast(Level_Geometry *level, Vector2 from, Vector2 to) {
+    float t;
+    if (level_floor_grid_raycast(&level->floor_grid, from, to, &t) == -1) return (Collision){0};
+
+    return (Collision){
+        .hit = true,
+        .distance = Vector2Distance(from, to) * t,
+        .point = lerpv(from, to, t)
+    };
+}
+
+bool level_line_of_sight(Level_Geometry *level, Vector2 from, Vector2 to) {
+    float t;
+    return level_floor_grid_raycast(&level->floor_grid, from, to, &t) == -1;
+}
+
+typedef struct {
+    Level_Geometry *level;
+    size_t count;
+    const Vector2 *from;
+    const Vector2 *to;
+    Collision *collisions;
+} Raycast_Batch;
+
+static void raycast_batch_chunk(void *data, Pathfind_Query *query, size_t index) {
+    (void)query;
+    Raycast_Batch *batch = data;
+
+    size_t begin = index * LEVEL_RAYCAST_CHUNK_SIZE;
+    size_t end = begin + LEVEL_RAYCAST_CHUNK_SIZE;
+    if (end > batch->count) end = batch->count;
+
+    for (size_t i = begin; i < end; ++i) {
+        batch->collisions[i] = level_raycast(batch->level, batch->from[i], batch->to[i]);
+    }
+}
+
+void level_raycast_batch(Level_Geometry *level, size_t count, const Vector2 *from, const Vector2 *to, Collision *collisions) {
+    Raycast_Batch batch = {
+        .level = level,
+        .count = count,
+        .from = from,
+        .to = to,
+        .collisions = collisions
+    };
+
+    // NOTE: A ray is over in about a microsecond, so the workers are only
+    //       woken for batches big enough to make up for it and are handed
+    //       whole chunks at a time rather than single rays.
+    size_t num_chunks = (count + LEVEL_RAYCAST_CHUNK_SIZE - 1) / LEVEL_RAYCAST_CHUNK_SIZE;
+    if (count < LEVEL_RAYCAST_PARALLEL_MIN_COUNT) {
+        for (size_t i = 0; i < num_chunks; ++i) {
+            raycast_batch_chunk(&batch, NULL, i);
+        }
+        return;
+    }
+
+    if (!level->pool) {
+        level->pool = pathfind_pool_make(level->num_workers);
+    }
+    pathfind_pool_run(level->pool, num_chunks, raycast_batch_chunk, &batch);
+}
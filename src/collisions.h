@@ -15,4 +15,16 @@ typedef struct {
 
 bool check_overlap(float a_min, float a_max, float b_min, float b_max);
 
+// Past this many rays a batch is split up between the level's workers.
+#define LEVEL_RAYCAST_PARALLEL_MIN_COUNT 1024
+#define LEVEL_RAYCAST_CHUNK_SIZE 256
+
+// The first floor the segment from `from` to `to` hits. Falls don't stop
+// anything and a segment starting right on a floor hits it straight away.
+Collision level_raycast(Level_Geometry *level, Vector2 from, Vector2 to);
+// Whether nothing is in the way between `from` and `to`.
+bool level_line_of_sight(Level_Geometry *level, Vector2 from, Vector2 to);
+// `level_raycast` for each of `count` segments.
+void level_raycast_batch(Level_Geometry *level, size_t count, const Vector2 *from, const Vector2 *to, Collision *collisions);
+
 #endif
@@ -1,47 +1,457 @@
 #include "enemy.h"
 
+#include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <raymath.h>
 
-#define PATH_TARGET_COMPLETION_THRESHOLD 0.75f
+Enemy enemy_spawn(Level_Geometry *level, Vector2 position, Pathfind_Profile profile) {
+    Floor_Position floor_position;
+    bool on_floor = level_snap_to_floor(level, position, LEVEL_FLOOR_SNAP_TOLERANCE, &floor_position);
+    assert(on_floor && "enemies have to spawn on a floor");
 
-Enemy enemy_spawn(Vector2 position) {
     return (Enemy){
-        .position = position,
+        .profile = profile,
+        .floor_position = floor_position,
+        .position = level_floor_position_point(level, floor_position),
         .health = ENEMY_START_HEALTH,
         .damage_receive_time = -INFINITY,
         .target = -1,
-        .reached_destination_time = -INFINITY
+        .reached_destination_time = -INFINITY,
+        .plan = pathfind_plan_make(),
+        .replanner = pathfind_replanner_make(profile)
     };
 }
 
-void enemy_update_all(Vec_Enemy *enemies, Level_Geometry *level, float delta) {
+// Fixes up a path that was found before a lock or connection changed,
+// planning again from wherever the enemy is on its floor.
+//
+// NOTE: The replanner only runs its first search towards a destination
+//       here, once a change has actually got in the way. Paths that never
+//       need repairing were only ever searched for once, wherever they
+//       were found.
+static void enemy_repair_path(Enemy *enemy, Level_Geometry *level) {
+    enemy->path_version = level->version;
+
+    // Nothing left but a walk across the destination's floor.
+    if (enemy->target <= 0) return;
+
+    Vec_Vector2 repaired = {0};
+    if (!pathfind_replanner_plan_from(level, &enemy->replanner, enemy->floor_position, enemy->destination, &repaired)) {
+        TraceLog(LOG_WARNING, "Enemy's path to destination was cut off.");
+        vec_free(&repaired);
+        return;
+    }
+
+    enemy_follow_path(enemy, enemy->destination, repaired, level->version);
+}
+
+// Whether a lock or connection has changed since the enemy's path was
+// found at a joint it's still going to walk through, or one at either end
+// of the floor it's on. Anything that opened up counts wherever it is,
+// it might be a shortcut.
+static bool enemy_path_is_affected(Enemy *enemy, Level_Geometry *level) {
+    size_t first;
+    if (!level_geometry_changes_since(level, enemy->path_version, &first)) return true;
+
+    int edge = enemy->floor_position.edge;
+    for (size_t i = first; i < level->changes.count; ++i) {
+        if (level->changes.items[i].opened) return true;
+
+        int joint = level->changes.items[i].joint;
+        if (joint == FLOOR_EDGE_JOINT(edge) || joint == level_edge_other(level, edge)) return true;
+
+        // NOTE: Everything in the path but the destination is a joint.
+        Vector2 position = level->joints[joint].position;
+        for (int j = 1; j <= enemy->target; ++j) {
+            if (Vector2Equals(enemy->path.items[j], position)) return true;
+        }
+    }
+
+    return false;
+}
+
+static void enemy_stop_chasing(Enemy *enemy) {
+    enemy->chasing = false;
+    enemy->flow_field = NULL;
+}
+
+// Follows the path that was asked for to `destination`. Wandering enemies
+// only head for places they can get to, but the player can be anywhere, so
+// a chaser that can't get to them goes back to wandering about.
+static void enemy_take_path(Enemy *enemy, Level_Geometry *level, Vec_Vector2 path) {
+    if (enemy_follow_path(enemy, enemy->destination, path, level->version)) return;
+
+    if (enemy->chasing) {
+        enemy_stop_chasing(enemy);
+    } else {
+        TraceLog(LOG_ERROR, "Failed to find path to destination.");
+    }
+}
+
+// Picks up the path asked for by `enemy_update` once the level's
+// pathfinding service has it ready.
+static void enemy_collect_path(Enemy *enemy, Level_Geometry *level) {
+    Vec_Vector2 path = {0};
+    Pathfind_Status status = level_geometry_pathfind_poll(level, enemy->ticket, &path);
+    if (status == Pathfind_Status_IN_PROGRESS) return;
+
+    enemy->ticket = PATHFIND_NO_TICKET;
+    enemy_take_path(enemy, level, path);
+}
+
+// Asks for the path to the destination `enemy_update` picked. Paths already
+// in the level's path cache are followed straight away either way.
+static void enemy_ask_for_path(Enemy *enemy, Level_Geometry *level, Enemy_Planning planning) {
+    enemy->wants_path = false;
+
+    if (planning == Enemy_Planning_ASYNC) {
+        enemy->ticket = level_geometry_pathfind_async_from(level, enemy->floor_position, enemy->destination, enemy->profile);
+        return;
+    }
+
+    Vec_Vector2 path = {0};
+    if (level_geometry_pathfind_lookup_from(level, enemy->floor_position, enemy->destination, enemy->profile, &path)) {
+        enemy_take_path(enemy, level, path);
+        return;
+    }
+
+    pathfind_plan_begin_from(&enemy->plan, enemy->floor_position, enemy->destination, enemy->profile);
+    enemy->planning = true;
+}
+
+// Steps the enemies' plans within the frame's budget.
+static void enemy_step_plans(Vec_Enemy *enemies, Enemy_Crowd *crowd, Level_Geometry *level) {
+    Vec_int pathing = {0};
+    for (size_t i = 0; i < enemies->count; ++i) {
+        if (enemies->items[i].planning) vec_append(&pathing, (int)i);
+    }
+
+    if (pathing.count == 0) {
+        return;
+    }
+
+    // NOTE: The frame's budget is split evenly between the enemies that
+    //       are planning and what doesn't divide goes one expansion each
+    //       to whoever is first in line. When there are too many of them
+    //       for everyone to get `ENEMY_MIN_PLANNING_SHARE` only the first
+    //       ones in line get stepped. The line moves along every frame so
+    //       nobody is left out for long, and whoever runs out carries on
+    //       next frame.
+    size_t first = crowd->next_planner % pathing.count;
+    size_t stepped = pathing.count;
+    size_t share = ENEMY_PLANNING_BUDGET / stepped;
+    size_t extra = ENEMY_PLANNING_BUDGET % stepped;
+    if (share < ENEMY_MIN_PLANNING_SHARE) {
+        stepped = ENEMY_PLANNING_BUDGET / ENEMY_MIN_PLANNING_SHARE;
+        share = ENEMY_MIN_PLANNING_SHARE;
+        extra = 0;
+    }
+    crowd->next_planner = (first + (stepped < pathing.count ? stepped : extra)) % pathing.count;
+
+    Pathfind_Plan **plans = malloc(stepped * sizeof(Pathfind_Plan *));
+    size_t *budgets = malloc(stepped * sizeof(size_t));
+    Pathfind_Status *statuses = malloc(stepped * sizeof(Pathfind_Status));
+    Vec_Vector2 *paths = malloc(stepped * sizeof(Vec_Vector2));
+
+    for (size_t i = 0; i < stepped; ++i) {
+        plans[i] = &enemies->items[pathing.items[(first + i) % pathing.count]].plan;
+        budgets[i] = share + (i < extra ? 1 : 0);
+    }
+
+    level_geometry_plan_batch(level, stepped, plans, budgets, 0.0, statuses, paths);
+
+    for (size_t i = 0; i < stepped; ++i) {
+        Enemy *e = &enemies->items[pathing.items[(first + i) % pathing.count]];
+        if (statuses[i] == Pathfind_Status_IN_PROGRESS) continue;
+
+        e->planning = false;
+        enemy_take_path(e, level, paths[i]);
+    }
+
+    free(plans);
+    free(budgets);
+    free(statuses);
+    free(paths);
+    vec_free(&pathing);
+}
+
+// Drops whatever path the enemy was waiting on.
+static void enemy_stop_planning(Enemy *enemy, Level_Geometry *level) {
+    if (enemy->ticket != PATHFIND_NO_TICKET) {
+        level_geometry_pathfind_cancel(level, enemy->ticket);
+        enemy->ticket = PATHFIND_NO_TICKET;
+    }
+    enemy->wants_path = false;
+    enemy->planning = false;
+}
+
+static void enemy_start_chasing(Enemy *enemy, Level_Geometry *level) {
+    enemy_stop_planning(enemy, level);
+    enemy->chasing = true;
+}
+
+// NOTE: Partway down a fall isn't somewhere a path can end, so chasers
+//       keep heading for wherever the player was last.
+static bool enemy_can_head_for(Floor_Position player) {
+    return FLOOR_EDGE_KIND(player.edge) != CONN_FALL || player.t <= 0.f || player.t >= 1.f;
+}
+
+// Whether the player is on the enemy's floor and close enough along it.
+static bool enemy_notices_player(Enemy *enemy, Enemy_Crowd *crowd, Level_Geometry *level) {
+    vec_clear(&crowd->nearby);
+    level_occupancy_near(crowd->occupancy, level, enemy->floor_position, ENEMY_CHASE_DISTANCE, &crowd->nearby);
+
+    vec_foreach(Level_Occupant, occupant, crowd->nearby) {
+        if (occupant->kind == Level_Occupant_PLAYER) return true;
+    }
+    return false;
+}
+
+// Starts chasing the player once they come close enough and stops once
+// they're far enough away again. While chasing, the enemy follows
+// `chase_field` if it's given one it can walk, otherwise its path is bent
+// towards wherever the player is this frame. Returns true if the enemy
+// only just noticed the player.
+static bool enemy_update_chase(Enemy *enemy, Enemy_Crowd *crowd, Pathfind_Flow_Field *chase_field, Level_Geometry *level) {
+    Floor_Position player = *crowd->player;
+    if (!enemy_can_head_for(player)) return false;
+
+    Vector2 destination = level_floor_position_point(level, player);
+    bool noticed = false;
+    if (!enemy->chasing) {
+        if (!enemy_notices_player(enemy, crowd, level)) return false;
+
+        enemy_start_chasing(enemy, level);
+        noticed = true;
+    } else if (Vector2Distance(enemy->position, destination) > ENEMY_GIVE_UP_DISTANCE) {
+        enemy_stop_chasing(enemy);
+        return false;
+    }
+
+    // NOTE: The field is only searched with the default costs.
+    if (chase_field && enemy->profile == Pathfind_Profile_DEFAULT) {
+        if (!enemy->flow_field) {
+            vec_free(&enemy->path);
+            enemy->target = -1;
+            enemy->flow_field = chase_field;
+        }
+        return noticed;
+    }
+    enemy->flow_field = NULL;
+
+    enemy_chase(enemy, destination, level);
+    return noticed;
+}
+
+// The flow field towards the player for this frame, if there are enough
+// chasers to share it.
+static Pathfind_Flow_Field *enemy_chase_field(Vec_Enemy *enemies, Enemy_Crowd *crowd, Level_Geometry *level) {
+    if (!crowd->player || !enemy_can_head_for(*crowd->player)) return NULL;
+
+    size_t chasers = 0;
+    vec_foreach(Enemy, e, *enemies) {
+        if (e->chasing && e->profile == Pathfind_Profile_DEFAULT) ++chasers;
+    }
+    if (chasers < ENEMY_CHASE_FIELD_MIN_CHASERS) return NULL;
+
+    pathfind_flow_field_update(level, &crowd->chase_field, *crowd->player);
+    return &crowd->chase_field;
+}
+
+// Gets the enemies close to `enemy` along its floor to join in the chase.
+// They pick up the player's trail on the next frame.
+static void enemy_alert_nearby(Vec_Enemy *enemies, Enemy_Crowd *crowd, Level_Geometry *level, Enemy *enemy) {
+    vec_clear(&crowd->nearby);
+    level_occupancy_near(crowd->occupancy, level, enemy->floor_position, ENEMY_ALERT_DISTANCE, &crowd->nearby);
+
+    vec_foreach(Level_Occupant, occupant, crowd->nearby) {
+        if (occupant->kind != Level_Occupant_ENEMY) continue;
+
+        Enemy *other = &enemies->items[occupant->index];
+        if (!other->chasing) enemy_start_chasing(other, level);
+    }
+}
+
+void enemy_update_all(Vec_Enemy *enemies, Enemy_Crowd *crowd, Level_Geometry *level, float delta) {
+    assert((!crowd->player || crowd->occupancy) && "chasing the player needs the occupancy");
+
+    Pathfind_Flow_Field *chase_field = enemy_chase_field(enemies, crowd, level);
+
+    Vec_int noticed = {0};
     for (size_t i = 0; i < enemies->count;) {
         Enemy *e = &enemies->items[i];
         if (e->health <= 0.f) {
-            enemy_free(e);
+            enemy_free(e, level);
             vec_remove(enemies, i);
             continue;
         }
 
+        if (e->target != -1 && e->path_version != level->version) {
+            if (enemy_path_is_affected(e, level)) {
+                enemy_repair_path(e, level);
+            } else {
+                e->path_version = level->version;
+            }
+        }
+
+        if (e->ticket != PATHFIND_NO_TICKET) {
+            enemy_collect_path(e, level);
+        }
+
+        if (!crowd->player) {
+            enemy_stop_chasing(e);
+        } else if (enemy_update_chase(e, crowd, chase_field, level)) {
+            vec_append(&noticed, (int)i);
+        }
+
         enemy_update(e, level, delta);
+        if (e->wants_path) {
+            enemy_ask_for_path(e, level, crowd->planning);
+        }
         ++i;
     }
+
+    enemy_step_plans(enemies, crowd, level);
+
+    if (crowd->occupancy) {
+        for (size_t i = 0; i < enemies->count; ++i) {
+            level_occupancy_update(crowd->occupancy, level, Level_Occupant_ENEMY, i, enemies->items[i].floor_position);
+        }
+        level_occupancy_truncate(crowd->occupancy, Level_Occupant_ENEMY, enemies->count);
+
+        // NOTE: Only once the occupancy has caught up with whoever got
+        //       moved into the place of an enemy that died.
+        vec_foreach(int, i, noticed) {
+            enemy_alert_nearby(enemies, crowd, level, &enemies->items[*i]);
+        }
+    }
+    vec_free(&noticed);
+}
+
+Enemy_Crowd enemy_crowd_make(Floor_Position *player, Level_Occupancy *occupancy) {
+    return (Enemy_Crowd){
+        .planning = Enemy_Planning_ASYNC,
+        .player = player,
+        .occupancy = occupancy,
+        .chase_field = pathfind_flow_field_make()
+    };
+}
+
+void enemy_crowd_free(Enemy_Crowd *crowd) {
+    vec_free(&crowd->nearby);
+    pathfind_flow_field_free(&crowd->chase_field);
+}
+
+// Where along `edge` `target` is, if it's on it at all. Gives it the same
+// leeway as `level_find_floor` since targets on slopes rarely land exactly
+// on the floor.
+static bool enemy_edge_has(Level_Geometry *level, int edge, Vector2 target, float *t) {
+    float closest = level_edge_closest_t(level, edge, target);
+    Vector2 point = level_floor_position_point(level, (Floor_Position){ .edge = edge, .t = closest });
+    if (Vector2DistanceSqr(point, target) > LEVEL_FLOOR_SNAP_TOLERANCE * LEVEL_FLOOR_SNAP_TOLERANCE) return false;
+
+    *t = closest;
+    return true;
+}
+
+// The connection out of `joint` that leads to `target`, which is either the
+// joint at the other end or somewhere on its floor.
+static int enemy_edge_out_of(Level_Geometry *level, int joint, Vector2 target, float *t) {
+    Geometry_Joint *j = &level->joints[joint];
+
+    for (int side = 0; side < JOINT_COUNT; ++side) {
+        for (int kind = 0; kind < CONN_COUNT; ++kind) {
+            int other = j->connections[side].connections[kind];
+            if (other == -1 || !Vector2Equals(level->joints[other].position, target)) continue;
+
+            *t = 1.f;
+            return FLOOR_EDGE(joint, side, kind);
+        }
+    }
+
+    for (int side = 0; side < JOINT_COUNT; ++side) {
+        for (int kind = 0; kind < CONN_COUNT; ++kind) {
+            if (j->connections[side].connections[kind] == -1) continue;
+
+            int edge = FLOOR_EDGE(joint, side, kind);
+            if (enemy_edge_has(level, edge, target, t)) return edge;
+        }
+    }
+
+    return -1;
+}
+
+// Moves the enemy up to `distance` along its floor towards `target`, going
+// on to the next floor if it's stood on the joint between them. Returns
+// true once it's there.
+//
+// NOTE: Paths are made of joints so the next target is always on the floor
+//       the enemy is on or one leaving the joint it's stood on.
+static bool enemy_walk_towards(Enemy *enemy, Level_Geometry *level, Vector2 target, float distance) {
+    Floor_Position *at = &enemy->floor_position;
+
+    float target_t;
+    if (!enemy_edge_has(level, at->edge, target, &target_t)) {
+        int joint = -1;
+        if (at->t <= 0.f) joint = FLOOR_EDGE_JOINT(at->edge);
+        if (at->t >= 1.f) joint = level_edge_other(level, at->edge);
+
+        int edge = joint == -1 ? -1 : enemy_edge_out_of(level, joint, target, &target_t);
+        if (edge == -1) {
+            // Only a path that was cut off or repaired from somewhere else
+            // ends up here. Better to pop over to it than get stuck.
+            TraceLog(LOG_WARNING, "Enemy's path left the floors, snapping back onto them.");
+            Floor_Position snapped;
+            if (level_snap_to_floor(level, target, LEVEL_FLOOR_SNAP_TOLERANCE, &snapped)) *at = snapped;
+            return true;
+        }
+
+        *at = (Floor_Position){ .edge = edge, .t = 0.f };
+    }
+
+    float length = level_edge_length(level, at->edge);
+    float step = length == 0.f ? 1.f : distance / length;
+    if (fabsf(target_t - at->t) <= step) {
+        at->t = target_t;
+        return true;
+    }
+
+    at->t += target_t > at->t ? step : -step;
+    return false;
 }
 
 void enemy_update(Enemy *enemy, Level_Geometry *level, float delta) {
     double now = GetTime();
     if ((now - enemy->reached_destination_time >= ENEMY_PATHING_WAIT_TIME_SECS) &&
-        (enemy->target == -1))
+        (enemy->target == -1) &&
+        !enemy->chasing &&
+        !enemy->wants_path &&
+        !enemy->planning &&
+        (enemy->ticket == PATHFIND_NO_TICKET))
     {
         vec_free(&enemy->path);
 
-        Vector2 destination = enemy_choose_random_destination(enemy->position, level);
-        if (!enemy_find_path_to(enemy, destination, level)) {
-            TraceLog(LOG_ERROR, "Failed to find path to destination.");
-            return;
+        // NOTE: The path is asked for by `enemy_update_all` the way the
+        //       crowd plans and picked up on this or a later frame.
+        enemy->destination = enemy_choose_random_destination(enemy, level);
+        enemy->wants_path = true;
+        return;
+    }
+
+    float speed = fminf(1.0f, ilerp(now - enemy->damage_receive_time, 0.f, ENEMY_STUN_TIME_SECS));
+    speed *= ENEMY_SPEED;
+
+    if (enemy->flow_field) {
+        Vector2 waypoint;
+        if (pathfind_flow_field_next_waypoint(level, enemy->flow_field, enemy->floor_position, &waypoint)) {
+            enemy_walk_towards(enemy, level, waypoint, speed * delta);
+            enemy->position = level_floor_position_point(level, enemy->floor_position);
+        } else {
+            enemy_stop_chasing(enemy);
         }
+        return;
     }
 
     if (enemy->target == -1) {
@@ -50,23 +460,15 @@ void enemy_update(Enemy *enemy, Level_Geometry *level, float delta) {
 
     Vector2 target = enemy->path.items[enemy->target];
 
-    Vector2 dir = Vector2Normalize(Vector2Subtract(target, enemy->position));
-
-    float speed = fminf(1.0f, ilerp(now - enemy->damage_receive_time, 0.f, ENEMY_STUN_TIME_SECS));
-    speed *= ENEMY_SPEED;
-
-    enemy->position = Vector2Add(enemy->position, Vector2Scale(dir, speed * delta));
-
-    if (Vector2DistanceSqr(enemy->position, target) <= PATH_TARGET_COMPLETION_THRESHOLD) {
-        enemy->position.y = target.y;
-
+    if (enemy_walk_towards(enemy, level, target, speed * delta)) {
         --enemy->target;
         if (enemy->target == -1) {
             // made it to destination
             enemy->reached_destination_time = now;
-            enemy->position = enemy->destination;
         }
     }
+
+    enemy->position = level_floor_position_point(level, enemy->floor_position);
 }
 
 void enemy_draw(Enemy *enemy, Drawer *drawer) {
@@ -104,32 +506,67 @@ void enemy_draw(Enemy *enemy, Drawer *drawer) {
 }
 
 bool enemy_find_path_to(Enemy *enemy, Vector2 destination, Level_Geometry *level) {
-    Vec_Vector2 new_path = level_geometry_pathfind(
+    Vec_Vector2 new_path = level_geometry_pathfind_cached_from(
         level,
-        enemy->position,
-        destination
+        enemy->floor_position,
+        destination,
+        enemy->profile
     );
 
-    if (new_path.count == 0) {
-        return false;
+    return enemy_follow_path(enemy, destination, new_path, level->version);
+}
+
+void enemy_chase(Enemy *enemy, Vector2 destination, Level_Geometry *level) {
+    // NOTE: The path that was asked for last gets bent towards wherever
+    //       the destination has got to once it's here.
+    if (enemy->wants_path || enemy->planning || enemy->ticket != PATHFIND_NO_TICKET) {
+        return;
     }
 
-    enemy->destination = destination;
-    enemy->target = new_path.count - 1;
-    enemy->path = new_path;
+    bool repaired = false;
+    if (enemy->target != -1 && enemy->path_version == level->version) {
+        // NOTE: How far off the heuristic is depends on where on the level
+        //       the path goes, so repairs are held to the path they started
+        //       from rather than to the heuristic itself.
+        if (enemy->path_stretch == 0.f) {
+            enemy->path_stretch = level_geometry_path_stretch(level, enemy->floor_position, enemy->path, enemy->target);
+        }
 
-    return true;
+        repaired = level_geometry_repair_path(
+            level,
+            enemy->floor_position,
+            &enemy->path,
+            &enemy->target,
+            destination,
+            ENEMY_CHASE_REPAIR_MAX_EXPANSIONS,
+            ENEMY_CHASE_REPAIR_MAX_STRETCH * enemy->path_stretch,
+            enemy->profile
+        );
+    }
+
+    enemy->destination = destination;
+    if (!repaired) {
+        enemy->wants_path = true;
+    }
 }
 
-Vector2 enemy_choose_random_destination(Vector2 enemy_position, Level_Geometry *level) {
-    int attempts_remaining = 1000;
-    Vector2 destination;
+bool enemy_follow_path(Enemy *enemy, Vector2 destination, Vec_Vector2 path, unsigned level_version) {
+    if (path.count == 0) {
+        vec_free(&path);
+        return false;
+    }
 
-    do {
-        destination = level_geometry_random_position(level);
-    } while (--attempts_remaining > 0 && Vector2DistanceSqr(destination, enemy_position) < 5.f);
+    vec_free(&enemy->path);
+    enemy->destination = destination;
+    enemy->target = path.count - 1;
+    enemy->path = path;
+    enemy->path_version = level_version;
+    enemy->path_stretch = 0.f;
+    return true;
+}
 
-    return destination;
+Vector2 enemy_choose_random_destination(Enemy *enemy, Level_Geometry *level) {
+    return level_geometry_random_reachable_position_from(level, enemy->floor_position, ENEMY_MIN_DESTINATION_DISTANCE);
 }
 
 void enemy_damage(Enemy *enemy, float damage) {
@@ -137,8 +574,12 @@ void enemy_damage(Enemy *enemy, float damage) {
     enemy->damage_receive_time = GetTime();
 }
 
-void enemy_free(Enemy *enemy) {
+void enemy_free(Enemy *enemy, Level_Geometry *level) {
+    enemy_stop_planning(enemy, level);
+
     vec_free(&enemy->path);
+    pathfind_plan_free(&enemy->plan);
+    pathfind_replanner_free(&enemy->replanner);
 }
 
 #ifdef DEBUG
@@ -5,6 +5,7 @@
 #include "vec.h"
 
 #include "level_geometry.h"
+#include "level_occupancy.h"
 #include "draw.h"
 
 #define ENEMY_WIDTH 25
@@ -16,14 +17,52 @@
 #define ENEMY_PATHING_WAIT_TIME_SECS 1.5f
 #define ENEMY_SHOW_DAMAGE_TIME_SECS 0.1f
 #define ENEMY_STUN_TIME_SECS 0.5f
+#define ENEMY_CHASE_REPAIR_MAX_EXPANSIONS 256
+#define ENEMY_CHASE_REPAIR_MAX_STRETCH 1.1f // how much more stretched than the path it started from a repaired one can get
+#define ENEMY_MIN_DESTINATION_DISTANCE 2.25f
+#define ENEMY_CHASE_DISTANCE 300.f     // how close along its floor the player has to get before an enemy gives chase
+#define ENEMY_GIVE_UP_DISTANCE 600.f   // and how far away again before it stops
+#define ENEMY_ALERT_DISTANCE 200.f     // enemies this close along the floor to one that gives chase join in
+#define ENEMY_CHASE_FIELD_MIN_CHASERS 2 // chasers it takes before they share a flow field towards the player
+#define ENEMY_PLANNING_BUDGET 4096     // nodes expanded per frame, shared by every enemy that's planning
+#define ENEMY_MIN_PLANNING_SHARE 128   // fewer than this and a plan is skipped for the frame instead
+
+// How enemies get the paths to their destinations.
+typedef enum {
+    Enemy_Planning_ASYNC,    // searched for on the level's pathfinding service
+    Enemy_Planning_BUDGETED  // stepped on the main loop within `ENEMY_PLANNING_BUDGET` a frame
+} Enemy_Planning;
+
+// What `enemy_update_all` shares between every enemy.
+typedef struct {
+    Enemy_Planning planning;
+    size_t next_planner;  // first in line for what's left of the planning budget
+    Floor_Position *player; // who the enemies chase, NULL if there's nobody
+    // Who is where. The enemies are kept up to date by `enemy_update_all`
+    // and the player has to be by whoever moves them.
+    Level_Occupancy *occupancy;
+    Vec_Level_Occupant nearby; // scratch for `level_occupancy_near`
+    Pathfind_Flow_Field chase_field; // towards the player, shared by the chasers that walk the default way
+} Enemy_Crowd;
 
 typedef struct {
     // Pathfinding State
-    Vector2 position;     // current position
+    Pathfind_Profile profile; // what every path the enemy asks for costs it
+    Floor_Position floor_position;
+    Vector2 position;     // worked out from `floor_position` after moving
     Vector2 destination;  // final destination of `path`
     double reached_destination_time;
     int target;           // index of current target position in `path`
     Vec_Vector2 path;
+    bool chasing;         // after the player rather than wandering about
+    Pathfind_Flow_Field *flow_field; // followed instead of `path` while it's set
+    bool wants_path;      // waiting on `enemy_update_all` to ask for a path to `destination`
+    Pathfind_Ticket ticket; // for the path to `destination` while it's being found
+    bool planning;        // `plan` is still looking for the path to `destination`
+    Pathfind_Plan plan;   // carried over between frames by `Enemy_Planning_BUDGETED`
+    unsigned path_version; // `level->version` when `path` was found
+    float path_stretch;   // `level_geometry_path_stretch` of `path` as it was found, 0 until it's needed
+    Pathfind_Replanner replanner;
 
     // Combat State
     float health;
@@ -32,18 +71,32 @@ typedef struct {
 
 DEFINE_VEC_FOR_TYPE(Enemy);
 
-Enemy enemy_spawn(Vector2 position);
+// `position` is snapped onto the nearest floor.
+Enemy enemy_spawn(Level_Geometry *level, Vector2 position, Pathfind_Profile profile);
+
+// `player` and `occupancy` can both be NULL for enemies that only wander.
+Enemy_Crowd enemy_crowd_make(Floor_Position *player, Level_Occupancy *occupancy);
+void enemy_crowd_free(Enemy_Crowd *crowd);
 
-void enemy_update_all(Vec_Enemy *enemies, Level_Geometry *level, float delta);
+void enemy_update_all(Vec_Enemy *enemies, Enemy_Crowd *crowd, Level_Geometry *level, float delta);
 void enemy_update(Enemy *enemy, Level_Geometry *level, float delta);
 void enemy_draw(Enemy *enemy, Drawer *drawer);
 
 bool enemy_find_path_to(Enemy *enemy, Vector2 destination, Level_Geometry *level);
-Vector2 enemy_choose_random_destination(Vector2 enemy_position, Level_Geometry *level);
+// Like `enemy_find_path_to` but for a destination that moves a little every
+// frame. The current path is repaired when it can be. When it can't, a new
+// one is asked for by `enemy_update_all` the way the crowd plans, and an
+// enemy that turns out not to be able to get there stops chasing.
+void enemy_chase(Enemy *enemy, Vector2 destination, Level_Geometry *level);
+// Takes ownership of `path`, which was found at `level_version`. Returns
+// false if it's empty.
+bool enemy_follow_path(Enemy *enemy, Vector2 destination, Vec_Vector2 path, unsigned level_version);
+Vector2 enemy_choose_random_destination(Enemy *enemy, Level_Geometry *level);
 
 void enemy_damage(Enemy *enemy, float damage);
 
-void enemy_free(Enemy *enemy);
+// `level` is the one the enemy asks for paths on.
+void enemy_free(Enemy *enemy, Level_Geometry *level);
 
 #ifdef DEBUG
 void enemy_draw_path(Enemy *enemy, Drawer *drawer);
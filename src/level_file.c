@@ -0,0 +1,464 @@
+#include "level_file.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <raylib.h>
+
+// NOTE: These are what the records look like in every file written so far.
+//       If one of them fails the layout changed, and `LEVEL_FILE_VERSION`
+//       has to go up along with it.
+_Static_assert(sizeof(Joint_Index) == 4 && sizeof(Connection_Index) == 4, "enums in level files are 32 bits");
+_Static_assert(sizeof(Geometry_Joint) == 48, "Geometry_Joint changed, bump LEVEL_FILE_VERSION");
+_Static_assert(sizeof(Pathfind_Edge) == 24, "Pathfind_Edge changed, bump LEVEL_FILE_VERSION");
+_Static_assert(sizeof(Pathfind_Node) == 204, "Pathfind_Node changed, bump LEVEL_FILE_VERSION");
+_Static_assert(sizeof(Level_Object_Interactable) == 24, "Level_Object_Interactable changed, bump LEVEL_FILE_VERSION");
+_Static_assert(sizeof(Level_File_Header) % 8 == 0, "Level_File_Header has to keep its sections aligned");
+
+// Records are used in place, so a big-endian machine would have to swap
+// every one of them first. Nothing this runs on is, so it just says no.
+static bool level_file_host_is_little_endian(void) {
+    uint32_t value = 1;
+    unsigned char first;
+    memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+static size_t level_file_align(size_t offset) {
+    return (offset + LEVEL_FILE_ALIGNMENT - 1) / LEVEL_FILE_ALIGNMENT * LEVEL_FILE_ALIGNMENT;
+}
+
+// What each section should hold for the counts in `header`.
+static void level_file_section_sizes(const Level_File_Header *header, uint64_t sizes[Level_File_Section_COUNT]) {
+    uint64_t num_joints = header->num_joints;
+    uint64_t num_landmarks = header->num_landmarks;
+
+    sizes[Level_File_Section_JOINTS] = num_joints * sizeof(Geometry_Joint);
+    sizes[Level_File_Section_NODES] = num_joints * sizeof(Pathfind_Node);
+    sizes[Level_File_Section_PREDECESSOR_OFFSETS] = (num_joints + 1) * sizeof(int);
+    sizes[Level_File_Section_PREDECESSORS] = (uint64_t)header->num_predecessors * sizeof(Pathfind_Edge);
+    sizes[Level_File_Section_PROFILE_COSTS] = (uint64_t)header->num_profiles * num_joints * PATHFIND_NODE_NEIGHBOUR_COUNT * sizeof(float);
+    sizes[Level_File_Section_LANDMARK_JOINTS] = num_landmarks * sizeof(int);
+    sizes[Level_File_Section_LANDMARKS_FROM] = num_landmarks * num_joints * sizeof(float);
+    sizes[Level_File_Section_LANDMARKS_TO] = num_landmarks * num_joints * sizeof(float);
+    sizes[Level_File_Section_INTERACTABLES] = (uint64_t)header->num_interactables * sizeof(Level_Object_Interactable);
+
+    uint64_t num_cells = (uint64_t)header->grid_num_columns * header->grid_num_rows;
+    uint64_t num_grid_floors = header->num_grid_floors;
+    sizes[Level_File_Section_GRID_CELL_OFFSETS] = num_cells == 0 ? 0 : (num_cells + 1) * sizeof(int);
+    sizes[Level_File_Section_GRID_LEFT_X] = num_grid_floors * sizeof(float);
+    sizes[Level_File_Section_GRID_LEFT_Y] = num_grid_floors * sizeof(float);
+    sizes[Level_File_Section_GRID_RIGHT_X] = num_grid_floors * sizeof(float);
+    sizes[Level_File_Section_GRID_RIGHT_Y] = num_grid_floors * sizeof(float);
+    sizes[Level_File_Section_GRID_SLOPE] = num_grid_floors * sizeof(float);
+    sizes[Level_File_Section_GRID_IDS] = num_grid_floors * sizeof(int);
+}
+
+bool level_file_save(const char *path, Level_Geometry *level, Level_Interactables *interactables) {
+    if (!level_file_host_is_little_endian()) {
+        TraceLog(LOG_ERROR, "Level files can only be written on little-endian machines.");
+        return false;
+    }
+
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Landmarks *landmarks = &level->landmarks;
+    Level_Floor_Grid *grid = &level->floor_grid;
+    bool has_grid = grid->cell_offsets != NULL;
+
+    Level_File_Header header = {
+        .magic = LEVEL_FILE_MAGIC,
+        .version = LEVEL_FILE_VERSION,
+        .header_size = sizeof(Level_File_Header),
+        .joint_size = sizeof(Geometry_Joint),
+        .node_size = sizeof(Pathfind_Node),
+        .edge_size = sizeof(Pathfind_Edge),
+        .interactable_size = sizeof(Level_Object_Interactable),
+        .num_joints = level->num_joints,
+        .num_predecessors = pathfinding->predecessor_offsets[pathfinding->num_nodes],
+        .num_landmarks = landmarks->count,
+        .num_interactables = interactables ? interactables->num_objects : 0,
+        .num_profiles = Pathfind_Profile_COUNT,
+        .grid_origin_x = grid->origin.x,
+        .grid_origin_y = grid->origin.y,
+        .grid_cell_size = grid->cell_size,
+        .grid_num_columns = has_grid ? grid->num_columns : 0,
+        .grid_num_rows = has_grid ? grid->num_rows : 0,
+        .grid_lane_count = LEVEL_FLOOR_LANE_COUNT,
+        .num_grid_floors = has_grid ? grid->floors.count : 0
+    };
+
+    const void *sources[Level_File_Section_COUNT] = {
+        [Level_File_Section_JOINTS] = level->joints,
+        [Level_File_Section_NODES] = pathfinding->nodes,
+        [Level_File_Section_PREDECESSOR_OFFSETS] = pathfinding->predecessor_offsets,
+        [Level_File_Section_PREDECESSORS] = pathfinding->predecessors,
+        [Level_File_Section_PROFILE_COSTS] = pathfinding->profile_costs,
+        [Level_File_Section_LANDMARK_JOINTS] = landmarks->joints,
+        [Level_File_Section_LANDMARKS_FROM] = landmarks->from,
+        [Level_File_Section_LANDMARKS_TO] = landmarks->to,
+        [Level_File_Section_INTERACTABLES] = interactables ? interactables->objects : NULL,
+        [Level_File_Section_GRID_CELL_OFFSETS] = grid->cell_offsets,
+        [Level_File_Section_GRID_LEFT_X] = grid->floors.left_x,
+        [Level_File_Section_GRID_LEFT_Y] = grid->floors.left_y,
+        [Level_File_Section_GRID_RIGHT_X] = grid->floors.right_x,
+        [Level_File_Section_GRID_RIGHT_Y] = grid->floors.right_y,
+        [Level_File_Section_GRID_SLOPE] = grid->floors.slope,
+        [Level_File_Section_GRID_IDS] = grid->floors.ids
+    };
+
+    uint64_t sizes[Level_File_Section_COUNT];
+    level_file_section_sizes(&header, sizes);
+
+    size_t offset = level_file_align(sizeof(Level_File_Header));
+    for (int i = 0; i < Level_File_Section_COUNT; ++i) {
+        header.sections[i] = (Level_File_Range){ .offset = offset, .size = sizes[i] };
+        offset = level_file_align(offset + sizes[i]);
+    }
+    header.file_size = offset;
+
+    // NOTE: Written out in one go from a buffer so the padding is zeroed
+    //       and a file is never left half written by a failed seek.
+    unsigned char *buffer = calloc(header.file_size, 1);
+    memcpy(buffer, &header, sizeof(header));
+    for (int i = 0; i < Level_File_Section_COUNT; ++i) {
+        if (sizes[i] != 0) memcpy(&buffer[header.sections[i].offset], sources[i], sizes[i]);
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        TraceLog(LOG_ERROR, "Failed to open '%s' to write the level to.", path);
+        free(buffer);
+        return false;
+    }
+
+    bool written = fwrite(buffer, 1, header.file_size, f) == header.file_size;
+    written = fclose(f) == 0 && written;
+    free(buffer);
+
+    if (!written) TraceLog(LOG_ERROR, "Failed to write the level to '%s'.", path);
+    return written;
+}
+
+// NOTE: Read as a byte, anything but 0 or 1 in a `bool` is undefined
+//       behaviour the moment it's looked at as one.
+static bool level_file_bool_is_valid(const bool *value) {
+    unsigned char byte;
+    memcpy(&byte, value, 1);
+    return byte <= 1;
+}
+
+// NOTE: The kinds and indices pick out strings and inventory items
+//       without any further checks, so they have to be in range.
+static bool level_file_interactable_is_valid(Level_Object_Interactable *object) {
+    Interactable *interactable = &object->interactable;
+    if (!level_file_bool_is_valid(&object->interacted)) return false;
+
+    switch ((int)interactable->kind) {
+        case Interactable_Kind_AMMO:
+            return interactable->specific_kind >= 0 && interactable->specific_kind < Ammo_KIND_COUNT;
+        case Interactable_Kind_DOCUMENT:
+            return interactable->info_index >= 0 && interactable->info_index < INTERACTABLE_INFO_DOCUMENT_COUNT;
+        case Interactable_Kind_WEAPON:
+            return interactable->specific_kind >= 0 && interactable->specific_kind < Weapon_Kind_COUNT;
+        case Interactable_Kind_KEY:
+            return interactable->specific_kind >= 0 && interactable->specific_kind < Key_Kind_COUNT;
+        default:
+            return false;
+    }
+}
+
+// Whether `edge` is connection `edge.side`, `edge.kind` of joint `from`
+// leading to joint `to`, the way the graph was built from the joints.
+static bool level_file_edge_is_valid(Geometry_Joint *joints, int num_joints, int from, int to, Pathfind_Edge edge) {
+    bool in_range =
+        (int)edge.side >= 0 && (int)edge.side < JOINT_COUNT &&
+        (int)edge.kind >= 0 && (int)edge.kind < CONN_COUNT &&
+        from >= 0 && from < num_joints && to >= 0 && to < num_joints;
+
+    return in_range &&
+        joints[from].connections[edge.side].connections[edge.kind] == to &&
+        edge.length >= 0.f &&
+        level_file_bool_is_valid(&edge.flat) &&
+        level_file_bool_is_valid(&edge.locked);
+}
+
+// Everything that has to hold before the records can be used as they are.
+static bool level_file_validate(Level_File *file) {
+    const Level_File_Header *header = file->header;
+
+    if (file->size < sizeof(Level_File_Header) || header->magic != LEVEL_FILE_MAGIC) {
+        TraceLog(LOG_ERROR, "Not a level file.");
+        return false;
+    }
+    if (header->version != LEVEL_FILE_VERSION) {
+        TraceLog(LOG_ERROR, "Level file is version %u, expected %u.", header->version, LEVEL_FILE_VERSION);
+        return false;
+    }
+
+    bool layout_matches =
+        header->header_size == sizeof(Level_File_Header) &&
+        header->joint_size == sizeof(Geometry_Joint) &&
+        header->node_size == sizeof(Pathfind_Node) &&
+        header->edge_size == sizeof(Pathfind_Edge) &&
+        header->interactable_size == sizeof(Level_Object_Interactable) &&
+        header->num_profiles == Pathfind_Profile_COUNT;
+    if (!layout_matches) {
+        TraceLog(LOG_ERROR, "Level file was written by a build with different records.");
+        return false;
+    }
+    if (header->file_size != file->size) {
+        TraceLog(LOG_ERROR, "Level file is %zu bytes, its header says %llu.", file->size, (unsigned long long)header->file_size);
+        return false;
+    }
+    if (header->num_landmarks > header->num_joints) {
+        TraceLog(LOG_ERROR, "Level file has more landmarks than joints.");
+        return false;
+    }
+
+    uint64_t sizes[Level_File_Section_COUNT];
+    level_file_section_sizes(header, sizes);
+    for (int i = 0; i < Level_File_Section_COUNT; ++i) {
+        Level_File_Range range = header->sections[i];
+        bool fits =
+            range.size == sizes[i] &&
+            range.offset % LEVEL_FILE_ALIGNMENT == 0 &&
+            range.offset >= sizeof(Level_File_Header) &&
+            range.offset <= file->size &&
+            range.size <= file->size - range.offset;
+        if (!fits) {
+            TraceLog(LOG_ERROR, "Level file section %d is out of place.", i);
+            return false;
+        }
+    }
+
+    // NOTE: Every index is checked once here so nothing that follows them
+    //       has to. It's a single pass over memory that's about to be
+    //       read to build the grid and the rest anyway.
+    int num_joints = header->num_joints;
+    Geometry_Joint *joints = (Geometry_Joint *)&file->data[header->sections[Level_File_Section_JOINTS].offset];
+    Pathfind_Node *nodes = (Pathfind_Node *)&file->data[header->sections[Level_File_Section_NODES].offset];
+    int *predecessor_offsets = (int *)&file->data[header->sections[Level_File_Section_PREDECESSOR_OFFSETS].offset];
+    Pathfind_Edge *predecessors = (Pathfind_Edge *)&file->data[header->sections[Level_File_Section_PREDECESSORS].offset];
+    float *profile_costs = (float *)&file->data[header->sections[Level_File_Section_PROFILE_COSTS].offset];
+    int *landmark_joints = (int *)&file->data[header->sections[Level_File_Section_LANDMARK_JOINTS].offset];
+
+    bool indices_valid = predecessor_offsets[0] == 0 && predecessor_offsets[num_joints] == (int)header->num_predecessors;
+    for (int i = 0; i < num_joints && indices_valid; ++i) {
+        for (int side = 0; side < JOINT_COUNT; ++side) {
+            for (int kind = 0; kind < CONN_COUNT; ++kind) {
+                int other = joints[i].connections[side].connections[kind];
+                if (other < -1 || other >= num_joints) indices_valid = false;
+                if (!level_file_bool_is_valid(&joints[i].connections[side].locked.connections[kind])) indices_valid = false;
+            }
+        }
+
+        if (predecessor_offsets[i] > predecessor_offsets[i + 1]) indices_valid = false;
+    }
+    // The connections are all known to be in range by now, so every edge
+    // can be checked against the one it was built from.
+    uint32_t num_neighbours = 0;
+    for (int i = 0; i < num_joints && indices_valid; ++i) {
+        Vector2 position = joints[i].position;
+        bool position_valid =
+            isfinite(position.x) && isfinite(position.y) &&
+            nodes[i].position.x == position.x && nodes[i].position.y == position.y;
+        if (!position_valid) indices_valid = false;
+
+        // NOTE: Floor movement looks every connection up among the edges,
+        //       so there has to be exactly one for each, in the order
+        //       they're built in.
+        int num_connections = 0;
+        for (int side = 0; side < JOINT_COUNT; ++side) {
+            for (int kind = 0; kind < CONN_COUNT; ++kind) {
+                if (joints[i].connections[side].connections[kind] != -1) ++num_connections;
+            }
+        }
+        if (nodes[i].num_neighbours != num_connections) indices_valid = false;
+        num_neighbours += num_connections;
+
+        for (int j = 0; j < nodes[i].num_neighbours && indices_valid; ++j) {
+            Pathfind_Edge edge = nodes[i].neighbours[j];
+            if (!level_file_edge_is_valid(joints, num_joints, i, edge.node, edge)) indices_valid = false;
+
+            if (j > 0 && indices_valid) {
+                Pathfind_Edge previous = nodes[i].neighbours[j - 1];
+                if (FLOOR_EDGE(0, previous.side, previous.kind) >= FLOOR_EDGE(0, edge.side, edge.kind)) indices_valid = false;
+            }
+
+            // NOTE: A negative or NaN cost would let a search loop back
+            //       through the joints it came from.
+            for (int profile = 0; profile < Pathfind_Profile_COUNT; ++profile) {
+                float cost = profile_costs[((size_t)profile * num_joints + i) * PATHFIND_NODE_NEIGHBOUR_COUNT + j];
+                if (!(cost >= 0.f)) indices_valid = false;
+            }
+        }
+
+        for (int j = predecessor_offsets[i]; j < predecessor_offsets[i + 1] && indices_valid; ++j) {
+            Pathfind_Edge edge = predecessors[j];
+            if (!level_file_edge_is_valid(joints, num_joints, edge.node, i, edge)) indices_valid = false;
+        }
+    }
+    if (header->num_predecessors != num_neighbours) indices_valid = false;
+    for (uint32_t i = 0; i < header->num_landmarks && indices_valid; ++i) {
+        if (landmark_joints[i] < 0 || landmark_joints[i] >= num_joints) indices_valid = false;
+    }
+    Level_Object_Interactable *interactables = (Level_Object_Interactable *)&file->data[header->sections[Level_File_Section_INTERACTABLES].offset];
+    for (uint32_t i = 0; i < header->num_interactables && indices_valid; ++i) {
+        if (!level_file_interactable_is_valid(&interactables[i])) indices_valid = false;
+    }
+
+    size_t num_cells = (size_t)header->grid_num_columns * header->grid_num_rows;
+    if (num_cells != 0 && indices_valid) {
+        int *cell_offsets = (int *)&file->data[header->sections[Level_File_Section_GRID_CELL_OFFSETS].offset];
+        int *ids = (int *)&file->data[header->sections[Level_File_Section_GRID_IDS].offset];
+        int num_edges = num_joints * JOINT_ALL_CONN_COUNT;
+
+        uint32_t lane_count = header->grid_lane_count;
+        indices_valid =
+            header->grid_cell_size > 0.f && lane_count != 0 &&
+            cell_offsets[0] == 0 && cell_offsets[num_cells] == (int)header->num_grid_floors;
+        // NOTE: Lookups scan a cell a whole lane at a time, so a cell that
+        //       doesn't start on a lane would read into its neighbour.
+        for (size_t i = 0; i < num_cells && indices_valid; ++i) {
+            if (cell_offsets[i] > cell_offsets[i + 1] || (uint32_t)cell_offsets[i + 1] % lane_count != 0) indices_valid = false;
+        }
+        for (uint32_t i = 0; i < header->num_grid_floors && indices_valid; ++i) {
+            int id = ids[i];
+            if (id < -1 || id >= num_edges) indices_valid = false;
+            else if (id != -1 && joints[FLOOR_EDGE_JOINT(id)].connections[FLOOR_EDGE_SIDE(id)].connections[FLOOR_EDGE_KIND(id)] == -1) indices_valid = false;
+        }
+    }
+
+    if (!indices_valid) {
+        TraceLog(LOG_ERROR, "Level file refers to joints, connections or items that aren't in it.");
+        return false;
+    }
+
+    return true;
+}
+
+bool level_file_open(const char *path, Level_File *file) {
+    *file = (Level_File){0};
+
+    if (!level_file_host_is_little_endian()) {
+        TraceLog(LOG_ERROR, "Level files can only be read on little-endian machines.");
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        TraceLog(LOG_ERROR, "Failed to open level file '%s'.", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size <= 0) {
+        TraceLog(LOG_ERROR, "Failed to read level file '%s'.", path);
+        close(fd);
+        return false;
+    }
+
+    // NOTE: Private so locks and pickups can be written straight into the
+    //       records. Only the pages that get written to are copied and
+    //       none of it ever goes back to the file.
+    void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        TraceLog(LOG_ERROR, "Failed to map level file '%s'.", path);
+        return false;
+    }
+
+    file->data = data;
+    file->size = st.st_size;
+    file->header = data;
+
+    if (!level_file_validate(file)) {
+        TraceLog(LOG_ERROR, "Failed to load level file '%s'.", path);
+        level_file_close(file);
+        return false;
+    }
+
+    return true;
+}
+
+void level_file_close(Level_File *file) {
+    if (file->data) munmap(file->data, file->size);
+    *file = (Level_File){0};
+}
+
+static void *level_file_section(Level_File *file, Level_File_Section section) {
+    return &file->data[file->header->sections[section].offset];
+}
+
+Level_Geometry level_file_geometry(Level_File *file, Level_Geometry_Options options) {
+    const Level_File_Header *header = file->header;
+    assert(header && "level file isn't open");
+
+    Pathfinding pathfinding = {
+        .num_nodes = header->num_joints,
+        .nodes = level_file_section(file, Level_File_Section_NODES),
+        .predecessor_offsets = level_file_section(file, Level_File_Section_PREDECESSOR_OFFSETS),
+        .predecessors = level_file_section(file, Level_File_Section_PREDECESSORS),
+        .profile_costs = level_file_section(file, Level_File_Section_PROFILE_COSTS),
+        .mapped = true
+    };
+
+    Pathfind_Landmarks landmarks = {0};
+    if (header->num_landmarks != 0) {
+        landmarks = (Pathfind_Landmarks){
+            .count = header->num_landmarks,
+            .joints = level_file_section(file, Level_File_Section_LANDMARK_JOINTS),
+            .from = level_file_section(file, Level_File_Section_LANDMARKS_FROM),
+            .to = level_file_section(file, Level_File_Section_LANDMARKS_TO),
+            .mapped = true
+        };
+    }
+
+    Level_Floor_Grid floor_grid = {0};
+    if ((size_t)header->grid_num_columns * header->grid_num_rows != 0 && header->grid_lane_count == LEVEL_FLOOR_LANE_COUNT) {
+        floor_grid = (Level_Floor_Grid){
+            .origin = { header->grid_origin_x, header->grid_origin_y },
+            .cell_size = header->grid_cell_size,
+            .num_columns = header->grid_num_columns,
+            .num_rows = header->grid_num_rows,
+            .cell_offsets = level_file_section(file, Level_File_Section_GRID_CELL_OFFSETS),
+            .floors = {
+                .count = header->num_grid_floors,
+                .allocated = header->num_grid_floors,
+                .left_x = level_file_section(file, Level_File_Section_GRID_LEFT_X),
+                .left_y = level_file_section(file, Level_File_Section_GRID_LEFT_Y),
+                .right_x = level_file_section(file, Level_File_Section_GRID_RIGHT_X),
+                .right_y = level_file_section(file, Level_File_Section_GRID_RIGHT_Y),
+                .slope = level_file_section(file, Level_File_Section_GRID_SLOPE),
+                .ids = level_file_section(file, Level_File_Section_GRID_IDS)
+            },
+            .mapped = true
+        };
+    }
+
+    return level_geometry_make_from_parts(
+        header->num_joints,
+        level_file_section(file, Level_File_Section_JOINTS),
+        pathfinding,
+        landmarks,
+        floor_grid,
+        options
+    );
+}
+
+Level_Interactables level_file_interactables(Level_File *file) {
+    assert(file->header && "level file isn't open");
+
+    return (Level_Interactables){
+        .num_objects = file->header->num_interactables,
+        .objects = level_file_section(file, Level_File_Section_INTERACTABLES)
+    };
+}
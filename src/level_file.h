@@ -0,0 +1,99 @@
+#ifndef LEVEL_FILE_H_
+#define LEVEL_FILE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "level_geometry.h"
+#include "level_interactables.h"
+
+// "RE2D" when read as a little-endian u32.
+#define LEVEL_FILE_MAGIC 0x44324552u
+#define LEVEL_FILE_VERSION 1
+#define LEVEL_FILE_ALIGNMENT 64
+
+typedef enum {
+    Level_File_Section_JOINTS,              // Geometry_Joint[num_joints]
+    Level_File_Section_NODES,               // Pathfind_Node[num_joints]
+    Level_File_Section_PREDECESSOR_OFFSETS, // int[num_joints + 1]
+    Level_File_Section_PREDECESSORS,        // Pathfind_Edge[num_predecessors]
+    Level_File_Section_PROFILE_COSTS,       // float[Pathfind_Profile_COUNT * num_joints * PATHFIND_NODE_NEIGHBOUR_COUNT]
+    Level_File_Section_LANDMARK_JOINTS,     // int[num_landmarks]
+    Level_File_Section_LANDMARKS_FROM,      // float[num_landmarks * num_joints]
+    Level_File_Section_LANDMARKS_TO,        // float[num_landmarks * num_joints]
+    Level_File_Section_INTERACTABLES,       // Level_Object_Interactable[num_interactables]
+    Level_File_Section_GRID_CELL_OFFSETS,   // int[grid_num_columns * grid_num_rows + 1], empty without a grid
+    Level_File_Section_GRID_LEFT_X,         // float[num_grid_floors], and so on for each of `Level_Floor_Segments`
+    Level_File_Section_GRID_LEFT_Y,
+    Level_File_Section_GRID_RIGHT_X,
+    Level_File_Section_GRID_RIGHT_Y,
+    Level_File_Section_GRID_SLOPE,
+    Level_File_Section_GRID_IDS,
+    Level_File_Section_COUNT
+} Level_File_Section;
+
+typedef struct {
+    uint64_t offset; // from the start of the file, a multiple of `LEVEL_FILE_ALIGNMENT`
+    uint64_t size;
+} Level_File_Range;
+
+// The start of every level file. Everything after it is in the sections,
+// found through `sections` rather than pointers, so the file can be used
+// straight out of memory wherever it's mapped.
+//
+// NOTE: Records are the game's own structs, so they're only any good to a
+//       build that lays them out the same way. The record sizes are there
+//       to catch one that doesn't and `level_file.c` asserts the layout it
+//       expects. Everything is little-endian.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t joint_size;
+    uint32_t node_size;
+    uint32_t edge_size;
+    uint32_t interactable_size;
+    uint32_t num_joints;
+    uint32_t num_predecessors;
+    uint32_t num_landmarks;
+    uint32_t num_interactables;
+    uint32_t num_profiles;
+    float grid_origin_x;
+    float grid_origin_y;
+    float grid_cell_size;
+    uint32_t grid_num_columns;
+    uint32_t grid_num_rows;
+    uint32_t grid_lane_count;  // `LEVEL_FLOOR_LANE_COUNT` the cells were padded out to
+    uint32_t num_grid_floors;
+    uint32_t reserved;
+    uint64_t file_size;
+    Level_File_Range sections[Level_File_Section_COUNT];
+} Level_File_Header;
+
+// A level file mapped into memory.
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    const Level_File_Header *header;
+} Level_File;
+
+// Writes out `level` as it is now, along with `interactables`.
+bool level_file_save(const char *path, Level_Geometry *level, Level_Interactables *interactables);
+
+// Maps the file at `path` and checks it's one this build can use. Logs why
+// and returns false if it isn't.
+bool level_file_open(const char *path, Level_File *file);
+// The file has to stay open for as long as anything made from it is used.
+void level_file_close(Level_File *file);
+
+// The level and interactables in the file, used where they are. Changing
+// a lock or an interactable only touches this process' copy of the page,
+// and changing a connection copies the graph out of the file first.
+//
+// NOTE: The floor grid is only used if this build tests as many floors at
+//       once as the one that wrote it, otherwise it's built again.
+Level_Geometry level_file_geometry(Level_File *file, Level_Geometry_Options options);
+Level_Interactables level_file_interactables(Level_File *file);
+
+#endif
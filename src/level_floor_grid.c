@@ -0,0 +1,335 @@
+#include "level_floor_grid.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <raymath.h>
+
+#include "level_geometry.h"
+
+static int floor_grid_column(Level_Floor_Grid *grid, float x) {
+    return (int)floorf((x - grid->origin.x) / grid->cell_size);
+}
+
+static int floor_grid_row(Level_Floor_Grid *grid, float y) {
+    return (int)floorf((y - grid->origin.y) / grid->cell_size);
+}
+
+// The cells the bounds of `a` to `b` overlap, as
+// `{ first column, first row, last column, last row }`. The bounds are
+// closed so a point right on the edge of a cell still finds the floor.
+static void floor_grid_bounds(Level_Floor_Grid *grid, Vector2 a, Vector2 b, int bounds[4]) {
+    bounds[0] = floor_grid_column(grid, fminf(a.x, b.x));
+    bounds[1] = floor_grid_row(grid, fminf(a.y, b.y));
+    bounds[2] = floor_grid_column(grid, fmaxf(a.x, b.x));
+    bounds[3] = floor_grid_row(grid, fmaxf(a.y, b.y));
+}
+
+static void floor_grid_pack(Level_Geometry *level) {
+    Level_Floor_Grid *grid = &level->floor_grid;
+    Level_Floor_Segments *floors = &grid->floors;
+    level_floor_segments_clear(floors);
+
+    size_t num_cells = (size_t)grid->num_columns * grid->num_rows;
+    for (size_t i = 0; i < num_cells; ++i) {
+        grid->cell_offsets[i] = floors->count;
+        vec_foreach(int, segment, grid->cells[i]) {
+            Vector2 a = level->joints[FLOOR_EDGE_JOINT(*segment)].position;
+            Vector2 b = level->joints[level_edge_other(level, *segment)].position;
+            level_floor_segments_append(floors, a, b, *segment);
+        }
+        level_floor_segments_pad(floors);
+    }
+    grid->cell_offsets[num_cells] = floors->count;
+}
+
+// Packs cell `cell` again after its floors have changed. The cells after it
+// only move along if it needs a different number of lanes.
+static void floor_grid_repack_cell(Level_Geometry *level, int cell) {
+    Level_Floor_Grid *grid = &level->floor_grid;
+    Vec_int *segments = &grid->cells[cell];
+
+    size_t begin = grid->cell_offsets[cell];
+    size_t end = grid->cell_offsets[cell + 1];
+    size_t count = (segments->count + LEVEL_FLOOR_LANE_COUNT - 1) / LEVEL_FLOOR_LANE_COUNT * LEVEL_FLOOR_LANE_COUNT;
+    if (count != end - begin) {
+        level_floor_segments_splice(&grid->floors, begin, end, count);
+
+        int shift = (int)count - (int)(end - begin);
+        size_t num_cells = (size_t)grid->num_columns * grid->num_rows;
+        for (size_t i = cell + 1; i <= num_cells; ++i) {
+            grid->cell_offsets[i] += shift;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (i >= segments->count) {
+            level_floor_segments_set_padding(&grid->floors, begin + i);
+            continue;
+        }
+
+        int segment = segments->items[i];
+        Vector2 a = level->joints[FLOOR_EDGE_JOINT(segment)].position;
+        Vector2 b = level->joints[level_edge_other(level, segment)].position;
+        level_floor_segments_set(&grid->floors, begin + i, a, b, segment);
+    }
+}
+
+void level_floor_grid_build(Level_Geometry *level) {
+    Level_Floor_Grid *grid = &level->floor_grid;
+    level_floor_grid_free(grid);
+
+    size_t num_segments = 0;
+    float total_extent = 0.f;
+    for (size_t i = 0; i < level->num_joints; ++i) {
+        Geometry_Joint *joint = &level->joints[i];
+        for (int side = 0; side < JOINT_COUNT; ++side) {
+            for (int kind = 0; kind < CONN_COUNT; ++kind) {
+                int other = joint->connections[side].connections[kind];
+                if (other == -1) continue;
+
+                Vector2 delta = Vector2Subtract(level->joints[other].position, joint->position);
+                total_extent += fmaxf(fabsf(delta.x), fabsf(delta.y));
+                ++num_segments;
+            }
+        }
+    }
+    if (num_segments == 0) return;
+
+    // NOTE: Cells about as big as a floor keep every floor down to a few
+    //       cells and every cell down to a few floors.
+    Vector2 size = Vector2Subtract(level->max_extents, level->min_extents);
+    grid->origin = level->min_extents;
+    grid->cell_size = fmaxf(total_extent / num_segments, 1.f);
+    for (;;) {
+        grid->num_columns = (int)floorf(size.x / grid->cell_size) + 1;
+        grid->num_rows = (int)floorf(size.y / grid->cell_size) + 1;
+        if ((size_t)grid->num_columns * grid->num_rows <= LEVEL_FLOOR_GRID_MAX_CELLS) break;
+        grid->cell_size *= 2.f;
+    }
+    grid->cells = calloc((size_t)grid->num_columns * grid->num_rows, sizeof(Vec_int));
+    grid->cell_offsets = malloc(((size_t)grid->num_columns * grid->num_rows + 1) * sizeof(int));
+
+    // Going through them in order leaves every cell sorted.
+    size_t num_ids = level->num_joints * JOINT_ALL_CONN_COUNT;
+    for (size_t segment = 0; segment < num_ids; ++segment) {
+        int other = level_edge_other(level, segment);
+        if (other == -1) continue;
+
+        int bounds[4];
+        floor_grid_bounds(grid, level->joints[FLOOR_EDGE_JOINT(segment)].position, level->joints[other].position, bounds);
+        for (int row = bounds[1]; row <= bounds[3]; ++row) {
+            for (int column = bounds[0]; column <= bounds[2]; ++column) {
+                vec_append(&grid->cells[row * grid->num_columns + column], (int)segment);
+            }
+        }
+    }
+
+    floor_grid_pack(level);
+}
+
+void level_floor_grid_free(Level_Floor_Grid *grid) {
+    if (grid->cells) {
+        size_t num_cells = (size_t)grid->num_columns * grid->num_rows;
+        for (size_t i = 0; i < num_cells; ++i) {
+            vec_free(&grid->cells[i]);
+        }
+        free(grid->cells);
+    }
+    if (!grid->mapped) {
+        free(grid->cell_offsets);
+        level_floor_segments_free(&grid->floors);
+    }
+    *grid = (Level_Floor_Grid){0};
+}
+
+void level_floor_grid_update(Level_Geometry *level, int joint, int side, int kind, int old_other) {
+    Level_Floor_Grid *grid = &level->floor_grid;
+    int segment = FLOOR_EDGE(joint, side, kind);
+    int other = level->joints[joint].connections[side].connections[kind];
+
+    // NOTE: Only a level that started without any floors has no grid yet,
+    //       and one mapped from a level file has no cells until now.
+    if (!grid->cells) {
+        level_floor_grid_build(level);
+        return;
+    }
+
+    Vector2 position = level->joints[joint].position;
+    int bounds[4];
+    if (old_other != -1) {
+        floor_grid_bounds(grid, position, level->joints[old_other].position, bounds);
+        for (int row = bounds[1]; row <= bounds[3]; ++row) {
+            for (int column = bounds[0]; column <= bounds[2]; ++column) {
+                Vec_int *cell = &grid->cells[row * grid->num_columns + column];
+                int index = vec_find(*cell, segment);
+                if (index == -1) continue;
+
+                vec_remove_ordered(cell, index);
+                floor_grid_repack_cell(level, row * grid->num_columns + column);
+            }
+        }
+    }
+
+    if (other != -1) {
+        floor_grid_bounds(grid, position, level->joints[other].position, bounds);
+        for (int row = bounds[1]; row <= bounds[3]; ++row) {
+            for (int column = bounds[0]; column <= bounds[2]; ++column) {
+                Vec_int *cell = &grid->cells[row * grid->num_columns + column];
+                size_t index = 0;
+                while (index < cell->count && cell->items[index] < segment) ++index;
+                vec_insert_ordered(cell, index, segment);
+                floor_grid_repack_cell(level, row * grid->num_columns + column);
+            }
+        }
+    }
+}
+
+int level_floor_grid_cell(Level_Floor_Grid *grid, Vector2 position) {
+    if (!grid->cell_offsets) return -1;
+
+    int column = floor_grid_column(grid, position.x);
+    int row = floor_grid_row(grid, position.y);
+    if (column < 0 || column >= grid->num_columns) return -1;
+    if (row < 0 || row >= grid->num_rows) return -1;
+
+    return row * grid->num_columns + column;
+}
+
+int level_floor_grid_nearest(Level_Floor_Grid *grid, Vector2 position, float tolerance) {
+    if (!grid->cell_offsets) return -1;
+
+    Vector2 reach = { tolerance, tolerance };
+    int bounds[4];
+    floor_grid_bounds(grid, Vector2Subtract(position, reach), Vector2Add(position, reach), bounds);
+    bounds[0] = bounds[0] < 0 ? 0 : bounds[0];
+    bounds[1] = bounds[1] < 0 ? 0 : bounds[1];
+    bounds[2] = bounds[2] >= grid->num_columns ? grid->num_columns - 1 : bounds[2];
+    bounds[3] = bounds[3] >= grid->num_rows ? grid->num_rows - 1 : bounds[3];
+
+    Level_Floor_Segments *floors = &grid->floors;
+    int best = -1;
+    float best_distance_sqr = tolerance * tolerance;
+
+    for (int row = bounds[1]; row <= bounds[3]; ++row) {
+        for (int column = bounds[0]; column <= bounds[2]; ++column) {
+            int cell = row * grid->num_columns + column;
+            for (int i = grid->cell_offsets[cell]; i < grid->cell_offsets[cell + 1]; ++i) {
+                int id = floors->ids[i];
+                if (id == -1 || FLOOR_EDGE_KIND(id) == CONN_FALL) continue;
+
+                Vector2 left = { floors->left_x[i], floors->left_y[i] };
+                Vector2 along = { floors->right_x[i] - left.x, floors->right_y[i] - left.y };
+                Vector2 offset = Vector2Subtract(position, left);
+                float length_sqr = Vector2LengthSqr(along);
+                float t = length_sqr == 0.f ? 0.f : Clamp(Vector2DotProduct(offset, along) / length_sqr, 0.f, 1.f);
+
+                float distance_sqr = Vector2LengthSqr(Vector2Subtract(offset, Vector2Scale(along, t)));
+                // Ties go to the lowest edge so the answer doesn't depend
+                // on which cell saw it first.
+                bool closer = best == -1
+                    ? distance_sqr <= best_distance_sqr
+                    : distance_sqr < best_distance_sqr || (distance_sqr == best_distance_sqr && id < best);
+                if (closer) {
+                    best = id;
+                    best_distance_sqr = distance_sqr;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+// Where along `from` to `to` it crosses floor `i`, or a NaN if it doesn't.
+static float floor_grid_crossing(Level_Floor_Segments *floors, int i, Vector2 from, Vector2 delta) {
+    Vector2 left = { floors->left_x[i], floors->left_y[i] };
+    Vector2 along = { floors->right_x[i] - left.x, floors->right_y[i] - left.y };
+    Vector2 offset = Vector2Subtract(left, from);
+
+    float denominator = delta.x * along.y - delta.y * along.x;
+    if (denominator == 0.f) return NAN;
+
+    float t = (offset.x * along.y - offset.y * along.x) / denominator;
+    float u = (offset.x * delta.y - offset.y * delta.x) / denominator;
+    if (t < 0.f || t > 1.f || u < 0.f || u > 1.f) return NAN;
+    return t;
+}
+
+int level_floor_grid_raycast(Level_Floor_Grid *grid, Vector2 from, Vector2 to, float *t) {
+    if (!grid->cell_offsets) return -1;
+
+    Vector2 delta = Vector2Subtract(to, from);
+    float from_axes[2] = { from.x, from.y };
+    float delta_axes[2] = { delta.x, delta.y };
+    float grid_min[2] = { grid->origin.x, grid->origin.y };
+    float grid_max[2] = {
+        grid->origin.x + grid->num_columns * grid->cell_size,
+        grid->origin.y + grid->num_rows * grid->cell_size
+    };
+
+    // Only the part of the segment over the grid can cross anything.
+    float t_enter = 0.f;
+    float t_exit = 1.f;
+    for (int axis = 0; axis < 2; ++axis) {
+        if (delta_axes[axis] == 0.f) {
+            if (from_axes[axis] < grid_min[axis] || from_axes[axis] > grid_max[axis]) return -1;
+            continue;
+        }
+
+        float t0 = (grid_min[axis] - from_axes[axis]) / delta_axes[axis];
+        float t1 = (grid_max[axis] - from_axes[axis]) / delta_axes[axis];
+        t_enter = fmaxf(t_enter, fminf(t0, t1));
+        t_exit = fminf(t_exit, fmaxf(t0, t1));
+    }
+    if (t_enter > t_exit) return -1;
+
+    Vector2 start = Vector2Add(from, Vector2Scale(delta, t_enter));
+    int column = Clamp(floor_grid_column(grid, start.x), 0, grid->num_columns - 1);
+    int row = Clamp(floor_grid_row(grid, start.y), 0, grid->num_rows - 1);
+
+    int step_column = delta.x > 0.f ? 1 : -1;
+    int step_row = delta.y > 0.f ? 1 : -1;
+    float next_x = grid->origin.x + (column + (step_column > 0)) * grid->cell_size;
+    float next_y = grid->origin.y + (row + (step_row > 0)) * grid->cell_size;
+    float t_next_column = delta.x == 0.f ? INFINITY : (next_x - from.x) / delta.x;
+    float t_next_row = delta.y == 0.f ? INFINITY : (next_y - from.y) / delta.y;
+    float t_column = delta.x == 0.f ? INFINITY : grid->cell_size / fabsf(delta.x);
+    float t_row = delta.y == 0.f ? INFINITY : grid->cell_size / fabsf(delta.y);
+
+    Level_Floor_Segments *floors = &grid->floors;
+    int best = -1;
+    float best_t = INFINITY;
+
+    for (;;) {
+        int cell = row * grid->num_columns + column;
+        for (int i = grid->cell_offsets[cell]; i < grid->cell_offsets[cell + 1]; ++i) {
+            int id = floors->ids[i];
+            if (id == -1 || FLOOR_EDGE_KIND(id) == CONN_FALL) continue;
+
+            float crossing = floor_grid_crossing(floors, i, from, delta);
+            if (crossing < best_t) {
+                best = id;
+                best_t = crossing;
+            }
+        }
+
+        // A floor crossed further on than this cell might still be beaten
+        // by one in a cell that comes after it.
+        float t_leave = fminf(t_next_column, t_next_row);
+        if (best_t <= t_leave || t_leave > t_exit) break;
+
+        if (t_next_column < t_next_row) {
+            column += step_column;
+            t_next_column += t_column;
+            if (column < 0 || column >= grid->num_columns) break;
+        } else {
+            row += step_row;
+            t_next_row += t_row;
+            if (row < 0 || row >= grid->num_rows) break;
+        }
+    }
+
+    if (best != -1) *t = best_t;
+    return best;
+}
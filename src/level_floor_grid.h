@@ -0,0 +1,65 @@
+#ifndef LEVEL_FLOOR_GRID_H_
+#define LEVEL_FLOOR_GRID_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <raylib.h>
+
+#include "level_floor_segments.h"
+#include "vec.h"
+
+typedef struct Level_Geometry Level_Geometry;
+
+// Past this the cells are made bigger, however long the floors are.
+#define LEVEL_FLOOR_GRID_MAX_CELLS (1 << 20)
+
+// A uniform grid over the level's floors so finding the floor under a point
+// only looks at the floors whose bounds overlap the point's cell.
+//
+// A floor is named by its edge number (see `FLOOR_EDGE`) and every cell
+// keeps them in that order. That's the order `level_find_floor` used to scan them
+// in, so a point on more than one floor (e.g. a joint) still finds the same
+// one.
+//
+// NOTE: `cells` is what gets changed when a connection does. `floors` is a
+//       copy of every cell one after the other, padded out to whole lanes,
+//       that lookups actually scan. A change only packs the cells the
+//       connection covers again, shifting the rest along when one of them
+//       needs a different number of lanes.
+typedef struct {
+    Vector2 origin;
+    float cell_size;
+    int num_columns;
+    int num_rows;
+    Vec_int *cells;               // `cells[row * num_columns + column]`
+    int *cell_offsets;            // `floors[cell_offsets[c]..cell_offsets[c + 1]]` are cell `c`'s
+    Level_Floor_Segments floors;  // `ids` are the edges
+    bool mapped;                  // `cell_offsets` and `floors` point into a level file, `cells` is made on the first change
+} Level_Floor_Grid;
+
+void level_floor_grid_build(Level_Geometry *level);
+void level_floor_grid_free(Level_Floor_Grid *grid);
+// Moves a connection of `joint` that used to lead to `old_other` (-1 if it
+// didn't exist) to wherever it leads now.
+void level_floor_grid_update(Level_Geometry *level, int joint, int side, int kind, int old_other);
+
+// The cell whose floors might contain `position`, -1 if it's outside the
+// grid.
+int level_floor_grid_cell(Level_Floor_Grid *grid, Vector2 position);
+// The edge of the floor closest to `position`, leaving out falls, as long
+// as it's no more than `tolerance` away. -1 otherwise.
+int level_floor_grid_nearest(Level_Floor_Grid *grid, Vector2 position, float tolerance);
+// The edge of the first floor the segment from `from` to `to` crosses,
+// leaving out falls, with how far along the segment it was crossed in `t`.
+// -1 if it doesn't cross any. Floors the segment runs exactly along don't
+// count.
+//
+// NOTE: Walks the cells the segment passes through in order and stops at
+//       the first one the closest crossing so far is inside, so a short
+//       segment only ever looks at the few floors around it.
+//
+// RESEARCH: http://www.cse.yorku.ca/~amana/research/grid.pdf
+int level_floor_grid_raycast(Level_Floor_Grid *grid, Vector2 from, Vector2 to, float *t);
+
+#endif
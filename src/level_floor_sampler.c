@@ -0,0 +1,263 @@
+#include "level_floor_sampler.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "level_geometry.h"
+
+// Vose's method over `weights[0..count]`. `small` and `large` are scratch
+// space for `count` ints each.
+static void floor_sampler_build_table(float *weights, size_t count, float *probability, int *alias, int *small, int *large) {
+    if (count == 0) return;
+
+    float total = 0.f;
+    for (size_t i = 0; i < count; ++i) {
+        total += weights[i];
+    }
+
+    size_t num_small = 0;
+    size_t num_large = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // NOTE: Floors with no length at all are as likely as each other,
+        //       rather than dividing by zero.
+        probability[i] = total > 0.f ? weights[i] * count / total : 1.f;
+        alias[i] = i;
+        if (probability[i] < 1.f) small[num_small++] = i;
+        else large[num_large++] = i;
+    }
+
+    while (num_small > 0 && num_large > 0) {
+        int s = small[--num_small];
+        int l = large[--num_large];
+
+        alias[s] = l;
+        probability[l] -= 1.f - probability[s];
+        if (probability[l] < 1.f) small[num_small++] = l;
+        else large[num_large++] = l;
+    }
+
+    // Whatever is left over is only short of 1 by rounding.
+    while (num_large > 0) probability[large[--num_large]] = 1.f;
+    while (num_small > 0) probability[small[--num_small]] = 1.f;
+}
+
+// The floor from `joint` along `side` and `kind`, or -1 if there isn't one
+// or it's counted from its other end.
+static int floor_sampler_floor(Level_Geometry *level, int joint, int side, int kind) {
+    if (level->joints[joint].connections[side].connections[kind] == -1) return -1;
+
+    int edge = FLOOR_EDGE(joint, side, kind);
+    if (level_floor_position_canonical(level, (Floor_Position){ .edge = edge }).edge != edge) return -1;
+    return edge;
+}
+
+void level_floor_sampler_build(Level_Geometry *level) {
+    Level_Floor_Sampler *sampler = &level->floor_sampler;
+    Pathfind_Reachability *reachability = &level->reachability;
+    level_floor_sampler_free(sampler);
+
+    size_t num_floors = 0;
+    size_t num_in_components = 0;
+    int *floors = malloc(level->num_joints * JOINT_COUNT * CONN_FALL * sizeof(int));
+    int *floor_components = malloc(level->num_joints * JOINT_COUNT * CONN_FALL * sizeof(int));
+
+    for (size_t i = 0; i < level->num_joints; ++i) {
+        for (int side = 0; side < JOINT_COUNT; ++side) {
+            for (int kind = 0; kind < CONN_FALL; ++kind) {
+                int edge = floor_sampler_floor(level, i, side, kind);
+                if (edge == -1) continue;
+
+                int other = level->joints[i].connections[side].connections[kind];
+                int component = -1;
+                if (reachability->node_component && reachability->node_component[i] == reachability->node_component[other]) {
+                    component = reachability->node_component[i];
+                    ++num_in_components;
+                }
+
+                floors[num_floors] = edge;
+                floor_components[num_floors] = component;
+                ++num_floors;
+            }
+        }
+    }
+
+    size_t num_slots = num_floors + num_in_components;
+    sampler->num_floors = num_floors;
+    sampler->edges = malloc(num_slots * sizeof(int));
+    sampler->probability = malloc(num_slots * sizeof(float));
+    sampler->alias = malloc(num_slots * sizeof(int));
+    memcpy(sampler->edges, floors, num_floors * sizeof(int));
+
+    if (reachability->node_component) {
+        size_t num_components = reachability->num_components;
+        sampler->num_components = num_components;
+        sampler->component_offsets = calloc(num_components + 1, sizeof(int));
+
+        for (size_t i = 0; i < num_floors; ++i) {
+            if (floor_components[i] != -1) ++sampler->component_offsets[floor_components[i] + 1];
+        }
+        for (size_t c = 0; c < num_components; ++c) {
+            sampler->component_offsets[c + 1] += sampler->component_offsets[c];
+        }
+
+        int *next = malloc(num_components * sizeof(int));
+        memcpy(next, sampler->component_offsets, num_components * sizeof(int));
+        for (size_t i = 0; i < num_floors; ++i) {
+            if (floor_components[i] == -1) continue;
+            sampler->edges[num_floors + next[floor_components[i]]++] = floors[i];
+        }
+        free(next);
+    }
+
+    float *weights = malloc(num_slots * sizeof(float));
+    int *small = malloc(num_slots * sizeof(int));
+    int *large = malloc(num_slots * sizeof(int));
+    for (size_t i = 0; i < num_slots; ++i) {
+        weights[i] = level_edge_length(level, sampler->edges[i]);
+    }
+
+    floor_sampler_build_table(weights, num_floors, sampler->probability, sampler->alias, small, large);
+    for (size_t c = 0; c < sampler->num_components; ++c) {
+        size_t begin = num_floors + sampler->component_offsets[c];
+        size_t count = sampler->component_offsets[c + 1] - sampler->component_offsets[c];
+        floor_sampler_build_table(&weights[begin], count, &sampler->probability[begin], &sampler->alias[begin], small, large);
+    }
+
+    free(weights);
+    free(small);
+    free(large);
+    free(floors);
+    free(floor_components);
+}
+
+void level_floor_sampler_update(Level_Geometry *level, Pathfind_Reachability_Renumbering renumbering) {
+    Level_Floor_Sampler *sampler = &level->floor_sampler;
+    Pathfind_Reachability *reachability = &level->reachability;
+    if (!sampler->component_offsets) return;
+
+    int first = renumbering.first;
+    int num_old = renumbering.old_last - first + 1;
+    int num_new = renumbering.new_last - first + 1;
+    assert(sampler->num_components + num_new - num_old == reachability->num_components);
+
+    // The floors with both ends in one of the new components, each end
+    // being one of their joints.
+    int begin_joint = reachability->component_offsets[first];
+    int end_joint = reachability->component_offsets[renumbering.new_last + 1];
+    int *floors = malloc((end_joint - begin_joint) * JOINT_COUNT * CONN_FALL * sizeof(int));
+    int *counts = calloc(num_new + 1, sizeof(int));
+    int num_floors = 0;
+
+    for (int i = begin_joint; i < end_joint; ++i) {
+        int joint = reachability->component_joints[i];
+        int component = reachability->node_component[joint];
+        for (int side = 0; side < JOINT_COUNT; ++side) {
+            for (int kind = 0; kind < CONN_FALL; ++kind) {
+                int edge = floor_sampler_floor(level, joint, side, kind);
+                if (edge == -1) continue;
+
+                int other = level->joints[joint].connections[side].connections[kind];
+                if (reachability->node_component[other] != component) continue;
+
+                floors[num_floors++] = edge;
+                ++counts[component - first + 1];
+            }
+        }
+    }
+    for (int c = 0; c < num_new; ++c) {
+        counts[c + 1] += counts[c];
+    }
+
+    // NOTE: Aliases are counted from the start of their table, so the
+    //       tables either side of the new ones are only moved.
+    size_t num_components = reachability->num_components;
+    int *old_offsets = sampler->component_offsets;
+    int range_begin = old_offsets[first];
+    int range_end = old_offsets[first + num_old];
+    int shift = num_floors - (range_end - range_begin);
+    size_t num_after = old_offsets[sampler->num_components] - range_end;
+    size_t num_slots = sampler->num_floors + old_offsets[sampler->num_components] + shift;
+
+    int *offsets = malloc((num_components + 1) * sizeof(int));
+    memcpy(offsets, old_offsets, (first + 1) * sizeof(int));
+    for (int c = 0; c < num_new; ++c) {
+        offsets[first + c] = range_begin + counts[c];
+    }
+    for (size_t c = first + num_old; c <= sampler->num_components; ++c) {
+        offsets[c + num_new - num_old] = old_offsets[c] + shift;
+    }
+
+    size_t after = sampler->num_floors + range_end;
+    if (shift > 0) {
+        sampler->edges = realloc(sampler->edges, num_slots * sizeof(int));
+        sampler->probability = realloc(sampler->probability, num_slots * sizeof(float));
+        sampler->alias = realloc(sampler->alias, num_slots * sizeof(int));
+    }
+    memmove(&sampler->edges[after + shift], &sampler->edges[after], num_after * sizeof(int));
+    memmove(&sampler->probability[after + shift], &sampler->probability[after], num_after * sizeof(float));
+    memmove(&sampler->alias[after + shift], &sampler->alias[after], num_after * sizeof(int));
+
+    int *fill = &counts[0];
+    size_t range = sampler->num_floors + range_begin;
+    for (int i = 0; i < num_floors; ++i) {
+        int c = reachability->node_component[FLOOR_EDGE_JOINT(floors[i])] - first;
+        sampler->edges[range + fill[c]++] = floors[i];
+    }
+
+    float *weights = malloc((num_floors + 1) * sizeof(float));
+    int *small = malloc((num_floors + 1) * sizeof(int));
+    int *large = malloc((num_floors + 1) * sizeof(int));
+    for (int i = 0; i < num_floors; ++i) {
+        weights[i] = level_edge_length(level, sampler->edges[range + i]);
+    }
+    for (int c = 0; c < num_new; ++c) {
+        int begin = offsets[first + c] - range_begin;
+        int count = offsets[first + c + 1] - offsets[first + c];
+        floor_sampler_build_table(&weights[begin], count, &sampler->probability[range + begin], &sampler->alias[range + begin], small, large);
+    }
+
+    free(weights);
+    free(small);
+    free(large);
+    free(floors);
+    free(counts);
+    free(old_offsets);
+    sampler->component_offsets = offsets;
+    sampler->num_components = num_components;
+}
+
+void level_floor_sampler_free(Level_Floor_Sampler *sampler) {
+    free(sampler->edges);
+    free(sampler->probability);
+    free(sampler->alias);
+    free(sampler->component_offsets);
+    *sampler = (Level_Floor_Sampler){0};
+}
+
+// A uniformly random number in [0, count). `RAND_MAX` can be as little as
+// 32767, which big levels have more floors than.
+static size_t floor_sampler_random_index(size_t count) {
+    size_t r = rand();
+    if (count > (size_t)RAND_MAX) r = r * ((size_t)RAND_MAX + 1) + rand();
+    return r % count;
+}
+
+int level_floor_sampler_edge(Level_Floor_Sampler *sampler, int component) {
+    size_t begin = 0;
+    size_t count = sampler->num_floors;
+
+    if (component != -1) {
+        if (!sampler->component_offsets) return -1;
+        assert(component >= 0 && (size_t)component < sampler->num_components);
+        begin = sampler->num_floors + sampler->component_offsets[component];
+        count = sampler->component_offsets[component + 1] - sampler->component_offsets[component];
+    }
+    if (count == 0) return -1;
+
+    size_t slot = begin + floor_sampler_random_index(count);
+    float coin = (float)rand() / ((float)RAND_MAX + 1.f);
+    if (coin >= sampler->probability[slot]) slot = begin + sampler->alias[slot];
+
+    return sampler->edges[slot];
+}
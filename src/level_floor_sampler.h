@@ -0,0 +1,46 @@
+#ifndef LEVEL_FLOOR_SAMPLER_H_
+#define LEVEL_FLOOR_SAMPLER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pathfind_reachability.h"
+
+typedef struct Level_Geometry Level_Geometry;
+
+// Alias tables over the level's floors, weighted by their length, so a
+// point picked from them is as likely to be anywhere along the floors as
+// anywhere else. Picking one is a couple of calls to `rand` however big the
+// level is.
+//
+// `slots[0..num_floors]` are a table over every floor. After them, every
+// component of `level->reachability` has a table of its own over the floors
+// with both joints in it, at `slots[num_floors + component_offsets[c]..]`.
+//
+// NOTE: A floor that can be walked both ways only goes in once, so it isn't
+//       twice as likely as one that can only be walked one way. Falls never
+//       go in at all.
+//
+// RESEARCH: https://www.keithschwarz.com/darts-dice-coins/
+typedef struct {
+    size_t num_floors;
+    int *edges;             // the floor each slot is for
+    float *probability;     // chance of keeping the slot's own floor rather than its alias
+    int *alias;             // slot to take otherwise, counted from the start of its table
+    size_t num_components;
+    int *component_offsets; // NULL without reachability
+} Level_Floor_Sampler;
+
+// Has to be built again whenever the reachability is.
+void level_floor_sampler_build(Level_Geometry *level);
+// Builds only the tables of the components `renumbering` says changed,
+// after a lock was toggled. The floors themselves, and so the table over
+// all of them, are still the same.
+void level_floor_sampler_update(Level_Geometry *level, Pathfind_Reachability_Renumbering renumbering);
+void level_floor_sampler_free(Level_Floor_Sampler *sampler);
+
+// A random floor edge from the table over `component`, or over every floor
+// if it's -1. -1 if that has no floors.
+int level_floor_sampler_edge(Level_Floor_Sampler *sampler, int component);
+
+#endif
@@ -0,0 +1,239 @@
+#include "level_floor_segments.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <raymath.h>
+
+#if LEVEL_FLOOR_LANE_COUNT == 8
+    #include <immintrin.h>
+#elif LEVEL_FLOOR_LANE_COUNT == 4 && defined(__ARM_NEON)
+    #include <arm_neon.h>
+#elif LEVEL_FLOOR_LANE_COUNT == 4
+    #include <emmintrin.h>
+#endif
+
+bool level_floor_segment_contains(Vector2 left, Vector2 right, float slope, Vector2 point) {
+    float expected = left.y + slope * (point.x - left.x);
+    float tolerance = EPSILON * fmaxf(1.f, fmaxf(fabsf(expected), fabsf(point.y)));
+
+    if (!(left.x <= point.x && point.x <= right.x)) return false;
+    if (!(fminf(left.y, right.y) - tolerance <= point.y && point.y <= fmaxf(left.y, right.y) + tolerance)) return false;
+
+    // NOTE: A floor that goes straight down is only ever as wide as its x,
+    //       which was already checked.
+    return fabsf(point.y - expected) <= tolerance || left.x == right.x;
+}
+
+float level_floor_segment_slope(Vector2 left, Vector2 right) {
+    if (left.x == right.x) return 0.f;
+    return (right.y - left.y) / (right.x - left.x);
+}
+
+void level_floor_segments_free(Level_Floor_Segments *segments) {
+    free(segments->left_x);
+    free(segments->left_y);
+    free(segments->right_x);
+    free(segments->right_y);
+    free(segments->slope);
+    free(segments->ids);
+    *segments = (Level_Floor_Segments){0};
+}
+
+void level_floor_segments_clear(Level_Floor_Segments *segments) {
+    segments->count = 0;
+}
+
+static void floor_segments_reserve(Level_Floor_Segments *segments, size_t count) {
+    if (count > segments->allocated) {
+        size_t allocated = segments->allocated == 0 ? 64 : segments->allocated * 2;
+        while (allocated < count) allocated *= 2;
+        segments->left_x = realloc(segments->left_x, allocated * sizeof(float));
+        segments->left_y = realloc(segments->left_y, allocated * sizeof(float));
+        segments->right_x = realloc(segments->right_x, allocated * sizeof(float));
+        segments->right_y = realloc(segments->right_y, allocated * sizeof(float));
+        segments->slope = realloc(segments->slope, allocated * sizeof(float));
+        segments->ids = realloc(segments->ids, allocated * sizeof(int));
+        segments->allocated = allocated;
+    }
+}
+
+static void floor_segments_write(Level_Floor_Segments *segments, size_t i, float left_x, float left_y, float right_x, float right_y, float slope, int id) {
+    segments->left_x[i] = left_x;
+    segments->left_y[i] = left_y;
+    segments->right_x[i] = right_x;
+    segments->right_y[i] = right_y;
+    segments->slope[i] = slope;
+    segments->ids[i] = id;
+}
+
+static void floor_segments_push(Level_Floor_Segments *segments, float left_x, float left_y, float right_x, float right_y, float slope, int id) {
+    floor_segments_reserve(segments, segments->count + 1);
+    floor_segments_write(segments, segments->count++, left_x, left_y, right_x, right_y, slope, id);
+}
+
+void level_floor_segments_set(Level_Floor_Segments *segments, size_t i, Vector2 a, Vector2 b, int id) {
+    Vector2 left = a;
+    Vector2 right = b;
+    if (b.x < a.x) {
+        left = b;
+        right = a;
+    }
+
+    float slope = level_floor_segment_slope(left, right);
+    floor_segments_write(segments, i, left.x, left.y, right.x, right.y, slope, id);
+}
+
+void level_floor_segments_set_padding(Level_Floor_Segments *segments, size_t i) {
+    floor_segments_write(segments, i, NAN, NAN, NAN, NAN, NAN, -1);
+}
+
+void level_floor_segments_append(Level_Floor_Segments *segments, Vector2 a, Vector2 b, int id) {
+    floor_segments_reserve(segments, segments->count + 1);
+    level_floor_segments_set(segments, segments->count++, a, b, id);
+}
+
+void level_floor_segments_pad(Level_Floor_Segments *segments) {
+    while (segments->count % LEVEL_FLOOR_LANE_COUNT != 0) {
+        floor_segments_push(segments, NAN, NAN, NAN, NAN, NAN, -1);
+    }
+}
+
+void level_floor_segments_splice(Level_Floor_Segments *segments, size_t begin, size_t end, size_t count) {
+    size_t new_count = segments->count - (end - begin) + count;
+    floor_segments_reserve(segments, new_count);
+
+    size_t tail = segments->count - end;
+    memmove(&segments->left_x[begin + count], &segments->left_x[end], tail * sizeof(float));
+    memmove(&segments->left_y[begin + count], &segments->left_y[end], tail * sizeof(float));
+    memmove(&segments->right_x[begin + count], &segments->right_x[end], tail * sizeof(float));
+    memmove(&segments->right_y[begin + count], &segments->right_y[end], tail * sizeof(float));
+    memmove(&segments->slope[begin + count], &segments->slope[end], tail * sizeof(float));
+    memmove(&segments->ids[begin + count], &segments->ids[end], tail * sizeof(int));
+    segments->count = new_count;
+}
+
+int level_floor_segments_find_scalar(const Level_Floor_Segments *segments, size_t begin, size_t end, Vector2 point) {
+    for (size_t i = begin; i < end; ++i) {
+        Vector2 left = { segments->left_x[i], segments->left_y[i] };
+        Vector2 right = { segments->right_x[i], segments->right_y[i] };
+        if (level_floor_segment_contains(left, right, segments->slope[i], point)) return i;
+    }
+    return -1;
+}
+
+// NOTE: The kernel below is written once against these and they're the only
+//       part that changes between instruction sets. Comparisons are all
+//       ordered so the NaN padding never matches.
+#if LEVEL_FLOOR_LANE_COUNT == 8
+
+typedef __m256 Floor_Lanes;
+typedef __m256 Floor_Mask;
+
+static inline Floor_Lanes lanes_load(const float *p) { return _mm256_loadu_ps(p); }
+static inline Floor_Lanes lanes_set(float x) { return _mm256_set1_ps(x); }
+static inline Floor_Lanes lanes_add(Floor_Lanes a, Floor_Lanes b) { return _mm256_add_ps(a, b); }
+static inline Floor_Lanes lanes_sub(Floor_Lanes a, Floor_Lanes b) { return _mm256_sub_ps(a, b); }
+static inline Floor_Lanes lanes_mul(Floor_Lanes a, Floor_Lanes b) { return _mm256_mul_ps(a, b); }
+static inline Floor_Lanes lanes_min(Floor_Lanes a, Floor_Lanes b) { return _mm256_min_ps(a, b); }
+static inline Floor_Lanes lanes_max(Floor_Lanes a, Floor_Lanes b) { return _mm256_max_ps(a, b); }
+static inline Floor_Lanes lanes_abs(Floor_Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+static inline Floor_Mask mask_le(Floor_Lanes a, Floor_Lanes b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline Floor_Mask mask_eq(Floor_Lanes a, Floor_Lanes b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline Floor_Mask mask_and(Floor_Mask a, Floor_Mask b) { return _mm256_and_ps(a, b); }
+static inline Floor_Mask mask_or(Floor_Mask a, Floor_Mask b) { return _mm256_or_ps(a, b); }
+static inline unsigned mask_bits(Floor_Mask a) { return _mm256_movemask_ps(a); }
+
+#elif LEVEL_FLOOR_LANE_COUNT == 4 && defined(__ARM_NEON)
+
+typedef float32x4_t Floor_Lanes;
+typedef uint32x4_t Floor_Mask;
+
+static inline Floor_Lanes lanes_load(const float *p) { return vld1q_f32(p); }
+static inline Floor_Lanes lanes_set(float x) { return vdupq_n_f32(x); }
+static inline Floor_Lanes lanes_add(Floor_Lanes a, Floor_Lanes b) { return vaddq_f32(a, b); }
+static inline Floor_Lanes lanes_sub(Floor_Lanes a, Floor_Lanes b) { return vsubq_f32(a, b); }
+static inline Floor_Lanes lanes_mul(Floor_Lanes a, Floor_Lanes b) { return vmulq_f32(a, b); }
+static inline Floor_Lanes lanes_min(Floor_Lanes a, Floor_Lanes b) { return vminq_f32(a, b); }
+static inline Floor_Lanes lanes_max(Floor_Lanes a, Floor_Lanes b) { return vmaxq_f32(a, b); }
+static inline Floor_Lanes lanes_abs(Floor_Lanes a) { return vabsq_f32(a); }
+static inline Floor_Mask mask_le(Floor_Lanes a, Floor_Lanes b) { return vcleq_f32(a, b); }
+static inline Floor_Mask mask_eq(Floor_Lanes a, Floor_Lanes b) { return vceqq_f32(a, b); }
+static inline Floor_Mask mask_and(Floor_Mask a, Floor_Mask b) { return vandq_u32(a, b); }
+static inline Floor_Mask mask_or(Floor_Mask a, Floor_Mask b) { return vorrq_u32(a, b); }
+static inline unsigned mask_bits(Floor_Mask a) {
+    // NEON has no movemask, so weigh each lane by its bit and add them up.
+    const uint32x4_t weights = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(a, weights));
+}
+
+#elif LEVEL_FLOOR_LANE_COUNT == 4
+
+typedef __m128 Floor_Lanes;
+typedef __m128 Floor_Mask;
+
+static inline Floor_Lanes lanes_load(const float *p) { return _mm_loadu_ps(p); }
+static inline Floor_Lanes lanes_set(float x) { return _mm_set1_ps(x); }
+static inline Floor_Lanes lanes_add(Floor_Lanes a, Floor_Lanes b) { return _mm_add_ps(a, b); }
+static inline Floor_Lanes lanes_sub(Floor_Lanes a, Floor_Lanes b) { return _mm_sub_ps(a, b); }
+static inline Floor_Lanes lanes_mul(Floor_Lanes a, Floor_Lanes b) { return _mm_mul_ps(a, b); }
+static inline Floor_Lanes lanes_min(Floor_Lanes a, Floor_Lanes b) { return _mm_min_ps(a, b); }
+static inline Floor_Lanes lanes_max(Floor_Lanes a, Floor_Lanes b) { return _mm_max_ps(a, b); }
+static inline Floor_Lanes lanes_abs(Floor_Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+static inline Floor_Mask mask_le(Floor_Lanes a, Floor_Lanes b) { return _mm_cmple_ps(a, b); }
+static inline Floor_Mask mask_eq(Floor_Lanes a, Floor_Lanes b) { return _mm_cmpeq_ps(a, b); }
+static inline Floor_Mask mask_and(Floor_Mask a, Floor_Mask b) { return _mm_and_ps(a, b); }
+static inline Floor_Mask mask_or(Floor_Mask a, Floor_Mask b) { return _mm_or_ps(a, b); }
+static inline unsigned mask_bits(Floor_Mask a) { return _mm_movemask_ps(a); }
+
+#endif
+
+#if LEVEL_FLOOR_LANE_COUNT > 1
+
+// `level_floor_segment_contains` on a lane's worth of floors at a time.
+int level_floor_segments_find(const Level_Floor_Segments *segments, size_t begin, size_t end, Vector2 point) {
+    Floor_Lanes x = lanes_set(point.x);
+    Floor_Lanes y = lanes_set(point.y);
+    Floor_Lanes abs_y = lanes_abs(y);
+    Floor_Lanes one = lanes_set(1.f);
+    Floor_Lanes epsilon = lanes_set(EPSILON);
+
+    for (size_t i = begin; i < end; i += LEVEL_FLOOR_LANE_COUNT) {
+        Floor_Lanes left_x = lanes_load(&segments->left_x[i]);
+        Floor_Lanes left_y = lanes_load(&segments->left_y[i]);
+        Floor_Lanes right_x = lanes_load(&segments->right_x[i]);
+        Floor_Lanes right_y = lanes_load(&segments->right_y[i]);
+        Floor_Lanes slope = lanes_load(&segments->slope[i]);
+
+        Floor_Lanes expected = lanes_add(left_y, lanes_mul(slope, lanes_sub(x, left_x)));
+        Floor_Lanes tolerance = lanes_mul(epsilon, lanes_max(one, lanes_max(lanes_abs(expected), abs_y)));
+
+        Floor_Mask in_x = mask_and(mask_le(left_x, x), mask_le(x, right_x));
+        Floor_Mask in_y = mask_and(
+            mask_le(lanes_sub(lanes_min(left_y, right_y), tolerance), y),
+            mask_le(y, lanes_add(lanes_max(left_y, right_y), tolerance))
+        );
+        Floor_Mask on_line = mask_or(
+            mask_le(lanes_abs(lanes_sub(y, expected)), tolerance),
+            mask_eq(left_x, right_x)
+        );
+
+        unsigned bits = mask_bits(mask_and(in_x, mask_and(in_y, on_line)));
+        if (bits == 0) continue;
+
+        for (int lane = 0; lane < LEVEL_FLOOR_LANE_COUNT; ++lane) {
+            if (bits & (1u << lane)) return i + lane;
+        }
+    }
+
+    return -1;
+}
+
+#else
+
+int level_floor_segments_find(const Level_Floor_Segments *segments, size_t begin, size_t end, Vector2 point) {
+    return level_floor_segments_find_scalar(segments, begin, end, point);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef LEVEL_FLOOR_SEGMENTS_H_
+#define LEVEL_FLOOR_SEGMENTS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <raylib.h>
+
+// How many floors the containment kernel tests at once. Picked at compile
+// time from what the target has, define LEVEL_FLOOR_SCALAR to test them
+// one at a time regardless.
+#if defined(LEVEL_FLOOR_SCALAR)
+    #define LEVEL_FLOOR_LANE_COUNT 1
+#elif defined(__AVX__)
+    #define LEVEL_FLOOR_LANE_COUNT 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(__ARM_NEON) && defined(__aarch64__))
+    #define LEVEL_FLOOR_LANE_COUNT 4
+#else
+    #define LEVEL_FLOOR_LANE_COUNT 1
+#endif
+
+// A structure of arrays copy of a run of floors, laid out so
+// `LEVEL_FLOOR_LANE_COUNT` of them can be tested against a point at a time.
+// `left` is the end with the smaller x, like `floor_make`. `slope` is 0 for
+// floors that go straight down.
+//
+// NOTE: Unused slots have a NaN `left_x`, which fails every comparison, so
+//       runs can be padded out to a whole number of lanes.
+typedef struct {
+    size_t count;
+    size_t allocated;
+    float *left_x;
+    float *left_y;
+    float *right_x;
+    float *right_y;
+    float *slope;
+    int *ids;       // whatever the owner uses to tell floors apart, -1 for padding
+} Level_Floor_Segments;
+
+// Whether `point` is on the floor from `left` to `right`, give or take
+// rounding. `floor_contains_point` and the kernel both go through this
+// test so they always agree.
+bool level_floor_segment_contains(Vector2 left, Vector2 right, float slope, Vector2 point);
+float level_floor_segment_slope(Vector2 left, Vector2 right);
+
+void level_floor_segments_free(Level_Floor_Segments *segments);
+void level_floor_segments_clear(Level_Floor_Segments *segments);
+void level_floor_segments_append(Level_Floor_Segments *segments, Vector2 a, Vector2 b, int id);
+// Pads the segments out to a whole number of lanes.
+void level_floor_segments_pad(Level_Floor_Segments *segments);
+// Overwrites segment `i` with the floor from `a` to `b`, or with padding.
+void level_floor_segments_set(Level_Floor_Segments *segments, size_t i, Vector2 a, Vector2 b, int id);
+void level_floor_segments_set_padding(Level_Floor_Segments *segments, size_t i);
+// Makes `segments[begin..end]` `count` long, moving everything after it
+// along. Whatever ends up in the run has to be set again.
+void level_floor_segments_splice(Level_Floor_Segments *segments, size_t begin, size_t end, size_t count);
+
+// The first of `segments[begin..end]` containing `point`, or -1 if none do.
+// `begin` and `end` have to be whole numbers of lanes apart.
+int level_floor_segments_find(const Level_Floor_Segments *segments, size_t begin, size_t end, Vector2 point);
+// Same answer one floor at a time, for comparison.
+int level_floor_segments_find_scalar(const Level_Floor_Segments *segments, size_t begin, size_t end, Vector2 point);
+
+#endif
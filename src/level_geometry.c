@@ -1,6 +1,7 @@
 #include "level_geometry.h"
 
 #include <stddef.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
@@ -10,50 +11,187 @@
 #include "draw.h"
 #include "utils.h"
 
-bool pathfind_node_is_neighbours_with(Pathfind_Node *node, Pathfind_Node *neighbour) {
+bool pathfind_node_is_neighbours_with(Pathfind_Node *node, int neighbour) {
     for (int i = 0; i < node->num_neighbours; ++i) {
-        if (node->neighbours[i] == neighbour) {
+        if (node->neighbours[i].node == neighbour) {
             return true;
         }
     }
     return false;
 }
 
-static void pathfind_node_connect(Pathfind_Node *a, Pathfind_Node *b) {
-    if (!pathfind_node_is_neighbours_with(a, b)) a->neighbours[a->num_neighbours++] = b;
-    if (!pathfind_node_is_neighbours_with(b, a)) b->neighbours[b->num_neighbours++] = a;
+static void pathfind_node_build(Pathfind_Node *node, Geometry_Joint *joints, int index) {
+    Geometry_Joint *joint = &joints[index];
+    node->position = joint->position;
+    node->num_neighbours = 0;
+
+    for (int side = 0; side < JOINT_COUNT; ++side) {
+        for (int kind = 0; kind < CONN_COUNT; ++kind) {
+            int neighbour_idx = joint->connections[side].connections[kind];
+            if (neighbour_idx == -1) continue;
+
+            Vector2 a = joint->position;
+            Vector2 b = joints[neighbour_idx].position;
+            node->neighbours[node->num_neighbours++] = (Pathfind_Edge){
+                .node = neighbour_idx,
+                .side = side,
+                .kind = kind,
+                .length = Vector2Distance(a, b),
+                .slope = a.x == b.x ? 0.f : (b.y - a.y) / (b.x - a.x),
+                .flat = a.y == b.y,
+                .locked = joint->connections[side].locked.connections[kind]
+            };
+        }
+    }
+}
+
+static void pathfinding_build_predecessors(Pathfinding *pathfinding) {
+    size_t num_nodes = pathfinding->num_nodes;
+    int *offsets = realloc(pathfinding->predecessor_offsets, (num_nodes + 1) * sizeof(int));
+    memset(offsets, 0, (num_nodes + 1) * sizeof(int));
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        Pathfind_Node *node = &pathfinding->nodes[i];
+        for (int j = 0; j < node->num_neighbours; ++j) {
+            ++offsets[node->neighbours[j].node + 1];
+        }
+    }
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    Pathfind_Edge *predecessors = realloc(pathfinding->predecessors, offsets[num_nodes] * sizeof(Pathfind_Edge));
+    int *fill = calloc(num_nodes, sizeof(int));
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        Pathfind_Node *node = &pathfinding->nodes[i];
+        for (int j = 0; j < node->num_neighbours; ++j) {
+            Pathfind_Edge edge = node->neighbours[j];
+            int to = edge.node;
+            edge.node = i;
+            predecessors[offsets[to] + fill[to]++] = edge;
+        }
+    }
+
+    free(fill);
+
+    pathfinding->predecessor_offsets = offsets;
+    pathfinding->predecessors = predecessors;
+}
+
+static float pathfind_profile_edge_cost(Pathfind_Profile profile, Pathfind_Edge edge) {
+    switch (profile) {
+        case Pathfind_Profile_NO_FALLS:
+            return edge.kind == CONN_FALL ? INFINITY : edge.length;
+        case Pathfind_Profile_AVOIDS_SLOPES:
+            return edge.kind == CONN_UP || edge.kind == CONN_DOWN ? edge.length * PATHFIND_SLOPE_COST_FACTOR : edge.length;
+        default:
+            return edge.length;
+    }
+}
+
+static void pathfinding_build_profile_costs(Pathfinding *pathfinding, size_t node) {
+    Pathfind_Node *n = &pathfinding->nodes[node];
+
+    for (int profile = 0; profile < Pathfind_Profile_COUNT; ++profile) {
+        float *costs = &pathfinding->profile_costs[(profile * pathfinding->num_nodes + node) * PATHFIND_NODE_NEIGHBOUR_COUNT];
+        for (int i = 0; i < n->num_neighbours; ++i) {
+            costs[i] = pathfind_profile_edge_cost(profile, n->neighbours[i]);
+        }
+    }
 }
 
 static Pathfinding pathfinding_make(size_t num_joints, Geometry_Joint *joints) {
-    Vec_Pathfind_Node nodes = vec_with_capacity(Pathfind_Node, num_joints);
+    Pathfind_Node *nodes = malloc(num_joints * sizeof(Pathfind_Node));
 
     for (size_t i = 0; i < num_joints; ++i) {
-        Geometry_Joint *j = &joints[i];
-        vec_append(&nodes, (Pathfind_Node){ .position = j->position });
+        pathfind_node_build(&nodes[i], joints, i);
     }
 
-    for (size_t i = 0; i < nodes.count; ++i) {
-        Geometry_Joint *j = &joints[i];
-        Pathfind_Node *n = &nodes.items[i];
+    Pathfinding pathfinding = {
+        .num_nodes = num_joints,
+        .nodes = nodes,
+        .profile_costs = malloc(Pathfind_Profile_COUNT * num_joints * PATHFIND_NODE_NEIGHBOUR_COUNT * sizeof(float))
+    };
+    pathfinding_build_predecessors(&pathfinding);
+
+    for (size_t i = 0; i < num_joints; ++i) {
+        pathfinding_build_profile_costs(&pathfinding, i);
+    }
 
-        for (size_t ci = 0; ci < JOINT_COUNT; ++ci) {
-            for (size_t cj = 0; cj < CONN_COUNT; ++cj) {
-                int neighbour_idx = j->connections[ci].connections[cj];
-                if (neighbour_idx == -1) continue;
+    return pathfinding;
+}
 
-                Pathfind_Node *neighbour = &nodes.items[neighbour_idx];
-                pathfind_node_connect(n, neighbour);
-            }
+// Which connection walking off `side` of a joint leads on to. Up or down
+// when asked for and there is one, otherwise straight on. With nothing
+// straight on, asking for down drops off the fall if there is one. A locked
+// connection stops the walk at the joint rather than picking another.
+static int floor_transition(Geometry_Joint *joint, int index, Joint_Index side, Floor_Step step) {
+    Connections *connections = &joint->connections[side];
+
+    Connection_Index kind = CONN_STRAIGHT;
+    if (step == Floor_Step_UP && connections->up != -1) kind = CONN_UP;
+    if (step == Floor_Step_DOWN && connections->down != -1) kind = CONN_DOWN;
+
+    if (connections->connections[kind] == -1) {
+        if (step == Floor_Step_DOWN && connections->fall != -1 && !connections->locked.fall) {
+            return FLOOR_EDGE(index, side, CONN_FALL);
+        }
+        return -1;
+    }
+
+    if (connections->locked.connections[kind]) return -1;
+    return FLOOR_EDGE(index, side, kind);
+}
+
+static void level_build_transitions(Level_Geometry *level, int index) {
+    Geometry_Joint *joint = &level->joints[index];
+    Floor_Transitions *transitions = &level->transitions[index];
+
+    for (int side = 0; side < JOINT_COUNT; ++side) {
+        for (int step = 0; step < Floor_Step_COUNT; ++step) {
+            transitions->next[side][step] = floor_transition(joint, index, side, step);
         }
     }
 
-    return (Pathfinding){
-        .num_nodes = nodes.count,
-        .nodes = nodes.items
+    transitions->landing =
+        joint->connections[JOINT_LEFT].straight != -1 ? FLOOR_EDGE(index, JOINT_LEFT, CONN_STRAIGHT) :
+        joint->connections[JOINT_RIGHT].straight != -1 ? FLOOR_EDGE(index, JOINT_RIGHT, CONN_STRAIGHT) :
+        -1;
+}
+
+Level_Geometry_Options level_geometry_default_options(void) {
+    return (Level_Geometry_Options){
+        .cluster_size = PATHFIND_DEFAULT_CLUSTER_SIZE,
+        .num_landmarks = PATHFIND_DEFAULT_LANDMARK_COUNT,
+        .contract_corridors = true
     };
 }
 
 Level_Geometry level_geometry_make(size_t num_joints, Geometry_Joint *joints) {
+    return level_geometry_make_with_options(num_joints, joints, level_geometry_default_options());
+}
+
+Level_Geometry level_geometry_make_with_options(size_t num_joints, Geometry_Joint *joints, Level_Geometry_Options options) {
+    return level_geometry_make_from_parts(
+        num_joints,
+        joints,
+        pathfinding_make(num_joints, joints),
+        (Pathfind_Landmarks){0},
+        (Level_Floor_Grid){0},
+        options
+    );
+}
+
+Level_Geometry level_geometry_make_from_parts(
+    size_t num_joints,
+    Geometry_Joint *joints,
+    Pathfinding pathfinding,
+    Pathfind_Landmarks landmarks,
+    Level_Floor_Grid floor_grid,
+    Level_Geometry_Options options)
+{
     Vector2 min_extents = {0};
     Vector2 max_extents = {0};
 
@@ -69,111 +207,262 @@ Level_Geometry level_geometry_make(size_t num_joints, Geometry_Joint *joints) {
         if (j->position.y > max_extents.y) max_extents.y = j->position.y;
     }
 
-    Pathfinding pathfinding = pathfinding_make(num_joints, joints);
-
-    return (Level_Geometry){
+    Level_Geometry level = {
         .min_extents = min_extents,
         .max_extents = max_extents,
         .num_joints = num_joints,
         .joints = joints,
-        .pathfinding = pathfinding
+        .pathfinding = pathfinding,
+        .landmarks = landmarks,
+        .floor_grid = floor_grid
     };
+
+    level.transitions = malloc(num_joints * sizeof(Floor_Transitions));
+    for (size_t i = 0; i < num_joints; ++i) {
+        level_build_transitions(&level, i);
+    }
+
+    if (!floor_grid.cell_offsets) {
+        level_floor_grid_build(&level);
+    }
+    pathfind_hierarchy_build(&level, options.cluster_size);
+    if (landmarks.count == 0) {
+        pathfind_landmarks_build(&level, options.num_landmarks);
+    }
+    pathfind_reachability_build(&level);
+    level_floor_sampler_build(&level);
+    if (options.contract_corridors) {
+        pathfind_corridors_build(&level);
+    }
+    level.num_workers = options.num_workers;
+
+    return level;
 }
 
-static Floor_Movement finalize_movement(Vector2 player_position, Floor floor) {
-    assert(
-        floor.left->position.x <= player_position.x &&
-        floor.right->position.x >= player_position.x
-    );
+void level_geometry_free(Level_Geometry *level) {
+    // NOTE: First, so nothing is still searching the level as it goes.
+    pathfind_service_free(level->service);
+    level->service = NULL;
 
-    float desired_y = floor.left->position.y;
-    if (!floor_is_flat(floor)) {
-        float t = ilerp(player_position.x,
-            floor.left->position.x,
-            floor.right->position.x
-        );
+    if (!level->pathfinding.mapped) {
+        free(level->pathfinding.nodes);
+        free(level->pathfinding.predecessor_offsets);
+        free(level->pathfinding.predecessors);
+        free(level->pathfinding.profile_costs);
+    }
+    level->pathfinding = (Pathfinding){0};
+    pathfind_hierarchy_free(&level->hierarchy);
+    pathfind_landmarks_free(&level->landmarks);
+    pathfind_reachability_free(&level->reachability);
+    pathfind_corridors_free(&level->corridors);
+    level_floor_grid_free(&level->floor_grid);
+    level_floor_sampler_free(&level->floor_sampler);
+    free(level->transitions);
+    level->transitions = NULL;
+    path_cache_free(&level->path_cache);
+    pathfind_pool_free(level->pool);
+    level->pool = NULL;
+    vec_free(&level->changes);
+}
+
+// Copies a joint's lock onto its edge and onto the matching predecessor.
+static void pathfinding_sync_lock(Pathfinding *pathfinding, int joint, Joint_Index side, Connection_Index kind, bool locked) {
+    Pathfind_Node *node = &pathfinding->nodes[joint];
+    for (int i = 0; i < node->num_neighbours; ++i) {
+        Pathfind_Edge *edge = &node->neighbours[i];
+        if (edge->side != side || edge->kind != kind) continue;
+
+        edge->locked = locked;
+
+        int begin = pathfinding->predecessor_offsets[edge->node];
+        int end = pathfinding->predecessor_offsets[edge->node + 1];
+        for (int j = begin; j < end; ++j) {
+            Pathfind_Edge *predecessor = &pathfinding->predecessors[j];
+            if (predecessor->node == joint && predecessor->side == side && predecessor->kind == kind) {
+                predecessor->locked = locked;
+            }
+        }
+    }
+}
+
+// Swaps arrays that point into a level file for copies of them that can be
+// grown and freed like any others.
+static void pathfinding_own(Pathfinding *pathfinding) {
+    if (!pathfinding->mapped) return;
+
+    size_t num_nodes = pathfinding->num_nodes;
+    size_t num_predecessors = pathfinding->predecessor_offsets[num_nodes];
+    size_t num_costs = Pathfind_Profile_COUNT * num_nodes * PATHFIND_NODE_NEIGHBOUR_COUNT;
+
+    pathfinding->nodes = memcpy(malloc(num_nodes * sizeof(Pathfind_Node)), pathfinding->nodes, num_nodes * sizeof(Pathfind_Node));
+    pathfinding->predecessor_offsets = memcpy(malloc((num_nodes + 1) * sizeof(int)), pathfinding->predecessor_offsets, (num_nodes + 1) * sizeof(int));
+    pathfinding->predecessors = memcpy(malloc(num_predecessors * sizeof(Pathfind_Edge)), pathfinding->predecessors, num_predecessors * sizeof(Pathfind_Edge));
+    pathfinding->profile_costs = memcpy(malloc(num_costs * sizeof(float)), pathfinding->profile_costs, num_costs * sizeof(float));
+    pathfinding->mapped = false;
+}
 
-        desired_y = lerp(
-            floor.left->position.y,
-            floor.right->position.y,
-            t
+static void level_geometry_log_change(Level_Geometry *level, int joint, bool opened) {
+    ++level->version;
+
+    // NOTE: Dropping half the log at a time keeps the shuffling rare.
+    //       Anything that falls this far behind just starts over.
+    if (level->changes.count == LEVEL_GEOMETRY_CHANGE_LOG_CAPACITY) {
+        size_t keep = LEVEL_GEOMETRY_CHANGE_LOG_CAPACITY / 2;
+        memmove(
+            level->changes.items,
+            &level->changes.items[level->changes.count - keep],
+            keep * sizeof(Level_Geometry_Change)
         );
+        level->changes.count = keep;
     }
 
-    return (Floor_Movement){
-        .falling = false,
-        .desired_position = vec2(player_position.x, desired_y),
-        .new_floor = floor
-    };
+    vec_append(&level->changes, (Level_Geometry_Change){ .version = level->version, .joint = joint, .opened = opened });
 }
 
-Floor_Movement calculate_floor_movement(
-    Level_Geometry *level,
-    Vector2 player_position,
-    Floor player_current_floor,
-    Vector2 player_movement)
-{
-    if (player_current_floor.left->position.x <= player_position.x &&
-        player_current_floor.right->position.x >= player_position.x)
-    {
-        return finalize_movement(player_position, player_current_floor);
+bool level_geometry_changes_since(Level_Geometry *level, unsigned version, size_t *first) {
+    if (version == level->version) {
+        *first = level->changes.count;
+        return true;
     }
 
-    Geometry_Joint *joint;
-    Connections *connections;
-    if (player_movement.x < 0.f) {
-        joint = player_current_floor.left;
-        connections = &joint->connections[JOINT_LEFT];
-    } else {
-        joint = player_current_floor.right;
-        connections = &joint->connections[JOINT_RIGHT];
+    Vec_Level_Geometry_Change *changes = &level->changes;
+    if (changes->count == 0 || changes->items[0].version > version + 1) {
+        return false;
+    }
+
+    *first = version + 1 - changes->items[0].version;
+    return true;
+}
+
+void level_geometry_set_locked(Level_Geometry *level, int joint, Joint_Index side, Connection_Index kind, bool locked) {
+    assert(joint >= 0 && (size_t)joint < level->num_joints);
+
+    bool *lock = &level->joints[joint].connections[side].locked.connections[kind];
+    if (*lock == locked) return;
+
+    if (level->service) pathfind_service_lock_level(level->service);
+
+    *lock = locked;
+    pathfinding_sync_lock(&level->pathfinding, joint, side, kind, locked);
+    level_build_transitions(level, joint);
+    level_geometry_log_change(level, joint, !locked);
+
+    pathfind_hierarchy_rebuild_cluster_of(level, joint);
+    int other = level->joints[joint].connections[side].connections[kind];
+    Pathfind_Reachability_Renumbering renumbering;
+    if (other != -1 && pathfind_reachability_update_connection(level, joint, other, locked, &renumbering)) {
+        level_floor_sampler_update(level, renumbering);
+    }
+    pathfind_corridors_update_locks(level, joint);
+
+    if (level->service) pathfind_service_unlock_level(level->service);
+}
+
+void level_geometry_set_connection(Level_Geometry *level, int joint, Joint_Index side, Connection_Index kind, int other) {
+    assert(joint >= 0 && (size_t)joint < level->num_joints);
+    assert(other >= -1 && other < (int)level->num_joints);
+
+    Geometry_Joint *j = &level->joints[joint];
+    if (j->connections[side].connections[kind] == other) return;
+
+    if (level->service) pathfind_service_lock_level(level->service);
+
+    int old_other = j->connections[side].connections[kind];
+    j->connections[side].connections[kind] = other;
+    pathfinding_own(&level->pathfinding);
+    level_floor_grid_update(level, joint, side, kind, old_other);
+    level_build_transitions(level, joint);
+    pathfind_node_build(&level->pathfinding.nodes[joint], level->joints, joint);
+    pathfinding_build_predecessors(&level->pathfinding);
+    pathfinding_build_profile_costs(&level->pathfinding, joint);
+    level_geometry_log_change(level, joint, other != -1);
+
+    pathfind_hierarchy_build(level, level->hierarchy.cluster_size);
+    pathfind_landmarks_build(level, level->landmarks.count);
+    pathfind_reachability_build(level);
+    level_floor_sampler_build(level);
+    if (level->corridors.edge_corridor) {
+        pathfind_corridors_build(level);
     }
 
-    Connection_Index conn_idx = -1;
-    int conn_joint_idx = -1;
-    if (player_movement.y < 0.f) {
-        conn_idx = CONN_UP;
-        conn_joint_idx = connections->up;
-    } else if (player_movement.y > 0.f) {
-        conn_idx = CONN_DOWN;
-        conn_joint_idx = connections->down;
+    if (level->service) pathfind_service_unlock_level(level->service);
+}
+
+float level_geometry_heuristic(Level_Geometry *level, int node, Vector2 end, int end_joints[2]) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    float euclidean = Vector2Distance(pathfinding->nodes[node].position, end);
+    if (level->landmarks.count == 0) return euclidean;
+
+    float best = INFINITY;
+    for (int i = 0; i < 2; ++i) {
+        int target = end_joints[i];
+        float bound = pathfind_landmarks_bound(&level->landmarks, pathfinding->num_nodes, node, target);
+        bound += Vector2Distance(pathfinding->nodes[target].position, end);
+        if (bound < best) best = bound;
     }
 
-    if (conn_joint_idx == -1) {
-        conn_idx = CONN_STRAIGHT;
-        conn_joint_idx = connections->straight;
+    return fmaxf(euclidean, best);
+}
+
+float level_edge_length(Level_Geometry *level, int edge) {
+    Pathfind_Node *node = &level->pathfinding.nodes[FLOOR_EDGE_JOINT(edge)];
+    for (int i = 0; i < node->num_neighbours; ++i) {
+        Pathfind_Edge *e = &node->neighbours[i];
+        if ((int)e->side == FLOOR_EDGE_SIDE(edge) && (int)e->kind == FLOOR_EDGE_KIND(edge)) return e->length;
     }
 
-    if (conn_joint_idx == -1 && connections->fall != -1 && !connections->locked.fall && player_movement.y > 0.f) {
-        conn_idx = CONN_FALL;
-        conn_joint_idx = connections->fall;
-        Geometry_Joint *conn = &level->joints[conn_joint_idx];
-        Geometry_Joint *other = 
-            conn->connections[JOINT_LEFT].straight != -1 ? &level->joints[conn->connections[JOINT_LEFT].straight] :
-            conn->connections[JOINT_RIGHT].straight != -1 ? &level->joints[conn->connections[JOINT_RIGHT].straight] :
-            NULL;
-        assert(other);
+    assert(false && "edge has no floor");
+    return 0.f;
+}
+
+Floor_Movement level_floor_walk(Level_Geometry *level, Floor_Position position, float dx, Floor_Step step) {
+    Floor_Movement movement = { .position = position };
 
-        Floor new_floor = floor_make(conn, other);
+    int joint = FLOOR_EDGE_JOINT(position.edge);
+    int other = level_edge_other(level, position.edge);
+    float from_x = level->joints[joint].position.x;
+    float width = level->joints[other].position.x - from_x;
+    // NOTE: Only falls go straight down, and they're never walked along.
+    if (dx == 0.f || width == 0.f) return movement;
 
-        return (Floor_Movement){
-            .falling = true,
-            .desired_position = conn->position,
-            .new_floor = new_floor
-        };
+    float t = position.t + dx / width;
+    if (t >= 0.f && t <= 1.f) {
+        movement.position.t = t;
+        return movement;
     }
 
-    if (conn_joint_idx == -1 || connections->locked.connections[conn_idx]) {
-        return (Floor_Movement){
-            .falling = false,
-            .desired_position = joint->position,
-            .new_floor = player_current_floor
-        };
+    int end = t > 1.f ? other : joint;
+    float leftover = from_x + t * width - level->joints[end].position.x;
+    movement.position.t = t > 1.f ? 1.f : 0.f;
+
+    Joint_Index side = dx < 0.f ? JOINT_LEFT : JOINT_RIGHT;
+    int next = level->transitions[end].next[side][step];
+    if (next == -1) return movement;
+
+    if (FLOOR_EDGE_KIND(next) == CONN_FALL) {
+        movement.falling = true;
+        movement.position = (Floor_Position){ .edge = next, .t = 0.f };
+        return movement;
     }
 
-    Geometry_Joint *conn = &level->joints[conn_joint_idx];
-    Floor new_floor = floor_make(joint, conn);
-    return finalize_movement(player_position, new_floor);
+    float next_width = level->joints[level_edge_other(level, next)].position.x - level->joints[end].position.x;
+    float next_t = next_width == 0.f ? 0.f : Clamp(leftover / next_width, 0.f, 1.f);
+    movement.position = (Floor_Position){ .edge = next, .t = next_t };
+    return movement;
+}
+
+bool level_floor_fall(Level_Geometry *level, Floor_Position *position, float distance) {
+    assert(FLOOR_EDGE_KIND(position->edge) == CONN_FALL);
+
+    float length = level_edge_length(level, position->edge);
+    position->t = length == 0.f ? 1.f : position->t + distance / length;
+    if (position->t < 1.f) return false;
+
+    int landing = level->transitions[level_edge_other(level, position->edge)].landing;
+    assert(landing != -1 && "fell onto a joint with nowhere to stand");
+
+    *position = (Floor_Position){ .edge = landing, .t = 0.f };
+    return true;
 }
 
 bool point_is_on_line(Vector2 p, Vector2 a, Vector2 b) {
@@ -182,209 +471,1556 @@ bool point_is_on_line(Vector2 p, Vector2 a, Vector2 b) {
     return (a.x - p.x) * (a.y - p.y) == (p.x - b.x) * (p.y - b.y);
 }
 
-static void init_pathfind_nodes(size_t num_nodes, Pathfind_Node *nodes, Vector2 goal) {
-    for (size_t i = 0; i < num_nodes; ++i) {
-        Pathfind_Node *node = &nodes[i];
-        node->comes_from = NULL;
-        node->g_score = INFINITY;
-        node->h_score = Vector2Distance(node->position, goal);
+// Where a search is allowed to stop. `joints[i * 2]` and `joints[i * 2 + 1]`
+// are the joints of the floor `points[i]` is on.
+typedef struct {
+    size_t count;
+    Vector2 *points;
+    int *joints;
+} Pathfind_Goals;
+
+// The goal `joint` belongs to, picking the closest if it belongs to a few.
+// Which is also the goal the sink was reached through when `joint` is
+// where it came from.
+static int pathfind_goals_find(Level_Geometry *level, Pathfind_Goals *goals, int joint) {
+    int found = -1;
+    float found_distance = INFINITY;
+
+    for (size_t i = 0; i < goals->count; ++i) {
+        if (goals->joints[i * 2] != joint && goals->joints[i * 2 + 1] != joint) continue;
+
+        float distance = Vector2Distance(level->joints[joint].position, goals->points[i]);
+        if (distance < found_distance) {
+            found_distance = distance;
+            found = i;
+        }
     }
+
+    return found;
 }
 
-static void pathfind_add_to_open_set(Vec_Pathfind_Node_Ptr *set, Pathfind_Node *node) {
-    size_t i;
-    for (i = 0; i < set->count; ++i) {
-        Pathfind_Node *other = set->items[i];
-        float node_f_score = node->g_score + node->h_score;
-        float other_f_score = other->g_score + other->h_score;
-        if (other_f_score > node_f_score) {
-            vec_insert_ordered(set, i, node);
-            break;
+static void pathfind_query_touch_towards(Level_Geometry *level, Pathfind_Query *query, int node, Pathfind_Goals *goals) {
+    if (pathfind_query_touch(query, node)) {
+        float h_score = INFINITY;
+        for (size_t i = 0; i < goals->count; ++i) {
+            h_score = fminf(h_score, level_geometry_heuristic(level, node, goals->points[i], &goals->joints[i * 2]));
         }
+        query->h_score[node] = h_score;
     }
+}
 
-    if (i == set->count) {
-        vec_append(set, node);
-    }
+// NOTE: A search doesn't stop at the first goal joint it expands, since
+//       the walk from there to its goal point can still cost more than
+//       going through another one. Every goal joint leads on to a sink
+//       past the end of the graph at exactly what that walk costs, and
+//       the search stops once the sink is expanded. By then nothing left
+//       in the open set can get to any of the goals for less.
+static int pathfind_search_sink(Level_Geometry *level) {
+    return level->pathfinding.num_nodes;
 }
 
-static void construct_path(Vec_Vector2 *path, Pathfind_Node *last, Vector2 end) {
-    vec_append(path, end);
-    for (Pathfind_Node *n = last; n != NULL; n = n->comes_from) {
-        vec_append(path, n->position);
+static void pathfind_search_relax_sink(Level_Geometry *level, Pathfind_Query *query, int joint, Pathfind_Goals *goals) {
+    int sink = pathfind_search_sink(level);
+    pathfind_query_touch(query, sink);
+
+    for (size_t i = 0; i < goals->count * 2; ++i) {
+        if (goals->joints[i] != joint) continue;
+
+        float walk = Vector2Distance(level->joints[joint].position, goals->points[i / 2]);
+        float tentative_g_score = query->g_score[joint] + walk;
+        if (tentative_g_score < query->g_score[sink]) {
+            query->comes_from[sink] = joint;
+            query->g_score[sink] = tentative_g_score;
+            pathfind_query_open(query, sink);
+        }
     }
 }
 
-// // RESEARCH: https://en.wikipedia.org/wiki/A*_search_algorithm
-Vec_Vector2 level_geometry_pathfind(Level_Geometry *level, Vector2 start, Vector2 end) {
-    Vec_Vector2 path = {0};
+// The joints a search skipped over by taking a corridor from `from` to
+// `to`, as a range of `corridors->joints`.
+static void corridor_skipped_joints(Pathfind_Corridors *corridors, int corridor, int from, int to, int *first, int *last) {
+    Pathfind_Corridor *c = &corridors->corridors.items[corridor];
+    int to_position = pathfind_corridors_position(corridors, corridor, to);
 
-    init_pathfind_nodes(level->pathfinding.num_nodes, level->pathfinding.nodes, end);
+    *first = c->first + pathfind_corridors_position(corridors, corridor, from) + 1;
+    *last = c->first + (to_position == -1 ? c->count : to_position);
+}
 
-    Floor starting_floor = level_find_floor(level, start);
-    assert(starting_floor.left && starting_floor.right);
+// Appends every joint walked to reach `last`, going back to the start and
+// filling in the joints skipped by corridors.
+static void pathfind_collect_joints(Level_Geometry *level, Pathfind_Query *query, int last, Vec_int *joints) {
+    for (int n = last; n != -1; n = query->comes_from[n]) {
+        vec_append(joints, n);
 
-    int starting_floor_indexes_left = starting_floor.left - level->joints;
-    int starting_floor_indexes_right = starting_floor.right - level->joints;
+        int corridor = query->comes_via[n];
+        if (corridor == -1) continue;
 
-    Floor ending_floor = level_find_floor(level, end);
-    assert(ending_floor.left && ending_floor.right);
-    if (floor_contains_point(starting_floor, end)) {
-        vec_append(&path, end);
-        return path;
+        int first, end;
+        corridor_skipped_joints(&level->corridors, corridor, query->comes_from[n], n, &first, &end);
+        for (int i = end - 1; i >= first; --i) {
+            vec_append(joints, level->corridors.joints.items[i]);
+        }
     }
+}
 
-    int ending_floor_indexes_left = ending_floor.left - level->joints;
-    int ending_floor_indexes_right = ending_floor.right - level->joints;
+// The joints walked from the start floor to `last`, in the order they're
+// walked.
+static void pathfind_found_joints(Level_Geometry *level, Pathfind_Query *query, int last, Vec_int *joints) {
+    vec_clear(joints);
+    pathfind_collect_joints(level, query, last, joints);
+
+    // `comes_from` walks backwards so flip it to go from start to end.
+    for (size_t i = 0; i < joints->count / 2; ++i) {
+        int tmp = joints->items[i];
+        joints->items[i] = joints->items[joints->count - 1 - i];
+        joints->items[joints->count - 1 - i] = tmp;
+    }
+}
 
-    Pathfind_Node *start_nodes[2] = {
-        &level->pathfinding.nodes[starting_floor_indexes_left],
-        &level->pathfinding.nodes[starting_floor_indexes_right],
+static Path_Cache_Key path_cache_key_make(Level_Geometry *level, Floor starting_floor, Floor ending_floor, Pathfind_Profile profile) {
+    return (Path_Cache_Key){
+        .start_left = starting_floor.left - level->joints,
+        .start_right = starting_floor.right - level->joints,
+        .end_left = ending_floor.left - level->joints,
+        .end_right = ending_floor.right - level->joints,
+        .profile = profile
     };
+}
 
-    Pathfind_Node *end_nodes[2] = {
-        &level->pathfinding.nodes[ending_floor_indexes_left],
-        &level->pathfinding.nodes[ending_floor_indexes_right],
-    };
-    
-    Vec_Pathfind_Node_Ptr open_set = {0};
+// Everything a thread keeps around between searches so it doesn't have to
+// allocate for every one. Freed by `pathfind_default_query_free`.
+typedef struct {
+    Pathfind_Query query;
+    Pathfind_Query backward;
+    Hierarchy_Query hierarchy;
+    Vec_int path_joints;
+    Vec_int hierarchy_joints;
+    Vec_int tail;
+} Pathfind_Scratch;
 
-    start_nodes[0]->g_score = Vector2Distance(start, level->joints[starting_floor_indexes_left].position);
-    start_nodes[1]->g_score = Vector2Distance(start, level->joints[starting_floor_indexes_right].position);
+static _Thread_local Pathfind_Scratch pathfind_scratch = {0};
 
-    pathfind_add_to_open_set(&open_set, start_nodes[0]);
-    pathfind_add_to_open_set(&open_set, start_nodes[1]);
+static void construct_path(Vec_Vector2 *path, Level_Geometry *level, Pathfind_Query *query, int last, Vector2 end) {
+    Vec_int *joints = &pathfind_scratch.path_joints;
+    vec_clear(joints);
+    pathfind_collect_joints(level, query, last, joints);
 
-    while (open_set.count != 0) {
-        Pathfind_Node *current = open_set.items[0];
-        vec_remove_ordered(&open_set, 0);
+    vec_append(path, end);
+    vec_foreach(int, joint, *joints) {
+        vec_append(path, level->joints[*joint].position);
+    }
+}
 
-        if (current == end_nodes[0] || current == end_nodes[1]) {
-            construct_path(&path, current, end);
-            break;
-        }
+static Pathfind_Query *pathfind_default_query(void) {
+    return &pathfind_scratch.query;
+}
 
-        for (int i = 0; i < current->num_neighbours; ++i) {
-            Pathfind_Node *neighbour = current->neighbours[i];
+void pathfind_default_query_free(void) {
+    pathfind_query_free(&pathfind_scratch.query);
+    pathfind_query_free(&pathfind_scratch.backward);
+    hierarchy_query_free(&pathfind_scratch.hierarchy);
+    vec_free(&pathfind_scratch.path_joints);
+    vec_free(&pathfind_scratch.hierarchy_joints);
+    vec_free(&pathfind_scratch.tail);
+}
 
-            float distance = Vector2Distance(current->position, neighbour->position);
-            float tentative_g_score = current->g_score + distance; 
+static int floor_joint_index(Level_Geometry *level, Geometry_Joint *joint) {
+    return joint - level->joints;
+}
 
-            if (tentative_g_score < neighbour->g_score) {
-                neighbour->comes_from = current;
-                neighbour->g_score = tentative_g_score;
+static void pathfind_search_relax(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    int from,
+    int to,
+    float distance,
+    int via,
+    Pathfind_Goals *goals)
+{
+    pathfind_query_touch_towards(level, query, to, goals);
+    if (query->h_score[to] == INFINITY) return; // the end can't be reached from here
+
+    float tentative_g_score = query->g_score[from] + distance;
+    if (tentative_g_score < query->g_score[to]) {
+        query->comes_from[to] = from;
+        query->comes_via[to] = via;
+        query->g_score[to] = tentative_g_score;
+        pathfind_query_open(query, to);
+    }
+}
 
-                if (vec_find(open_set, neighbour) == -1) {
-                    pathfind_add_to_open_set(&open_set, neighbour);
-                }
-            }
+// Hops from `current` to the far end of `corridor` in one go. `position`
+// is where `current` is inside the corridor, -1 if it's the corridor's
+// `from`. Nothing at or past the `blocked` step can be reached, but end
+// joints before it still can.
+static void pathfind_search_corridor(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    int current,
+    int corridor,
+    int position,
+    int blocked,
+    Pathfind_Goals *goals)
+{
+    Pathfind_Corridors *corridors = &level->corridors;
+    Pathfind_Corridor *c = &corridors->corridors.items[corridor];
+    float *offsets = &corridors->offsets.items[c->first];
+    float walked = position == -1 ? 0.f : offsets[position];
+
+    for (size_t i = 0; i < goals->count * 2; ++i) {
+        int end_position = pathfind_corridors_position(corridors, corridor, goals->joints[i]);
+        if (end_position > position && end_position < blocked) {
+            pathfind_search_relax(level, query, current, goals->joints[i], offsets[end_position] - walked, corridor, goals);
         }
     }
 
-    return path;
+    if (blocked > c->count) {
+        pathfind_search_relax(level, query, current, c->to, c->length - walked, corridor, goals);
+    }
 }
 
-Vector2 level_geometry_random_position(Level_Geometry *level) {
-    // TODO: This is a really dumb algorithm that should be replaced with
-    // something more sophisticated.
-    // BUGS:
-    //     - Can choose points that are half way down a fall connection. 
-    //
-
-    int attempts_remaining = level->num_joints * 10;
-    Vector2 destination = {0};
-
-    do {
-        int other_joint_idx = -1;
-        Geometry_Joint *joint = NULL;
-
-        while (other_joint_idx == -1 && attempts_remaining > 0) {
-            int joint_idx = rand() % level->num_joints;
-            joint = &level->joints[joint_idx];
-
-            int other_joint_attempts_remaining = JOINT_ALL_CONN_COUNT * 10;
-            while (other_joint_idx == -1 && other_joint_attempts_remaining > 0) {
-                int chosen_conn = rand() % JOINT_ALL_CONN_COUNT;
-                other_joint_idx = joint->connections[chosen_conn % 2].connections[chosen_conn / 2];
-                --other_joint_attempts_remaining;
-            }
-        }
+bool pathfind_profile_respects_locks(Pathfind_Profile profile) {
+    return profile != Pathfind_Profile_HAS_KEY;
+}
 
-        if (other_joint_idx == -1 || !joint) return (Vector2){0};
+// Sets `query` up for an A* search from `start` on `starting_floor`
+// towards `goals`. Returns false if none of them can be reached.
+//
+// NOTE: Reachability includes locks, so it can only rule paths out for
+//       profiles that respect them. It doesn't know about falls or slopes
+//       but those only ever make a profile's paths longer, never shorter.
+//
+// RESEARCH: https://en.wikipedia.org/wiki/A*_search_algorithm
+static bool pathfind_search_start(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Floor starting_floor,
+    Pathfind_Goals *goals,
+    Pathfind_Profile profile)
+{
+    // One more node than the graph for the sink.
+    pathfind_query_begin(query, level->pathfinding.num_nodes + 1);
 
-        Geometry_Joint *other_joint = &level->joints[other_joint_idx];
+    int start_nodes[2] = {
+        floor_joint_index(level, starting_floor.left),
+        floor_joint_index(level, starting_floor.right)
+    };
 
-        float t = (float)rand() / (float)RAND_MAX;
-        
-        destination = lerpv(joint->position, other_joint->position, t);
-        --attempts_remaining;
-    } while (attempts_remaining > 0);
+    bool any_reachable = !pathfind_profile_respects_locks(profile);
+    for (size_t i = 0; i < goals->count && !any_reachable; ++i) {
+        any_reachable = pathfind_reachability_floors(&level->reachability, start_nodes, &goals->joints[i * 2]);
+    }
+    if (!any_reachable) {
+        return false;
+    }
 
-    return destination;
+    for (int i = 0; i < 2; ++i) {
+        int node = start_nodes[i];
+        pathfind_query_touch_towards(level, query, node, goals);
+        query->g_score[node] = Vector2Distance(start, level->joints[node].position);
+        pathfind_query_open(query, node);
+    }
+
+    return true;
 }
 
-Floor floor_make(Geometry_Joint *a, Geometry_Joint *b) {
-    Geometry_Joint *left, *right;
-    if (a->position.x <= b->position.x) {
-        left = a;
-        right = b;
-    } else {
-        left = b;
-        right = a;
+// How often a search with a deadline checks the clock.
+#define PATHFIND_DEADLINE_CHECK_INTERVAL 32
+
+// Defines `name`, which carries on a search from `pathfind_search_start`
+// over the edge costs of `Pathfind_Profile_<profile>` until the cheapest
+// way to any goal is known, writing the goal joint it goes through to
+// `last`, or until `max_expansions` more nodes have been expanded or
+// `deadline` has passed (0 for no limit). The path can be read back
+// through `query->comes_from`.
+//
+// `respects_locks` and `hops_corridors` are constants so each profile is
+// compiled without whichever checks it doesn't need. Corridors are only
+// contracted over the default costs so only that profile hops them.
+//
+// NOTE: Landmarks and the straight line distance are measured without
+//       locks over lengths no profile pays less than, so the heuristic
+//       holds for all of them.
+#define DEFINE_PATHFIND_SEARCH_RUN(name, profile, respects_locks, hops_corridors)                  \
+    static Pathfind_Status name(                                                                   \
+        Level_Geometry *level,                                                                     \
+        Pathfind_Query *query,                                                                     \
+        Pathfind_Goals *goals,                                                                     \
+        size_t max_expansions,                                                                     \
+        double deadline,                                                                           \
+        int *last)                                                                                 \
+    {                                                                                              \
+        Pathfinding *pathfinding = &level->pathfinding;                                            \
+        Pathfind_Corridors *corridors = &level->corridors;                                         \
+        const float *costs = &pathfinding->profile_costs[                                          \
+            Pathfind_Profile_ ## profile * pathfinding->num_nodes * PATHFIND_NODE_NEIGHBOUR_COUNT  \
+        ];                                                                                         \
+        size_t expanded = 0;                                                                       \
+                                                                                                   \
+        while (query->open_set.entries.count != 0) {                                               \
+            if (max_expansions != 0 && expanded == max_expansions) {                               \
+                return Pathfind_Status_IN_PROGRESS;                                                \
+            }                                                                                      \
+            if (deadline != 0.0 && expanded != 0 &&                                                \
+                expanded % PATHFIND_DEADLINE_CHECK_INTERVAL == 0 && GetTime() >= deadline)         \
+            {                                                                                      \
+                return Pathfind_Status_IN_PROGRESS;                                                \
+            }                                                                                      \
+                                                                                                   \
+            int current = pathfind_heap_pop(&query->open_set);                                     \
+            ++query->nodes_expanded;                                                               \
+            ++expanded;                                                                            \
+                                                                                                   \
+            if (current == pathfind_search_sink(level)) {                                          \
+                *last = query->comes_from[current];                                                \
+                return Pathfind_Status_FOUND;                                                      \
+            }                                                                                      \
+                                                                                                   \
+            /* Goal joints are expanded too, another goal may be further on. */                    \
+            pathfind_search_relax_sink(level, query, current, goals);                              \
+                                                                                                   \
+            /* Only the start and goal joints can be inside a corridor. */                         \
+            if ((hops_corridors) && pathfind_corridors_is_interior(corridors, current)) {          \
+                for (int k = 0; k < 2; ++k) {                                                      \
+                    int corridor = corridors->node_corridors[current * 2 + k];                     \
+                    if (corridor == -1) continue;                                                  \
+                                                                                                   \
+                    int position = corridors->node_positions[current * 2 + k];                     \
+                    int blocked = pathfind_corridors_first_locked_after(level, corridor, position); \
+                    pathfind_search_corridor(level, query, current, corridor, position, blocked, goals); \
+                }                                                                                  \
+                continue;                                                                          \
+            }                                                                                      \
+                                                                                                   \
+            Pathfind_Node *current_node = &pathfinding->nodes[current];                            \
+            const float *current_costs = &costs[current * PATHFIND_NODE_NEIGHBOUR_COUNT];          \
+            for (int i = 0; i < current_node->num_neighbours; ++i) {                               \
+                Pathfind_Edge edge = current_node->neighbours[i];                                  \
+                if ((respects_locks) && edge.locked) continue;                                     \
+                                                                                                   \
+                if (hops_corridors) {                                                              \
+                    int corridor = pathfind_corridors_entered_by(corridors, current, i);           \
+                    if (corridor != -1) {                                                          \
+                        int blocked = corridors->corridors.items[corridor].first_locked;           \
+                        pathfind_search_corridor(level, query, current, corridor, -1, blocked, goals); \
+                        continue;                                                                  \
+                    }                                                                              \
+                }                                                                                  \
+                                                                                                   \
+                pathfind_search_relax(level, query, current, edge.node, current_costs[i], -1, goals); \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return Pathfind_Status_NOT_FOUND;                                                          \
     }
 
-    return (Floor){ .left = left, .right = right };
+DEFINE_PATHFIND_SEARCH_RUN(pathfind_search_run, DEFAULT, true, true)
+DEFINE_PATHFIND_SEARCH_RUN(pathfind_search_run_no_falls, NO_FALLS, true, false)
+DEFINE_PATHFIND_SEARCH_RUN(pathfind_search_run_avoids_slopes, AVOIDS_SLOPES, true, false)
+DEFINE_PATHFIND_SEARCH_RUN(pathfind_search_run_has_key, HAS_KEY, false, false)
+
+typedef Pathfind_Status (*Pathfind_Search_Run)(Level_Geometry *, Pathfind_Query *, Pathfind_Goals *, size_t, double, int *);
+
+static const Pathfind_Search_Run PATHFIND_SEARCH_RUNS[Pathfind_Profile_COUNT] = {
+    [Pathfind_Profile_DEFAULT] = pathfind_search_run,
+    [Pathfind_Profile_NO_FALLS] = pathfind_search_run_no_falls,
+    [Pathfind_Profile_AVOIDS_SLOPES] = pathfind_search_run_avoids_slopes,
+    [Pathfind_Profile_HAS_KEY] = pathfind_search_run_has_key,
+};
+
+// Runs a whole search, giving up after `query->max_expansions` (0 for no
+// limit). Returns the goal joint reached or -1.
+static int pathfind_search_goals(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Floor starting_floor,
+    Pathfind_Goals *goals,
+    Pathfind_Profile profile)
+{
+    assert(profile >= 0 && profile < Pathfind_Profile_COUNT);
+    if (!pathfind_search_start(level, query, start, starting_floor, goals, profile)) {
+        return -1;
+    }
+
+    int last = -1;
+    PATHFIND_SEARCH_RUNS[profile](level, query, goals, query->max_expansions, 0.0, &last);
+    return last;
 }
 
-bool floor_is_flat(Floor floor) {
-    return floor.left->position.y == floor.right->position.y;
+static int pathfind_search(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Floor starting_floor,
+    Vector2 end,
+    Floor ending_floor,
+    Pathfind_Profile profile)
+{
+    int end_nodes[2] = {
+        floor_joint_index(level, ending_floor.left),
+        floor_joint_index(level, ending_floor.right)
+    };
+    Pathfind_Goals goals = { .count = 1, .points = &end, .joints = end_nodes };
+    return pathfind_search_goals(level, query, start, starting_floor, &goals, profile);
 }
 
-bool floor_contains_point(Floor floor, Vector2 point) {
-    if (floor.left->position.x > point.x) return false;
-    if (floor.right->position.x < point.x) return false;
+Vec_Vector2 level_geometry_pathfind(Level_Geometry *level, Vector2 start, Vector2 end) {
+    return level_geometry_pathfind_with_query(level, pathfind_default_query(), start, end);
+}
 
-    if (floor_is_flat(floor)) {
-        if (!FloatEquals(floor.left->position.y, point.y)) return false;
-    } else {
-        Vector2 expected_gradiant = Vector2Normalize(
-            Vector2Subtract(floor.right->position, floor.left->position)
-        );
-        Vector2 actual_gradiant = Vector2Normalize(
-            Vector2Subtract(point, floor.left->position)
-        );
+Vec_Vector2 level_geometry_pathfind_with_query(Level_Geometry *level, Pathfind_Query *query, Vector2 start, Vector2 end) {
+    return level_geometry_pathfind_with_profile(level, query, start, end, Pathfind_Profile_DEFAULT);
+}
+
+static Vec_Vector2 pathfind_path(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Floor starting_floor,
+    Vector2 end,
+    Pathfind_Profile profile)
+{
+    Vec_Vector2 path = {0};
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+    if (floor_contains_point(starting_floor, end)) {
+        vec_append(&path, end);
+        return path;
+    }
 
-        if (!Vector2Equals(actual_gradiant, expected_gradiant)) return false;
+    int last = pathfind_search(level, query, start, starting_floor, end, ending_floor, profile);
+    if (last != -1) {
+        construct_path(&path, level, query, last, end);
     }
 
-    return true;
+    return path;
 }
 
-Floor level_find_floor(Level_Geometry *level, Vector2 position) {
-    // TODO: Only opereate over the joints that fit within the chunk that
-    //       `position` resides in.
-
-    int num_joints = level->num_joints;
-    Geometry_Joint *joints = level->joints;
-    for (int i = 0; i < num_joints; ++i) {
-        Geometry_Joint *a = &joints[i];
-        for (int j = 0; j < JOINT_COUNT; ++j) {
-            for (int k = 0; k < CONN_COUNT; ++k) {
-                int b_idx = a->connections[j].connections[k];
-                if (b_idx == -1) continue;
-
-                assert(b_idx < num_joints);
-                Geometry_Joint *b = &joints[b_idx];
-                Floor floor = floor_make(a, b);
-
-                if (floor_contains_point(floor, position)) {
-                    return floor;
-                }
+Vec_Vector2 level_geometry_pathfind_with_profile(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Vector2 end,
+    Pathfind_Profile profile)
+{
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    return pathfind_path(level, query, start, starting_floor, end, profile);
+}
+
+Vec_Vector2 level_geometry_pathfind_from(Level_Geometry *level, Floor_Position start, Vector2 end) {
+    return level_geometry_pathfind_from_with_profile(level, pathfind_default_query(), start, end, Pathfind_Profile_DEFAULT);
+}
+
+Vec_Vector2 level_geometry_pathfind_from_with_profile(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Floor_Position start,
+    Vector2 end,
+    Pathfind_Profile profile)
+{
+    Vector2 point = level_floor_position_point(level, start);
+    return pathfind_path(level, query, point, level_floor_position_floor(level, start), end, profile);
+}
+
+Pathfind_Plan pathfind_plan_make(void) {
+    return (Pathfind_Plan){ .query = pathfind_query_make() };
+}
+
+void pathfind_plan_free(Pathfind_Plan *plan) {
+    pathfind_query_free(&plan->query);
+    vec_free(&plan->joints);
+}
+
+void pathfind_plan_begin(Pathfind_Plan *plan, Vector2 start, Vector2 end) {
+    pathfind_plan_begin_with_profile(plan, start, end, Pathfind_Profile_DEFAULT);
+}
+
+void pathfind_plan_begin_with_profile(Pathfind_Plan *plan, Vector2 start, Vector2 end, Pathfind_Profile profile) {
+    assert(profile >= 0 && profile < Pathfind_Profile_COUNT);
+    plan->start = start;
+    plan->start_position = (Floor_Position){ .edge = -1 };
+    plan->end = end;
+    plan->profile = profile;
+    plan->started = false;
+    plan->cacheable = false;
+    plan->expanded = 0;
+    plan->steps = 0;
+}
+
+void pathfind_plan_begin_from(Pathfind_Plan *plan, Floor_Position start, Vector2 end, Pathfind_Profile profile) {
+    pathfind_plan_begin_with_profile(plan, (Vector2){0}, end, profile);
+    plan->start_position = start;
+}
+
+Pathfind_Status level_geometry_plan_step(
+    Level_Geometry *level,
+    Pathfind_Plan *plan,
+    size_t max_expansions,
+    double max_seconds,
+    Vec_Vector2 *path)
+{
+    double deadline = max_seconds > 0.0 ? GetTime() + max_seconds : 0.0;
+    ++plan->steps;
+
+    // NOTE: The search so far may have gone through a connection that has
+    //       since been locked, so a change to the level starts it over.
+    if (plan->started && plan->version != level->version) {
+        plan->started = false;
+    }
+
+    if (!plan->started) {
+        Floor starting_floor;
+        if (plan->start_position.edge == -1) {
+            starting_floor = level_find_floor(level, plan->start);
+            assert(starting_floor.left && starting_floor.right);
+        } else {
+            // The floor it was asked from has since been taken away.
+            if (level_edge_other(level, plan->start_position.edge) == -1) {
+                return Pathfind_Status_NOT_FOUND;
             }
+            plan->start = level_floor_position_point(level, plan->start_position);
+            starting_floor = level_floor_position_floor(level, plan->start_position);
+        }
+
+        Floor ending_floor = level_find_floor(level, plan->end);
+        assert(ending_floor.left && ending_floor.right);
+
+        if (floor_contains_point(starting_floor, plan->end)) {
+            vec_append(path, plan->end);
+            return Pathfind_Status_FOUND;
         }
+
+        plan->end_joints[0] = floor_joint_index(level, ending_floor.left);
+        plan->end_joints[1] = floor_joint_index(level, ending_floor.right);
+        plan->key = path_cache_key_make(level, starting_floor, ending_floor, plan->profile);
+        plan->version = level->version;
+
+        Pathfind_Goals goals = { .count = 1, .points = &plan->end, .joints = plan->end_joints };
+        if (!pathfind_search_start(level, &plan->query, plan->start, starting_floor, &goals, plan->profile)) {
+            vec_clear(&plan->joints);
+            plan->cacheable = true;
+            return Pathfind_Status_NOT_FOUND;
+        }
+        plan->started = true;
     }
 
-    return (Floor){0};
+    Pathfind_Goals goals = { .count = 1, .points = &plan->end, .joints = plan->end_joints };
+    size_t before = plan->query.nodes_expanded;
+    int last = -1;
+    Pathfind_Status status = PATHFIND_SEARCH_RUNS[plan->profile](level, &plan->query, &goals, max_expansions, deadline, &last);
+    plan->expanded += plan->query.nodes_expanded - before;
+
+    if (status == Pathfind_Status_IN_PROGRESS) {
+        return status;
+    }
+
+    plan->started = false;
+    plan->cacheable = true;
+    vec_clear(&plan->joints);
+    if (status == Pathfind_Status_FOUND) {
+        construct_path(path, level, &plan->query, last, plan->end);
+        pathfind_found_joints(level, &plan->query, last, &plan->joints);
+    }
+    return status;
+}
+
+Vec_Vector2 level_geometry_pathfind_nearest(Level_Geometry *level, Vector2 start, size_t num_goals, Vector2 *goals, int *goal_index) {
+    return level_geometry_pathfind_nearest_with_query(level, pathfind_default_query(), start, num_goals, goals, goal_index);
+}
+
+Vec_Vector2 level_geometry_pathfind_nearest_with_query(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    size_t num_goals,
+    Vector2 *goals,
+    int *goal_index)
+{
+    Vec_Vector2 path = {0};
+    *goal_index = -1;
+    if (num_goals == 0) return path;
+
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    // NOTE: A goal on the start's own floor is just a walk away so the
+    //       closest of those wins without searching.
+    float closest = INFINITY;
+    for (size_t i = 0; i < num_goals; ++i) {
+        if (!floor_contains_point(starting_floor, goals[i])) continue;
+
+        float distance = Vector2Distance(start, goals[i]);
+        if (distance < closest) {
+            closest = distance;
+            *goal_index = i;
+        }
+    }
+    if (*goal_index != -1) {
+        vec_append(&path, goals[*goal_index]);
+        return path;
+    }
+
+    int *joints = malloc(num_goals * 2 * sizeof(int));
+    for (size_t i = 0; i < num_goals; ++i) {
+        Floor ending_floor = level_find_floor(level, goals[i]);
+        assert(ending_floor.left && ending_floor.right);
+        joints[i * 2] = floor_joint_index(level, ending_floor.left);
+        joints[i * 2 + 1] = floor_joint_index(level, ending_floor.right);
+    }
+
+    Pathfind_Goals search_goals = { .count = num_goals, .points = goals, .joints = joints };
+    int last = pathfind_search_goals(level, query, start, starting_floor, &search_goals, Pathfind_Profile_DEFAULT);
+    if (last != -1) {
+        *goal_index = pathfind_goals_find(level, &search_goals, last);
+        construct_path(&path, level, query, last, goals[*goal_index]);
+    }
+
+    free(joints);
+    return path;
+}
+
+float level_geometry_path_stretch(Level_Geometry *level, Floor_Position from, Vec_Vector2 path, int target) {
+    if (target < 0 || (size_t)target >= path.count) return 1.f;
+
+    Vector2 point = level_floor_position_point(level, from);
+    float length = Vector2Distance(point, path.items[target]);
+    for (int i = target; i > 0; --i) {
+        length += Vector2Distance(path.items[i], path.items[i - 1]);
+    }
+
+    // The heuristic from whichever end of the walker's floor it goes
+    // through, which is a lower bound from the walker.
+    Vector2 end = path.items[0];
+    Floor floor = level_floor_position_floor(level, from);
+    float bound = Vector2Distance(point, end);
+    if (!floor_contains_point(floor, end)) {
+        Floor ending_floor = level_find_floor(level, end);
+        if (!ending_floor.left || !ending_floor.right) return 1.f;
+
+        int end_nodes[2] = { floor_joint_index(level, ending_floor.left), floor_joint_index(level, ending_floor.right) };
+        int joints[2] = { floor_joint_index(level, floor.left), floor_joint_index(level, floor.right) };
+        bound = INFINITY;
+        for (int i = 0; i < 2; ++i) {
+            float through = Vector2Distance(point, level->joints[joints[i]].position);
+            through += level_geometry_heuristic(level, joints[i], end, end_nodes);
+            bound = fminf(bound, through);
+        }
+    }
+
+    return bound > 0.f ? length / bound : 1.f;
+}
+
+bool level_geometry_repair_path(
+    Level_Geometry *level,
+    Floor_Position from,
+    Vec_Vector2 *path,
+    int *target,
+    Vector2 end,
+    size_t max_expansions,
+    float max_stretch,
+    Pathfind_Profile profile)
+{
+    if (*target < 0 || path->count == 0) return false;
+
+    // Already walking across the old end floor, which the walker could
+    // have got onto from anywhere. A full search from here starts just as
+    // close.
+    if (*target == 0) return false;
+
+    Floor old_floor = level_find_floor(level, path->items[0]);
+    if (!old_floor.left || !old_floor.right) return false;
+
+    // NOTE: The waypoint before the end is always the joint the path
+    //       enters the end floor through, so that's where the tail starts.
+    //       An end right on a joint can be found on a different floor to
+    //       the one the path enters, which is no use.
+    Vector2 entry = path->items[1];
+    int anchor;
+    if (Vector2Equals(old_floor.left->position, entry)) {
+        anchor = floor_joint_index(level, old_floor.left);
+    } else if (Vector2Equals(old_floor.right->position, entry)) {
+        anchor = floor_joint_index(level, old_floor.right);
+    } else {
+        return false;
+    }
+
+    // Still on the same floor so everything leading up to it still holds.
+    if (floor_contains_point(old_floor, end)) {
+        path->items[0] = end;
+        return true;
+    }
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+
+    int end_nodes[2] = {
+        floor_joint_index(level, ending_floor.left),
+        floor_joint_index(level, ending_floor.right)
+    };
+    Pathfind_Goals goals = { .count = 1, .points = &end, .joints = end_nodes };
+    Floor anchor_floor = { &level->joints[anchor], &level->joints[anchor] };
+
+    Pathfind_Query *query = pathfind_default_query();
+    query->max_expansions = max_expansions;
+    int last = pathfind_search_goals(level, query, entry, anchor_floor, &goals, profile);
+    query->max_expansions = 0;
+
+    if (last == -1) return false;
+
+    Vec_Vector2 repaired = {0};
+    construct_path(&repaired, level, query, last, end);
+
+    // The tail heads straight back along the prefix, so the target has
+    // doubled back past the walker and the prefix is a detour.
+    if (*target >= 2 && repaired.count >= 3 && Vector2Equals(repaired.items[repaired.count - 2], path->items[2])) {
+        vec_free(&repaired);
+        return false;
+    }
+
+    for (int i = 2; i <= *target; ++i) {
+        vec_append(&repaired, path->items[i]);
+    }
+
+    // NOTE: The kept prefix was the best way towards where the target used
+    //       to be, which isn't always the best way to where it is now.
+    if (level_geometry_path_stretch(level, from, repaired, repaired.count - 1) > max_stretch) {
+        vec_free(&repaired);
+        return false;
+    }
+
+    vec_free(path);
+    *path = repaired;
+    *target = repaired.count - 1;
+    return true;
+}
+
+static bool pathfind_search_joints(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Floor starting_floor,
+    Vector2 end,
+    Floor ending_floor,
+    Pathfind_Profile profile,
+    Vec_int *joints)
+{
+    vec_clear(joints);
+
+    if (floor_contains_point(starting_floor, end)) {
+        return true;
+    }
+
+    int last = pathfind_search(level, query, start, starting_floor, end, ending_floor, profile);
+    if (last == -1) {
+        return false;
+    }
+
+    pathfind_found_joints(level, query, last, joints);
+    return true;
+}
+
+bool level_geometry_pathfind_joints(Level_Geometry *level, Pathfind_Query *query, Vector2 start, Vector2 end, Vec_int *joints) {
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+
+    return pathfind_search_joints(level, query, start, starting_floor, end, ending_floor, Pathfind_Profile_DEFAULT, joints);
+}
+
+static bool floor_has_joints(Level_Geometry *level, Floor floor, int a, int b) {
+    int left = floor_joint_index(level, floor.left);
+    int right = floor_joint_index(level, floor.right);
+    return (left == a && right == b) || (left == b && right == a);
+}
+
+static Vec_Vector2 path_from_joints(
+    Level_Geometry *level,
+    Vector2 end,
+    Floor starting_floor,
+    Floor ending_floor,
+    size_t num_joints,
+    int *joints)
+{
+    Vec_Vector2 path = {0};
+
+    // NOTE: A joint sequence is shared by every point on the start and end
+    //       floors, so it can begin by walking across the start floor or end
+    //       by walking back across the end floor. The point is already on
+    //       that floor so those joints can be skipped.
+    size_t first = 0;
+    size_t last = num_joints;
+
+    if (last - first >= 2 && floor_has_joints(level, starting_floor, joints[first], joints[first + 1])) {
+        ++first;
+    }
+
+    if (last - first >= 2 && floor_has_joints(level, ending_floor, joints[last - 2], joints[last - 1])) {
+        --last;
+    }
+
+    vec_append(&path, end);
+    for (size_t i = last; i > first; --i) {
+        vec_append(&path, level->joints[joints[i - 1]].position);
+    }
+
+    return path;
+}
+
+Vec_Vector2 level_geometry_path_from_joints(Level_Geometry *level, Vector2 start, Vector2 end, size_t num_joints, int *joints) {
+    Floor starting_floor = level_find_floor(level, start);
+    Floor ending_floor = level_find_floor(level, end);
+    return path_from_joints(level, end, starting_floor, ending_floor, num_joints, joints);
+}
+
+Vec_Vector2 level_geometry_path_from_joints_on_floors(
+    Level_Geometry *level,
+    Floor starting_floor,
+    Floor ending_floor,
+    Vector2 end,
+    size_t num_joints,
+    int *joints)
+{
+    return path_from_joints(level, end, starting_floor, ending_floor, num_joints, joints);
+}
+
+// One half of a bidirectional search. A backward frontier follows edges
+// against their direction so it grows out of the end towards the start.
+typedef struct {
+    Pathfind_Query *query;
+    bool backward;
+    Vector2 target;
+    int target_joints[2];
+} Pathfind_Frontier;
+
+static float pathfind_frontier_heuristic(Level_Geometry *level, Pathfind_Frontier *frontier, int node) {
+    if (!frontier->backward) {
+        return level_geometry_heuristic(level, node, frontier->target, frontier->target_joints);
+    }
+
+    // NOTE: Same as `level_geometry_heuristic` but bounds the cost of getting
+    //       from the target to `node` instead.
+    Pathfinding *pathfinding = &level->pathfinding;
+    float euclidean = Vector2Distance(pathfinding->nodes[node].position, frontier->target);
+    if (level->landmarks.count == 0) return euclidean;
+
+    float best = INFINITY;
+    for (int i = 0; i < 2; ++i) {
+        int source = frontier->target_joints[i];
+        float bound = pathfind_landmarks_bound(&level->landmarks, pathfinding->num_nodes, source, node);
+        bound += Vector2Distance(pathfinding->nodes[source].position, frontier->target);
+        if (bound < best) best = bound;
+    }
+
+    return fmaxf(euclidean, best);
+}
+
+static void pathfind_frontier_relax(
+    Level_Geometry *level,
+    Pathfind_Frontier *frontier,
+    int from,
+    int to,
+    float distance)
+{
+    Pathfind_Query *query = frontier->query;
+    if (pathfind_query_touch(query, to)) {
+        query->h_score[to] = pathfind_frontier_heuristic(level, frontier, to);
+    }
+
+    float tentative_g_score = (from == -1 ? 0.f : query->g_score[from]) + distance;
+    if (tentative_g_score < query->g_score[to]) {
+        query->comes_from[to] = from;
+        query->g_score[to] = tentative_g_score;
+        pathfind_query_open(query, to);
+    }
+}
+
+// Whether the cheapest known path through `node` got cheaper now that
+// `frontier` has reached it.
+static void pathfind_frontier_meet(Pathfind_Frontier *frontier, Pathfind_Frontier *other, int node, float *best, int *meet) {
+    float total = frontier->query->g_score[node] + pathfind_query_g_score(other->query, node);
+    if (total < *best) {
+        *best = total;
+        *meet = node;
+    }
+}
+
+static void pathfind_frontier_expand(
+    Level_Geometry *level,
+    Pathfind_Frontier *frontier,
+    Pathfind_Frontier *other,
+    float *best,
+    int *meet)
+{
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Query *query = frontier->query;
+
+    int current = pathfind_heap_pop(&query->open_set);
+    ++query->nodes_expanded;
+
+    if (!frontier->backward) {
+        Pathfind_Node *node = &pathfinding->nodes[current];
+        for (int i = 0; i < node->num_neighbours; ++i) {
+            Pathfind_Edge edge = node->neighbours[i];
+            if (edge.locked) continue;
+
+            pathfind_frontier_relax(level, frontier, current, edge.node, edge.length);
+            pathfind_frontier_meet(frontier, other, edge.node, best, meet);
+        }
+        return;
+    }
+
+    // NOTE: Falls and one sided locks belong to the joint they start from,
+    //       so walking them backwards means checking the predecessor's side.
+    int first = pathfinding->predecessor_offsets[current];
+    int last = pathfinding->predecessor_offsets[current + 1];
+    for (int i = first; i < last; ++i) {
+        Pathfind_Edge edge = pathfinding->predecessors[i];
+        if (edge.locked) continue;
+
+        pathfind_frontier_relax(level, frontier, current, edge.node, edge.length);
+        pathfind_frontier_meet(frontier, other, edge.node, best, meet);
+    }
+}
+
+// Returns the joint the shortest path passes through where the two searches
+// met, or -1 if there is no path. Stops once neither frontier can beat the
+// best path found so far, which is the usual bidirectional A* condition.
+//
+// RESEARCH: https://en.wikipedia.org/wiki/Bidirectional_search
+static int pathfind_search_bidirectional(
+    Level_Geometry *level,
+    Pathfind_Query *forward,
+    Pathfind_Query *backward,
+    Vector2 start,
+    Floor starting_floor,
+    Vector2 end,
+    Floor ending_floor)
+{
+    size_t num_nodes = level->pathfinding.num_nodes;
+    pathfind_query_begin(forward, num_nodes);
+    pathfind_query_begin(backward, num_nodes);
+
+    Pathfind_Frontier frontiers[2] = {
+        {
+            .query = forward,
+            .backward = false,
+            .target = end,
+            .target_joints = {
+                floor_joint_index(level, ending_floor.left),
+                floor_joint_index(level, ending_floor.right)
+            }
+        },
+        {
+            .query = backward,
+            .backward = true,
+            .target = start,
+            .target_joints = {
+                floor_joint_index(level, starting_floor.left),
+                floor_joint_index(level, starting_floor.right)
+            }
+        }
+    };
+
+    if (!pathfind_reachability_floors(&level->reachability, frontiers[1].target_joints, frontiers[0].target_joints)) {
+        return -1;
+    }
+
+    // Each side starts from the joints of the floor the other is heading for.
+    for (int side = 0; side < 2; ++side) {
+        Pathfind_Frontier *frontier = &frontiers[side];
+        Pathfind_Frontier *other = &frontiers[1 - side];
+        for (int i = 0; i < 2; ++i) {
+            int node = other->target_joints[i];
+            float distance = Vector2Distance(other->target, level->joints[node].position);
+            pathfind_frontier_relax(level, frontier, -1, node, distance);
+        }
+    }
+
+    float best = INFINITY;
+    int meet = -1;
+    for (int i = 0; i < 2; ++i) {
+        pathfind_frontier_meet(&frontiers[0], &frontiers[1], frontiers[1].target_joints[i], &best, &meet);
+    }
+
+    while (forward->open_set.entries.count != 0 && backward->open_set.entries.count != 0) {
+        float forward_min = pathfind_heap_top(&forward->open_set).priority;
+        float backward_min = pathfind_heap_top(&backward->open_set).priority;
+        if (fmaxf(forward_min, backward_min) >= best) break;
+
+        // NOTE: Growing whichever frontier is smaller keeps the two
+        //       balanced when one side fans out faster, e.g. below a
+        //       lot of falls.
+        if (forward->open_set.entries.count <= backward->open_set.entries.count) {
+            pathfind_frontier_expand(level, &frontiers[0], &frontiers[1], &best, &meet);
+        } else {
+            pathfind_frontier_expand(level, &frontiers[1], &frontiers[0], &best, &meet);
+        }
+    }
+
+    return meet;
+}
+
+Vec_Vector2 level_geometry_pathfind_bidirectional(
+    Level_Geometry *level,
+    Pathfind_Query *forward,
+    Pathfind_Query *backward,
+    Vector2 start,
+    Vector2 end)
+{
+    Vec_Vector2 path = {0};
+
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+    if (floor_contains_point(starting_floor, end)) {
+        vec_append(&path, end);
+        return path;
+    }
+
+    int meet = pathfind_search_bidirectional(level, forward, backward, start, starting_floor, end, ending_floor);
+    if (meet == -1) {
+        return path;
+    }
+
+    // `backward->comes_from` leads from `meet` on to the end and
+    // `forward->comes_from` from `meet` back to the start.
+    Vec_int *tail = &pathfind_scratch.tail;
+    vec_clear(tail);
+    for (int n = backward->comes_from[meet]; n != -1; n = backward->comes_from[n]) {
+        vec_append(tail, n);
+    }
+
+    vec_append(&path, end);
+    for (size_t i = tail->count; i > 0; --i) {
+        vec_append(&path, level->joints[tail->items[i - 1]].position);
+    }
+    for (int n = meet; n != -1; n = forward->comes_from[n]) {
+        vec_append(&path, level->joints[n].position);
+    }
+
+    return path;
+}
+
+Vec_Vector2 level_geometry_pathfind_with_mode(Level_Geometry *level, Vector2 start, Vector2 end, Pathfind_Mode mode) {
+    if (mode == Pathfind_Mode_BIDIRECTIONAL) {
+        return level_geometry_pathfind_bidirectional(level, pathfind_default_query(), &pathfind_scratch.backward, start, end);
+    }
+
+    if (mode == Pathfind_Mode_FLAT || level->hierarchy.cluster_size <= 0.f) {
+        return level_geometry_pathfind(level, start, end);
+    }
+
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+    if (floor_contains_point(starting_floor, end)) {
+        Vec_Vector2 path = {0};
+        vec_append(&path, end);
+        return path;
+    }
+
+    Vec_int *joints = &pathfind_scratch.hierarchy_joints;
+
+    int start_joints[2] = {
+        floor_joint_index(level, starting_floor.left),
+        floor_joint_index(level, starting_floor.right)
+    };
+    int end_joints[2] = {
+        floor_joint_index(level, ending_floor.left),
+        floor_joint_index(level, ending_floor.right)
+    };
+
+    if (!pathfind_hierarchy_search_joints(level, &pathfind_scratch.hierarchy, start, start_joints, end, end_joints, joints)) {
+        return (Vec_Vector2){0};
+    }
+
+    return path_from_joints(level, end, starting_floor, ending_floor, joints->count, joints->items);
+}
+
+Vec_Vector2 level_geometry_pathfind_cached(Level_Geometry *level, Vector2 start, Vector2 end) {
+    return level_geometry_pathfind_cached_with_profile(level, start, end, Pathfind_Profile_DEFAULT);
+}
+
+static Vec_Vector2 pathfind_cached(Level_Geometry *level, Vector2 start, Floor starting_floor, Vector2 end, Pathfind_Profile profile) {
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+    if (floor_contains_point(starting_floor, end)) {
+        Vec_Vector2 path = {0};
+        vec_append(&path, end);
+        return path;
+    }
+
+    Path_Cache_Key key = path_cache_key_make(level, starting_floor, ending_floor, profile);
+    Path_Cache_Entry *entry = path_cache_lookup(&level->path_cache, level->version, key);
+    if (!entry) {
+        Vec_int joints = {0};
+        bool found = pathfind_search_joints(
+            level,
+            pathfind_default_query(),
+            start,
+            starting_floor,
+            end,
+            ending_floor,
+            profile,
+            &joints
+        );
+        entry = path_cache_insert(&level->path_cache, key, found, joints);
+    }
+
+    if (!entry->found) {
+        return (Vec_Vector2){0};
+    }
+
+    return path_from_joints(level, end, starting_floor, ending_floor, entry->joints.count, entry->joints.items);
+}
+
+Vec_Vector2 level_geometry_pathfind_cached_with_profile(Level_Geometry *level, Vector2 start, Vector2 end, Pathfind_Profile profile) {
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    return pathfind_cached(level, start, starting_floor, end, profile);
+}
+
+Vec_Vector2 level_geometry_pathfind_cached_from(Level_Geometry *level, Floor_Position start, Vector2 end, Pathfind_Profile profile) {
+    Vector2 point = level_floor_position_point(level, start);
+    return pathfind_cached(level, point, level_floor_position_floor(level, start), end, profile);
+}
+
+bool level_geometry_pathfind_lookup_from(Level_Geometry *level, Floor_Position start, Vector2 end, Pathfind_Profile profile, Vec_Vector2 *path) {
+    Floor starting_floor = level_floor_position_floor(level, start);
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+    if (floor_contains_point(starting_floor, end)) {
+        vec_append(path, end);
+        return true;
+    }
+
+    Path_Cache_Key key = path_cache_key_make(level, starting_floor, ending_floor, profile);
+    Path_Cache_Entry *entry = path_cache_lookup(&level->path_cache, level->version, key);
+    if (!entry) return false;
+
+    if (entry->found) {
+        *path = path_from_joints(level, end, starting_floor, ending_floor, entry->joints.count, entry->joints.items);
+    }
+    return true;
+}
+
+void level_geometry_plan_cache(Level_Geometry *level, Pathfind_Plan *plan) {
+    if (!plan->cacheable || plan->version != level->version) return;
+
+    path_cache_insert(&level->path_cache, plan->key, plan->joints.count != 0, plan->joints);
+    plan->joints = (Vec_int){0};
+    plan->cacheable = false;
+}
+
+typedef struct {
+    Level_Geometry *level;
+    Vector2 *starts;
+    Vector2 *ends;
+    Floor *starting_floors;
+    Floor *ending_floors;
+    size_t *searches; // index of the request behind each search
+    Vec_int *joints;
+    bool *found;
+} Pathfind_Batch;
+
+// A request the cache couldn't answer.
+typedef struct {
+    Path_Cache_Key key;
+    size_t request;
+} Pathfind_Batch_Miss;
+
+static int pathfind_batch_miss_compare(const void *a, const void *b) {
+    const Pathfind_Batch_Miss *x = a;
+    const Pathfind_Batch_Miss *y = b;
+    int order = path_cache_key_compare(x->key, y->key);
+    if (order != 0) return order;
+    return x->request < y->request ? -1 : x->request > y->request;
+}
+
+static void pathfind_batch_search(void *data, Pathfind_Query *query, size_t index) {
+    Pathfind_Batch *batch = data;
+    size_t request = batch->searches[index];
+    batch->found[index] = pathfind_search_joints(
+        batch->level,
+        query,
+        batch->starts[request],
+        batch->starting_floors[request],
+        batch->ends[request],
+        batch->ending_floors[request],
+        Pathfind_Profile_DEFAULT,
+        &batch->joints[index]
+    );
+}
+
+void level_geometry_pathfind_batch(Level_Geometry *level, size_t n, Vector2 *starts, Vector2 *ends, Vec_Vector2 *out_paths) {
+    if (n == 0) return;
+
+    if (!level->pool) {
+        level->pool = pathfind_pool_make(level->num_workers);
+    }
+
+    Pathfind_Batch batch = {
+        .level = level,
+        .starts = starts,
+        .ends = ends,
+        .starting_floors = malloc(n * sizeof(Floor)),
+        .ending_floors = malloc(n * sizeof(Floor)),
+        .searches = malloc(n * sizeof(size_t)),
+        .joints = calloc(n, sizeof(Vec_int)),
+        .found = malloc(n * sizeof(bool))
+    };
+    Pathfind_Batch_Miss *misses = malloc(n * sizeof(Pathfind_Batch_Miss));
+    size_t num_misses = 0;
+
+    // NOTE: The cache is only touched from this thread. Workers get the
+    //       requests it couldn't answer and hand back joint sequences.
+    for (size_t i = 0; i < n; ++i) {
+        out_paths[i] = (Vec_Vector2){0};
+
+        Floor starting_floor = level_find_floor(level, starts[i]);
+        assert(starting_floor.left && starting_floor.right);
+
+        Floor ending_floor = level_find_floor(level, ends[i]);
+        assert(ending_floor.left && ending_floor.right);
+
+        batch.starting_floors[i] = starting_floor;
+        batch.ending_floors[i] = ending_floor;
+
+        if (floor_contains_point(starting_floor, ends[i])) {
+            vec_append(&out_paths[i], ends[i]);
+            continue;
+        }
+
+        Path_Cache_Key key = path_cache_key_make(level, starting_floor, ending_floor, Pathfind_Profile_DEFAULT);
+        Path_Cache_Entry *entry = path_cache_lookup(&level->path_cache, level->version, key);
+        if (!entry) {
+            misses[num_misses++] = (Pathfind_Batch_Miss){ .key = key, .request = i };
+            continue;
+        }
+
+        if (entry->found) {
+            out_paths[i] = path_from_joints(level, ends[i], starting_floor, ending_floor, entry->joints.count, entry->joints.items);
+        }
+    }
+
+    // NOTE: Requests between the same two floors share a joint sequence, so
+    //       only the first of each is searched for and put in the cache.
+    qsort(misses, num_misses, sizeof(Pathfind_Batch_Miss), pathfind_batch_miss_compare);
+
+    size_t num_searches = 0;
+    for (size_t m = 0; m < num_misses; ++m) {
+        if (m == 0 || path_cache_key_compare(misses[m - 1].key, misses[m].key) != 0) {
+            batch.searches[num_searches++] = misses[m].request;
+        }
+    }
+
+    pathfind_pool_run(level->pool, num_searches, pathfind_batch_search, &batch);
+
+    Path_Cache_Entry *entry = NULL;
+    for (size_t m = 0, search = 0; m < num_misses; ++m) {
+        if (m == 0 || path_cache_key_compare(misses[m - 1].key, misses[m].key) != 0) {
+            entry = path_cache_insert(&level->path_cache, misses[m].key, batch.found[search], batch.joints[search]);
+            ++search;
+        }
+
+        size_t i = misses[m].request;
+        if (entry->found) {
+            out_paths[i] = path_from_joints(
+                level,
+                ends[i],
+                batch.starting_floors[i],
+                batch.ending_floors[i],
+                entry->joints.count,
+                entry->joints.items
+            );
+        }
+    }
+
+    free(misses);
+    free(batch.starting_floors);
+    free(batch.ending_floors);
+    free(batch.searches);
+    free(batch.joints);
+    free(batch.found);
+}
+
+Pathfind_Ticket level_geometry_pathfind_async(Level_Geometry *level, Vector2 start, Vector2 end) {
+    return level_geometry_pathfind_async_with_profile(level, start, end, Pathfind_Profile_DEFAULT);
+}
+
+// NOTE: The start is snapped onto its floor here rather than on the
+//       service's thread, so requests only ever carry floor positions.
+Pathfind_Ticket level_geometry_pathfind_async_with_profile(Level_Geometry *level, Vector2 start, Vector2 end, Pathfind_Profile profile) {
+    Floor_Position start_position;
+    bool on_floor = level_snap_to_floor(level, start, LEVEL_FLOOR_SNAP_TOLERANCE, &start_position);
+    assert(on_floor && "paths have to start on a floor");
+
+    return level_geometry_pathfind_async_from(level, start_position, end, profile);
+}
+
+Pathfind_Ticket level_geometry_pathfind_async_from(Level_Geometry *level, Floor_Position start, Vector2 end, Pathfind_Profile profile) {
+    if (!level->service) {
+        level->service = pathfind_service_make(level);
+    }
+
+    Vec_Vector2 path = {0};
+    if (level_geometry_pathfind_lookup_from(level, start, end, profile, &path)) {
+        Pathfind_Status status = path.count != 0 ? Pathfind_Status_FOUND : Pathfind_Status_NOT_FOUND;
+        return pathfind_service_request_done(level->service, status, path);
+    }
+
+    return pathfind_service_request(level->service, start, end, profile);
+}
+
+Pathfind_Status level_geometry_pathfind_poll(Level_Geometry *level, Pathfind_Ticket ticket, Vec_Vector2 *path) {
+    if (!level->service) return Pathfind_Status_NOT_FOUND;
+    return pathfind_service_poll(level->service, ticket, path);
+}
+
+void level_geometry_pathfind_cancel(Level_Geometry *level, Pathfind_Ticket ticket) {
+    if (!level->service) return;
+    pathfind_service_cancel(level->service, ticket);
+}
+
+typedef struct {
+    Level_Geometry *level;
+    Pathfind_Plan **plans;
+    size_t *max_expansions;
+    double max_seconds;
+    Pathfind_Status *statuses;
+    Vec_Vector2 *paths;
+} Pathfind_Plan_Batch;
+
+static void pathfind_plan_batch_step(void *data, Pathfind_Query *query, size_t index) {
+    (void)query; // every plan brings its own
+    Pathfind_Plan_Batch *batch = data;
+    batch->statuses[index] = level_geometry_plan_step(
+        batch->level,
+        batch->plans[index],
+        batch->max_expansions[index],
+        batch->max_seconds,
+        &batch->paths[index]
+    );
+}
+
+void level_geometry_plan_batch(
+    Level_Geometry *level,
+    size_t n,
+    Pathfind_Plan **plans,
+    size_t *max_expansions,
+    double max_seconds,
+    Pathfind_Status *out_statuses,
+    Vec_Vector2 *out_paths)
+{
+    if (n == 0) return;
+
+    if (!level->pool) {
+        level->pool = pathfind_pool_make(level->num_workers);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        out_paths[i] = (Vec_Vector2){0};
+    }
+
+    Pathfind_Plan_Batch batch = {
+        .level = level,
+        .plans = plans,
+        .max_expansions = max_expansions,
+        .max_seconds = max_seconds,
+        .statuses = out_statuses,
+        .paths = out_paths
+    };
+    pathfind_pool_run(level->pool, n, pathfind_plan_batch_step, &batch);
+
+    // NOTE: The cache is only touched from this thread, once the workers
+    //       are done with the plans.
+    for (size_t i = 0; i < n; ++i) {
+        if (out_statuses[i] != Pathfind_Status_IN_PROGRESS) {
+            level_geometry_plan_cache(level, plans[i]);
+        }
+    }
+}
+
+Vector2 level_geometry_random_position(Level_Geometry *level) {
+    int edge = level_floor_sampler_edge(&level->floor_sampler, -1);
+    if (edge == -1) return (Vector2){0};
+
+    float t = (float)rand() / (float)RAND_MAX;
+    return level_floor_position_point(level, (Floor_Position){ .edge = edge, .t = t });
+}
+
+bool level_geometry_is_reachable(Level_Geometry *level, Vector2 a, Vector2 b) {
+    Floor starting_floor = level_find_floor(level, a);
+    Floor ending_floor = level_find_floor(level, b);
+    if (!starting_floor.left || !ending_floor.left) return false;
+    if (floor_contains_point(starting_floor, b)) return true;
+
+    int start_joints[2] = { floor_joint_index(level, starting_floor.left), floor_joint_index(level, starting_floor.right) };
+    int end_joints[2] = { floor_joint_index(level, ending_floor.left), floor_joint_index(level, ending_floor.right) };
+    return pathfind_reachability_floors(&level->reachability, start_joints, end_joints);
+}
+
+static Vector2 random_reachable_position(Level_Geometry *level, Vector2 from, Floor floor, float min_distance) {
+    Pathfind_Reachability *reachability = &level->reachability;
+    if (!floor.left || !reachability->node_component) return level_geometry_random_position(level);
+
+    // NOTE: Sticking to the caller's own component means it can always make
+    //       its way back. Otherwise falls would slowly drain everyone into
+    //       the bottom of the level.
+    int component = reachability->node_component[floor_joint_index(level, floor.left)];
+
+    // NOTE: The attempts are capped so a component that's all within
+    //       `min_distance` still gives back something rather than spinning.
+    Vector2 furthest = from;
+    float furthest_distance = -1.f;
+    for (int i = 0; i < LEVEL_RANDOM_POSITION_ATTEMPTS; ++i) {
+        int edge = level_floor_sampler_edge(&level->floor_sampler, component);
+        if (edge == -1) return from;
+
+        float t = (float)rand() / (float)RAND_MAX;
+        Vector2 position = level_floor_position_point(level, (Floor_Position){ .edge = edge, .t = t });
+
+        float distance = Vector2Distance(position, from);
+        if (distance >= min_distance) return position;
+        if (distance > furthest_distance) {
+            furthest = position;
+            furthest_distance = distance;
+        }
+    }
+
+    return furthest;
+}
+
+Vector2 level_geometry_random_reachable_position(Level_Geometry *level, Vector2 from, float min_distance) {
+    return random_reachable_position(level, from, level_find_floor(level, from), min_distance);
+}
+
+Vector2 level_geometry_random_reachable_position_from(Level_Geometry *level, Floor_Position from, float min_distance) {
+    Vector2 point = level_floor_position_point(level, from);
+    return random_reachable_position(level, point, level_floor_position_floor(level, from), min_distance);
+}
+
+Floor floor_make(Geometry_Joint *a, Geometry_Joint *b) {
+    Geometry_Joint *left, *right;
+    if (a->position.x <= b->position.x) {
+        left = a;
+        right = b;
+    } else {
+        left = b;
+        right = a;
+    }
+
+    return (Floor){ .left = left, .right = right };
+}
+
+bool floor_is_flat(Floor floor) {
+    return floor.left->position.y == floor.right->position.y;
+}
+
+bool floor_contains_point(Floor floor, Vector2 point) {
+    Vector2 left = floor.left->position;
+    Vector2 right = floor.right->position;
+    return level_floor_segment_contains(left, right, level_floor_segment_slope(left, right), point);
+}
+
+int level_edge_other(Level_Geometry *level, int edge) {
+    Geometry_Joint *joint = &level->joints[FLOOR_EDGE_JOINT(edge)];
+    return joint->connections[FLOOR_EDGE_SIDE(edge)].connections[FLOOR_EDGE_KIND(edge)];
+}
+
+Floor level_edge_floor(Level_Geometry *level, int edge) {
+    int other = level_edge_other(level, edge);
+    assert(other != -1 && "edge has no floor");
+
+    return floor_make(&level->joints[FLOOR_EDGE_JOINT(edge)], &level->joints[other]);
+}
+
+// NOTE: Falls only go one way, so partway down one the bottom is the only
+//       joint in reach.
+Floor level_floor_position_floor(Level_Geometry *level, Floor_Position position) {
+    if (FLOOR_EDGE_KIND(position.edge) == CONN_FALL && position.t > 0.f) {
+        Geometry_Joint *bottom = &level->joints[level_edge_other(level, position.edge)];
+        return (Floor){ bottom, bottom };
+    }
+    return level_edge_floor(level, position.edge);
+}
+
+Vector2 level_floor_position_point(Level_Geometry *level, Floor_Position position) {
+    int other = level_edge_other(level, position.edge);
+    assert(other != -1 && "edge has no floor");
+
+    return lerpv(level->joints[FLOOR_EDGE_JOINT(position.edge)].position, level->joints[other].position, position.t);
+}
+
+Floor level_find_floor(Level_Geometry *level, Vector2 position) {
+    Level_Floor_Grid *grid = &level->floor_grid;
+    int cell = level_floor_grid_cell(grid, position);
+    if (cell != -1) {
+        int found = level_floor_segments_find(&grid->floors, grid->cell_offsets[cell], grid->cell_offsets[cell + 1], position);
+        if (found != -1) return level_edge_floor(level, grid->floors.ids[found]);
+    }
+
+    Floor_Position snapped;
+    if (level_snap_to_floor(level, position, LEVEL_FLOOR_SNAP_TOLERANCE, &snapped)) {
+        return level_edge_floor(level, snapped.edge);
+    }
+
+    return (Floor){0};
+}
+
+void level_find_floors(Level_Geometry *level, size_t count, Vector2 *positions, Floor *floors) {
+    for (size_t i = 0; i < count; ++i) {
+        floors[i] = level_find_floor(level, positions[i]);
+    }
+}
+
+bool level_snap_to_floor(Level_Geometry *level, Vector2 position, float tolerance, Floor_Position *snapped) {
+    int edge = level_floor_grid_nearest(&level->floor_grid, position, tolerance);
+    if (edge == -1) return false;
+
+    // NOTE: The grid measures along its own copy of the floor, left to
+    //       right. `t` goes the way the connection does.
+    *snapped = (Floor_Position){ .edge = edge, .t = level_edge_closest_t(level, edge, position) };
+    return true;
+}
+
+Floor_Position level_floor_position_canonical(Level_Geometry *level, Floor_Position position) {
+    int joint = FLOOR_EDGE_JOINT(position.edge);
+    int other = level_edge_other(level, position.edge);
+    assert(other != -1 && "edge has no floor");
+    if (other > joint) return position;
+
+    Geometry_Joint *o = &level->joints[other];
+    for (int side = 0; side < JOINT_COUNT; ++side) {
+        for (int kind = 0; kind < CONN_COUNT; ++kind) {
+            if (o->connections[side].connections[kind] != joint) continue;
+            return (Floor_Position){ .edge = FLOOR_EDGE(other, side, kind), .t = 1.f - position.t };
+        }
+    }
+    return position;
+}
+
+float level_edge_closest_t(Level_Geometry *level, int edge, Vector2 point) {
+    Vector2 a = level->joints[FLOOR_EDGE_JOINT(edge)].position;
+    Vector2 b = level->joints[level_edge_other(level, edge)].position;
+    Vector2 along = Vector2Subtract(b, a);
+    float length_sqr = Vector2LengthSqr(along);
+    if (length_sqr == 0.f) return 0.f;
+
+    return Clamp(Vector2DotProduct(Vector2Subtract(point, a), along) / length_sqr, 0.f, 1.f);
 }
 
 #if 0
@@ -446,7 +2082,7 @@ void pathfind_geometry_draw_gizmos(Pathfinding *p, Drawer *drawer) {
         draw_circle(drawer, Draw_Layer_GIZMOS, node->position, 4.f, MAGENTA);
 
         for (int j = 0; j < node->num_neighbours; ++j) {
-            Pathfind_Node *neighbour = node->neighbours[j];
+            Pathfind_Node *neighbour = &p->nodes[node->neighbours[j].node];
             draw_line(drawer, Draw_Layer_GIZMOS, node->position, neighbour->position, 1.f, MAGENTA);
         }
     }
@@ -6,6 +6,18 @@
 #include <raylib.h>
 
 #include "draw.h"
+#include "level_floor_grid.h"
+#include "level_floor_sampler.h"
+#include "path_cache.h"
+#include "pathfind_corridors.h"
+#include "pathfind_flow_field.h"
+#include "pathfind_hierarchy.h"
+#include "pathfind_landmarks.h"
+#include "pathfind_pool.h"
+#include "pathfind_query.h"
+#include "pathfind_reachability.h"
+#include "pathfind_replanner.h"
+#include "pathfind_service.h"
 #include "view.h"
 #include "vec.h"
 #include "utils.h"
@@ -63,51 +75,383 @@ typedef struct {
     Geometry_Joint *right;
 } Floor;
 
+// Every connection of every joint has a number of its own, which stays the
+// same whatever happens to the others. Used wherever a floor has to be kept
+// as a plain int.
+#define FLOOR_EDGE(joint, side, kind) (((joint) * JOINT_COUNT + (side)) * CONN_COUNT + (kind))
+#define FLOOR_EDGE_JOINT(edge) ((edge) / JOINT_ALL_CONN_COUNT)
+#define FLOOR_EDGE_SIDE(edge) ((edge) / CONN_COUNT % JOINT_COUNT)
+#define FLOOR_EDGE_KIND(edge) ((edge) % CONN_COUNT)
+
+// A point `t` of the way along floor edge `edge`, from the joint the
+// connection belongs to towards the one it leads to.
+typedef struct Floor_Position {
+    int edge;
+    float t;
+} Floor_Position;
+
+// Which way to go when walking off the end of a floor.
+typedef enum {
+    Floor_Step_UP,
+    Floor_Step_AHEAD,
+    Floor_Step_DOWN,
+    Floor_Step_COUNT
+} Floor_Step;
+
+// Where walking off each side of a joint leads, worked out from its
+// connections and locks whenever they change rather than every step.
+typedef struct {
+    int next[JOINT_COUNT][Floor_Step_COUNT]; // edge to carry on along, -1 to stop at the joint
+    int landing;                             // edge to stand on after falling onto the joint, -1 if none
+} Floor_Transitions;
+
+// How far off a floor a point can be and still be found on it by
+// `level_find_floor`. Enough to soak up the drift from moving things along
+// a floor a frame at a time.
+#define LEVEL_FLOOR_SNAP_TOLERANCE 1.f
+
 #define PATHFIND_NODE_NEIGHBOUR_COUNT ((CONN_COUNT) * 2)
 
-typedef struct Pathfind_Node {
+// An edge is one of the joint's own connections, so the graph is directed:
+// falls only go down and a connection that's locked from one side can
+// still be used from the other.
+//
+// NOTE: Everything about the connection's geometry is worked out once when
+//       the graph is built so searches and floor movement never have to.
+//       `locked` mirrors the joint's lock and is kept in sync by
+//       `level_geometry_set_locked`.
+typedef struct {
+    int node;
+    Joint_Index side;
+    Connection_Index kind;
+    float length;
+    float slope;  // change in y for every unit moved along x, 0 for falls
+    bool flat;
+    bool locked;
+} Pathfind_Edge;
+
+// NOTE: The pathfinding graph is never written to by a search. All of the
+//       per-search state lives in a `Pathfind_Query` so any number of them
+//       can run against the same level at once.
+typedef struct {
     Vector2 position;
-    float g_score;
-    float h_score;
-    struct Pathfind_Node *comes_from;
     int num_neighbours;
-    struct Pathfind_Node *neighbours[PATHFIND_NODE_NEIGHBOUR_COUNT];
+    Pathfind_Edge neighbours[PATHFIND_NODE_NEIGHBOUR_COUNT];
 } Pathfind_Node;
 
 DEFINE_VEC_FOR_TYPE(Pathfind_Node);
-DEFINE_VEC_FOR_TYPE_WITH_NAME(Pathfind_Node *, Pathfind_Node_Ptr);
 
+// `predecessors[predecessor_offsets[i]..predecessor_offsets[i + 1]]` are the
+// edges leading into node `i`. Their `node` is the joint the edge starts
+// from and everything else is copied from that joint's edge.
+//
+// `profile_costs[(profile * num_nodes + i) * PATHFIND_NODE_NEIGHBOUR_COUNT + j]`
+// is what taking `nodes[i].neighbours[j]` costs an agent with that profile,
+// infinite if it can't take it at all. Locks aren't included.
 typedef struct {
     size_t num_nodes;
     Pathfind_Node *nodes;
+    int *predecessor_offsets;
+    Pathfind_Edge *predecessors;
+    float *profile_costs;
+    bool mapped;  // the arrays point into a level file and aren't ours to free
 } Pathfinding;
 
+typedef enum {
+    Pathfind_Mode_FLAT,
+    Pathfind_Mode_HIERARCHICAL,
+    Pathfind_Mode_BIDIRECTIONAL,
+    Pathfind_Mode_COUNT
+} Pathfind_Mode;
+
+// A flat search that can be spread out over as many calls to
+// `level_geometry_plan_step` as it takes, so a long one doesn't land on a
+// single frame.
+typedef struct {
+    Pathfind_Query query;
+    Vector2 start;
+    Floor_Position start_position; // `edge` is -1 when the floor is looked up from `start`
+    Vector2 end;
+    Pathfind_Profile profile;
+    int end_joints[2];
+    bool started;        // `query` holds a search in progress
+    bool cacheable;      // the last search finished and `key` and `joints` hold what it found
+    Path_Cache_Key key;
+    Vec_int joints;      // walked from the start floor to the end floor, empty if there's no path
+    unsigned version;    // `level->version` the search in progress started at
+    size_t expanded;     // nodes expanded since `pathfind_plan_begin`, for profiling
+    int steps;           // calls to `level_geometry_plan_step` since then
+} Pathfind_Plan;
+
 typedef struct {
+    float cluster_size; // 0 to skip building the hierarchy
+    int num_landmarks;  // 0 to only use straight line distance as the heuristic
+    int num_workers;    // threads for batched pathfinding, 0 for one less than the number of cores
+    bool contract_corridors; // let A* hop over chains of joints that only lead on to the next
+} Level_Geometry_Options;
+
+// A lock or connection of `joint` changed, bumping the level to `version`.
+typedef struct {
+    unsigned version;
+    int joint;
+    bool opened;  // an unlock or a new connection, which can make a path anywhere shorter
+} Level_Geometry_Change;
+
+DEFINE_VEC_FOR_TYPE(Level_Geometry_Change);
+
+#define LEVEL_GEOMETRY_CHANGE_LOG_CAPACITY 256
+
+typedef struct Level_Geometry {
     Vector2 min_extents;
     Vector2 max_extents;
     size_t num_joints;
     Geometry_Joint *joints;
     size_t num_doors;
     Pathfinding pathfinding;
+    Pathfind_Hierarchy hierarchy;
+    Pathfind_Landmarks landmarks;
+    Pathfind_Reachability reachability;
+    Pathfind_Corridors corridors;
+    Level_Floor_Grid floor_grid;
+    Level_Floor_Sampler floor_sampler;
+    Floor_Transitions *transitions; // one per joint
+    unsigned version; // bumped whenever a connection or a lock changes
+    Vec_Level_Geometry_Change changes; // the most recent changes, oldest first
+    Path_Cache path_cache;
+    int num_workers;
+    Pathfind_Pool *pool; // started by the first batch
+    Pathfind_Service *service; // started by the first async request
 } Level_Geometry;
 
 typedef struct {
-    bool falling;
-    Vector2 desired_position;
-    Floor new_floor;
+    bool falling;            // walked off onto a fall, `position` is at the top of it
+    Floor_Position position;
 } Floor_Movement;
 
-bool pathfind_node_is_neighbours_with(Pathfind_Node *node, Pathfind_Node *neighbour);
+bool pathfind_node_is_neighbours_with(Pathfind_Node *node, int neighbour);
 
+// What `level_geometry_make` uses.
+Level_Geometry_Options level_geometry_default_options(void);
 Level_Geometry level_geometry_make(size_t num_joints, Geometry_Joint *joints);
-Floor_Movement calculate_floor_movement(Level_Geometry *level, Vector2 player_position, Floor player_current_floor, Vector2 player_movement);
+Level_Geometry level_geometry_make_with_options(size_t num_joints, Geometry_Joint *joints, Level_Geometry_Options options);
+// Takes `pathfinding`, `landmarks` and `floor_grid` as they are, e.g. from
+// a level file, rather than working them out again. Landmarks and the grid
+// are only built if they're empty.
+Level_Geometry level_geometry_make_from_parts(
+    size_t num_joints,
+    Geometry_Joint *joints,
+    Pathfinding pathfinding,
+    Pathfind_Landmarks landmarks,
+    Level_Floor_Grid floor_grid,
+    Level_Geometry_Options options
+);
+void level_geometry_free(Level_Geometry *level);
+
+// NOTE: Locks and connections must be changed through these so that
+//       anything derived from them (e.g. cached paths) is invalidated.
+void level_geometry_set_locked(Level_Geometry *level, int joint, Joint_Index side, Connection_Index kind, bool locked);
+void level_geometry_set_connection(Level_Geometry *level, int joint, Joint_Index side, Connection_Index kind, int other);
+// Finds the first change made after `version` so incremental consumers can
+// catch up. Returns false if the log doesn't go back that far.
+bool level_geometry_changes_since(Level_Geometry *level, unsigned version, size_t *first);
+// A lower bound on the cost of getting from `node` to `end` through one of
+// `end_joints`. Uses landmarks when the level has them.
+float level_geometry_heuristic(Level_Geometry *level, int node, Vector2 end, int end_joints[2]);
+// Walks `dx` along x from `position`, taking whichever connection `step`
+// picks if it goes off the end of the floor. Stops at the joint if there's
+// nowhere to go.
+Floor_Movement level_floor_walk(Level_Geometry *level, Floor_Position position, float dx, Floor_Step step);
+// Moves `distance` further down the fall `position` is on. Returns true
+// once it's landed, with `position` on the floor at the bottom.
+bool level_floor_fall(Level_Geometry *level, Floor_Position *position, float distance);
+float level_edge_length(Level_Geometry *level, int edge);
+// Uses a scratch query owned by the calling thread.
 Vec_Vector2 level_geometry_pathfind(Level_Geometry *level, Vector2 start, Vector2 end);
+// Frees the calling thread's scratch query and whatever else searches keep
+// around between calls. Threads that search call it on their way out.
+void pathfind_default_query_free(void);
+Vec_Vector2 level_geometry_pathfind_with_query(Level_Geometry *level, Pathfind_Query *query, Vector2 start, Vector2 end);
+// Whether an agent with `profile` is stopped by locked connections.
+bool pathfind_profile_respects_locks(Pathfind_Profile profile);
+// Searches using the edge costs of `profile`. Only the default profile
+// hops corridors, they're only contracted for the default costs.
+Vec_Vector2 level_geometry_pathfind_with_profile(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    Vector2 end,
+    Pathfind_Profile profile
+);
+// The `_from` versions start from where an agent stands on the floors
+// instead of looking its floor up from a point. Partway down a fall only
+// the bottom of it is in reach.
+Vec_Vector2 level_geometry_pathfind_from(Level_Geometry *level, Floor_Position start, Vector2 end);
+Vec_Vector2 level_geometry_pathfind_from_with_profile(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Floor_Position start,
+    Vector2 end,
+    Pathfind_Profile profile
+);
+// Falls back to a flat search if the level has no hierarchy.
+Vec_Vector2 level_geometry_pathfind_with_mode(Level_Geometry *level, Vector2 start, Vector2 end, Pathfind_Mode mode);
+// Searches forwards from the start and backwards from the end at the same
+// time and stops once the two have met on the shortest path. Doesn't hop
+// corridors. `query->nodes_expanded` of both queries adds up to the work done.
+Vec_Vector2 level_geometry_pathfind_bidirectional(
+    Level_Geometry *level,
+    Pathfind_Query *forward,
+    Pathfind_Query *backward,
+    Vector2 start,
+    Vector2 end
+);
+// One search towards whichever of `goals` turns up first, instead of a
+// search per goal. `goal_index` is set to the goal the path leads to, or
+// -1 if none of them can be reached.
+Vec_Vector2 level_geometry_pathfind_nearest(Level_Geometry *level, Vector2 start, size_t num_goals, Vector2 *goals, int *goal_index);
+Vec_Vector2 level_geometry_pathfind_nearest_with_query(
+    Level_Geometry *level,
+    Pathfind_Query *query,
+    Vector2 start,
+    size_t num_goals,
+    Vector2 *goals,
+    int *goal_index
+);
+Pathfind_Plan pathfind_plan_make(void);
+void pathfind_plan_free(Pathfind_Plan *plan);
+// Forgets whatever `plan` was doing and gets it ready to find a path from
+// `start` to `end`.
+void pathfind_plan_begin(Pathfind_Plan *plan, Vector2 start, Vector2 end);
+void pathfind_plan_begin_with_profile(Pathfind_Plan *plan, Vector2 start, Vector2 end, Pathfind_Profile profile);
+void pathfind_plan_begin_from(Pathfind_Plan *plan, Floor_Position start, Vector2 end, Pathfind_Profile profile);
+// Carries on planning until the path is found, it turns out there isn't
+// one, or `max_expansions` nodes have been expanded or `max_seconds` have
+// passed (0 for no limit). In the last case it returns
+// `Pathfind_Status_IN_PROGRESS` and picks up where it left off next call.
+// The path is appended to `path` once found.
+Pathfind_Status level_geometry_plan_step(
+    Level_Geometry *level,
+    Pathfind_Plan *plan,
+    size_t max_expansions,
+    double max_seconds,
+    Vec_Vector2 *path
+);
+// How many times longer `path` is, walked from `from` by way of
+// `path.items[target]`, than the heuristic says the shortest path to its
+// end could be. Only comparable between paths on the same level, since how
+// close the heuristic gets depends on the level.
+float level_geometry_path_stretch(Level_Geometry *level, Floor_Position from, Vec_Vector2 path, int target);
+// Bends `path`, whose walker at `from` is heading for
+// `path->items[*target]`, to finish at `end` instead. For targets that keep
+// moving: the waypoints up to the joint the path enters its end floor
+// through are kept and only the rest is searched with the costs of
+// `profile`, giving up after `max_expansions`. It also gives up when the
+// bent path's stretch comes out over `max_stretch`. Returns false, leaving
+// `path` untouched, when it needs a full search instead.
+bool level_geometry_repair_path(
+    Level_Geometry *level,
+    Floor_Position from,
+    Vec_Vector2 *path,
+    int *target,
+    Vector2 end,
+    size_t max_expansions,
+    float max_stretch,
+    Pathfind_Profile profile
+);
+// Fills `joints` with the joints walked from the start floor to the end floor.
+bool level_geometry_pathfind_joints(Level_Geometry *level, Pathfind_Query *query, Vector2 start, Vector2 end, Vec_int *joints);
+// Same as `level_geometry_pathfind` but goes through `level->path_cache`.
+// Not thread safe.
+Vec_Vector2 level_geometry_pathfind_cached(Level_Geometry *level, Vector2 start, Vector2 end);
+// Paths for different profiles are cached separately.
+Vec_Vector2 level_geometry_pathfind_cached_with_profile(Level_Geometry *level, Vector2 start, Vector2 end, Pathfind_Profile profile);
+Vec_Vector2 level_geometry_pathfind_cached_from(Level_Geometry *level, Floor_Position start, Vector2 end, Pathfind_Profile profile);
+// Only looks in `level->path_cache`, it never searches. Returns false if the
+// path isn't there, otherwise `path` is filled in (left empty if there's no
+// way to get there). Not thread safe.
+bool level_geometry_pathfind_lookup_from(Level_Geometry *level, Floor_Position start, Vector2 end, Pathfind_Profile profile, Vec_Vector2 *path);
+// Puts what `plan`'s last search found into `level->path_cache`, if it
+// finished at the level's current version. Not thread safe.
+void level_geometry_plan_cache(Level_Geometry *level, Pathfind_Plan *plan);
+// Finds a path from `starts[i]` to `ends[i]` into `out_paths[i]` for every
+// `i` in `0..n`. Searches that miss `level->path_cache` are spread across
+// `level->pool`. Like the cache, the batch itself isn't thread safe.
+void level_geometry_pathfind_batch(Level_Geometry *level, size_t n, Vector2 *starts, Vector2 *ends, Vec_Vector2 *out_paths);
+// Queues up a search on `level->service` and returns straight away. The
+// path is picked up with `level_geometry_pathfind_poll` on a later frame.
+// One already in `level->path_cache` is ready to pick up straight away and
+// what the service finds is put in the cache as it's picked up.
+Pathfind_Ticket level_geometry_pathfind_async(Level_Geometry *level, Vector2 start, Vector2 end);
+Pathfind_Ticket level_geometry_pathfind_async_with_profile(Level_Geometry *level, Vector2 start, Vector2 end, Pathfind_Profile profile);
+Pathfind_Ticket level_geometry_pathfind_async_from(Level_Geometry *level, Floor_Position start, Vector2 end, Pathfind_Profile profile);
+// Returns `Pathfind_Status_IN_PROGRESS` until the path for `ticket` is
+// ready, after which the ticket is used up. A path found before the latest
+// lock or connection change is searched for again rather than handed out.
+Pathfind_Status level_geometry_pathfind_poll(Level_Geometry *level, Pathfind_Ticket ticket, Vec_Vector2 *path);
+// For whoever asked for the path no longer being around to poll for it.
+void level_geometry_pathfind_cancel(Level_Geometry *level, Pathfind_Ticket ticket);
+// Takes one `level_geometry_plan_step` of every plan in `plans`, spread
+// across `level->pool`. `plans[i]` gets `max_expansions[i]` and all of them
+// get the same time budget. Plans that finish are put in
+// `level->path_cache`, so like the cache this isn't thread safe.
+void level_geometry_plan_batch(
+    Level_Geometry *level,
+    size_t n,
+    Pathfind_Plan **plans,
+    size_t *max_expansions,
+    double max_seconds,
+    Pathfind_Status *out_statuses,
+    Vec_Vector2 *out_paths
+);
+Vec_Vector2 level_geometry_path_from_joints(Level_Geometry *level, Vector2 start, Vector2 end, size_t num_joints, int *joints);
+// Same as `level_geometry_path_from_joints` for floors that are already known.
+Vec_Vector2 level_geometry_path_from_joints_on_floors(
+    Level_Geometry *level,
+    Floor starting_floor,
+    Floor ending_floor,
+    Vector2 end,
+    size_t num_joints,
+    int *joints
+);
+// Whether anything at `a` can walk, slide or fall its way to `b` with the
+// current locks. O(1) once the floors of `a` and `b` are known.
+bool level_geometry_is_reachable(Level_Geometry *level, Vector2 a, Vector2 b);
+// How many points `level_geometry_random_reachable_position` tries before
+// settling for the furthest one it found.
+#define LEVEL_RANDOM_POSITION_ATTEMPTS 16
+
+// A point anywhere along the floors, every bit of floor as likely as any
+// other. Falls are left out.
 Vector2 level_geometry_random_position(Level_Geometry *level);
+// A random position that can be reached from `from` and that can get back
+// to `from` again, at least `min_distance` away from it if possible.
+Vector2 level_geometry_random_reachable_position(Level_Geometry *level, Vector2 from, float min_distance);
+Vector2 level_geometry_random_reachable_position_from(Level_Geometry *level, Floor_Position from, float min_distance);
 
 Floor floor_make(Geometry_Joint *a, Geometry_Joint *b);
 bool floor_is_flat(Floor floor);
 bool floor_contains_point(Floor floor, Vector2 point);
+// The floor `position` is on. Falls back to the nearest floor within
+// `LEVEL_FLOOR_SNAP_TOLERANCE` for points that are a hair off all of them.
 Floor level_find_floor(Level_Geometry *level, Vector2 position);
+// `level_find_floor` for each of `positions`.
+void level_find_floors(Level_Geometry *level, size_t count, Vector2 *positions, Floor *floors);
+// The closest point to `position` on any floor that can be stood on (so not
+// a fall) no further than `tolerance` away. False if there isn't one.
+bool level_snap_to_floor(Level_Geometry *level, Vector2 position, float tolerance, Floor_Position *snapped);
+
+// The joint floor edge `edge` leads to, -1 if the connection doesn't exist.
+int level_edge_other(Level_Geometry *level, int edge);
+Floor level_edge_floor(Level_Geometry *level, int edge);
+Vector2 level_floor_position_point(Level_Geometry *level, Floor_Position position);
+// The floor a path from `position` starts on, without looking it up.
+Floor level_floor_position_floor(Level_Geometry *level, Floor_Position position);
+// The same point, named by whichever edge stands in for its floor. When
+// both joints connect to each other that's the one belonging to the lower
+// numbered joint, so the two ways of naming a floor come out the same.
+Floor_Position level_floor_position_canonical(Level_Geometry *level, Floor_Position position);
+// How far along `edge` the point on it closest to `point` is.
+float level_edge_closest_t(Level_Geometry *level, int edge, Vector2 point);
 
 // TODO: Maybe reimplement these for the new system
 #if 0
@@ -0,0 +1,147 @@
+#include "level_occupancy.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// The first occupant of `bucket` at least `t` along it.
+static size_t occupancy_lower_bound(Vec_Level_Occupant *bucket, float t) {
+    size_t low = 0;
+    size_t high = bucket->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (bucket->items[middle].t < t) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+static size_t occupancy_find(Level_Occupancy *occupancy, Level_Occupant_Kind kind, int index) {
+    Level_Occupant_Slot slot = occupancy->slots[kind].items[index];
+    Vec_Level_Occupant *bucket = &occupancy->buckets[slot.edge];
+
+    // NOTE: The slot's `t` is a copy of the occupant's, so it's exactly
+    //       where the occupant is once anything before it is skipped.
+    for (size_t i = occupancy_lower_bound(bucket, slot.t); i < bucket->count && bucket->items[i].t <= slot.t; ++i) {
+        if (bucket->items[i].kind == kind && bucket->items[i].index == index) return i;
+    }
+
+    assert(false && "occupant isn't where its slot says");
+    return 0;
+}
+
+// How far along a bucket's edge `distance` is.
+static float occupancy_distance_t(Level_Geometry *level, int edge, float distance) {
+    float length = level_edge_length(level, edge);
+    return length == 0.f ? INFINITY : distance / length;
+}
+
+Level_Occupancy level_occupancy_make(Level_Geometry *level) {
+    size_t num_buckets = level->num_joints * JOINT_ALL_CONN_COUNT;
+    return (Level_Occupancy){
+        .num_buckets = num_buckets,
+        .buckets = calloc(num_buckets, sizeof(Vec_Level_Occupant))
+    };
+}
+
+void level_occupancy_free(Level_Occupancy *occupancy) {
+    for (size_t i = 0; i < occupancy->num_buckets; ++i) {
+        vec_free(&occupancy->buckets[i]);
+    }
+    free(occupancy->buckets);
+    for (int kind = 0; kind < Level_Occupant_Kind_COUNT; ++kind) {
+        vec_free(&occupancy->slots[kind]);
+    }
+    *occupancy = (Level_Occupancy){0};
+}
+
+void level_occupancy_update(Level_Occupancy *occupancy, Level_Geometry *level, Level_Occupant_Kind kind, int index, Floor_Position position) {
+    assert(index >= 0);
+    Floor_Position canonical = level_floor_position_canonical(level, position);
+    assert((size_t)canonical.edge < occupancy->num_buckets);
+
+    Vec_Level_Occupant_Slot *slots = &occupancy->slots[kind];
+    while (slots->count <= (size_t)index) {
+        vec_append(slots, (Level_Occupant_Slot){ .edge = -1 });
+    }
+
+    Level_Occupant_Slot *slot = &slots->items[index];
+    if (slot->edge == canonical.edge) {
+        Vec_Level_Occupant *bucket = &occupancy->buckets[canonical.edge];
+        size_t i = occupancy_find(occupancy, kind, index);
+        Level_Occupant occupant = bucket->items[i];
+        occupant.t = canonical.t;
+
+        while (i > 0 && bucket->items[i - 1].t > occupant.t) {
+            bucket->items[i] = bucket->items[i - 1];
+            --i;
+        }
+        while (i + 1 < bucket->count && bucket->items[i + 1].t < occupant.t) {
+            bucket->items[i] = bucket->items[i + 1];
+            ++i;
+        }
+        bucket->items[i] = occupant;
+    } else {
+        if (slot->edge != -1) {
+            vec_remove_ordered(&occupancy->buckets[slot->edge], occupancy_find(occupancy, kind, index));
+        }
+
+        Vec_Level_Occupant *bucket = &occupancy->buckets[canonical.edge];
+        Level_Occupant occupant = { .kind = kind, .index = index, .t = canonical.t };
+        vec_insert_ordered(bucket, occupancy_lower_bound(bucket, canonical.t), occupant);
+    }
+
+    *slot = (Level_Occupant_Slot){ .edge = canonical.edge, .t = canonical.t };
+}
+
+void level_occupancy_remove(Level_Occupancy *occupancy, Level_Occupant_Kind kind, int index) {
+    Vec_Level_Occupant_Slot *slots = &occupancy->slots[kind];
+    if ((size_t)index >= slots->count || slots->items[index].edge == -1) return;
+
+    vec_remove_ordered(&occupancy->buckets[slots->items[index].edge], occupancy_find(occupancy, kind, index));
+    slots->items[index].edge = -1;
+}
+
+void level_occupancy_truncate(Level_Occupancy *occupancy, Level_Occupant_Kind kind, size_t count) {
+    Vec_Level_Occupant_Slot *slots = &occupancy->slots[kind];
+    for (size_t i = count; i < slots->count; ++i) {
+        level_occupancy_remove(occupancy, kind, i);
+    }
+    if (slots->count > count) slots->count = count;
+}
+
+void level_occupancy_near(Level_Occupancy *occupancy, Level_Geometry *level, Floor_Position position, float distance, Vec_Level_Occupant *out) {
+    Floor_Position canonical = level_floor_position_canonical(level, position);
+    Vec_Level_Occupant *bucket = &occupancy->buckets[canonical.edge];
+    float dt = occupancy_distance_t(level, canonical.edge, distance);
+
+    for (size_t i = occupancy_lower_bound(bucket, canonical.t - dt); i < bucket->count; ++i) {
+        if (bucket->items[i].t > canonical.t + dt) break;
+        vec_append(out, bucket->items[i]);
+    }
+}
+
+void level_occupancy_pairs(Level_Occupancy *occupancy, Level_Geometry *level, float distance, Vec_Level_Occupant_Pair *out) {
+    // NOTE: Each occupant only looks ahead of itself along its bucket, so
+    //       every pair is found by whichever of the two is further back.
+    for (int kind = 0; kind < Level_Occupant_Kind_COUNT; ++kind) {
+        Vec_Level_Occupant_Slot *slots = &occupancy->slots[kind];
+
+        for (size_t index = 0; index < slots->count; ++index) {
+            int edge = slots->items[index].edge;
+            if (edge == -1) continue;
+
+            Vec_Level_Occupant *bucket = &occupancy->buckets[edge];
+            float length = level_edge_length(level, edge);
+            float dt = occupancy_distance_t(level, edge, distance);
+
+            size_t i = occupancy_find(occupancy, kind, index);
+            Level_Occupant a = bucket->items[i];
+            for (size_t j = i + 1; j < bucket->count; ++j) {
+                Level_Occupant b = bucket->items[j];
+                if (b.t - a.t > dt) break;
+                vec_append(out, (Level_Occupant_Pair){ .a = a, .b = b, .distance = (b.t - a.t) * length });
+            }
+        }
+    }
+}
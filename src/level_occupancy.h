@@ -0,0 +1,75 @@
+#ifndef LEVEL_OCCUPANCY_H_
+#define LEVEL_OCCUPANCY_H_
+
+#include <stddef.h>
+
+#include "level_geometry.h"
+#include "vec.h"
+
+typedef enum {
+    Level_Occupant_PLAYER,
+    Level_Occupant_ENEMY,
+    Level_Occupant_INTERACTABLE,
+    Level_Occupant_Kind_COUNT
+} Level_Occupant_Kind;
+
+typedef struct {
+    Level_Occupant_Kind kind;
+    int index;  // into wherever things of that kind are kept
+    float t;    // along the bucket's edge
+} Level_Occupant;
+
+DEFINE_VEC_FOR_TYPE(Level_Occupant);
+
+typedef struct {
+    Level_Occupant a;
+    Level_Occupant b;
+    float distance; // along the floor
+} Level_Occupant_Pair;
+
+DEFINE_VEC_FOR_TYPE(Level_Occupant_Pair);
+
+// Where an occupant is in the buckets, so it can be found again without
+// searching for it.
+typedef struct {
+    int edge;  // -1 if it isn't in the occupancy
+    float t;
+} Level_Occupant_Slot;
+
+DEFINE_VEC_FOR_TYPE(Level_Occupant_Slot);
+
+// Who is standing on which floor. Every floor has a bucket, kept sorted by
+// how far along the floor its occupants are, so everyone near something on
+// the same floor is a short run either side of it rather than everyone in
+// the level.
+//
+// Positions go in through `level_floor_position_canonical`, so a floor that
+// can be walked both ways only has the one bucket.
+//
+// NOTE: Occupants move a little each frame and hardly ever past more than
+//       one or two others, so they're shuffled along their bucket into
+//       place like an insertion sort rather than taken out and put back.
+typedef struct {
+    size_t num_buckets;
+    Vec_Level_Occupant *buckets; // by edge, only the canonical ones are used
+    Vec_Level_Occupant_Slot slots[Level_Occupant_Kind_COUNT];
+} Level_Occupancy;
+
+Level_Occupancy level_occupancy_make(Level_Geometry *level);
+void level_occupancy_free(Level_Occupancy *occupancy);
+
+// Puts the occupant at `position`, wherever it was before.
+void level_occupancy_update(Level_Occupancy *occupancy, Level_Geometry *level, Level_Occupant_Kind kind, int index, Floor_Position position);
+void level_occupancy_remove(Level_Occupancy *occupancy, Level_Occupant_Kind kind, int index);
+// Removes every occupant of `kind` from `count` on. For keeping up with
+// `vec_remove` after updating whatever got moved into the gap.
+void level_occupancy_truncate(Level_Occupancy *occupancy, Level_Occupant_Kind kind, size_t count);
+
+// Appends everything on the same floor as `position` that's no more than
+// `distance` along the floor from it.
+void level_occupancy_near(Level_Occupancy *occupancy, Level_Geometry *level, Floor_Position position, float distance, Vec_Level_Occupant *out);
+// Appends every two occupants on the same floor no more than `distance`
+// apart, once each.
+void level_occupancy_pairs(Level_Occupancy *occupancy, Level_Geometry *level, float distance, Vec_Level_Occupant_Pair *out);
+
+#endif
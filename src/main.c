@@ -1,16 +1,20 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 
 #include <raylib.h>
 #include <raymath.h>
 
 #include "camera.h"
+#include "collisions.h"
 #include "draw.h"
 #include "input.h"
 #include "player.h"
 #include "enemy.h"
+#include "level_file.h"
 #include "level_geometry.h"
+#include "level_occupancy.h"
 #include "utils.h"
 
 #define DRAW_GIZMOS 1
@@ -20,8 +24,6 @@
 #define CROSS_OFFSET 7
 #define CROSS_COLOR WHITE
 
-#define BULLET_ORIGIN_OFFSET (Vector2){ .x = 0, .y = -(PLAYER_HEIGHT * 0.65f) }
-
 void draw_crosshair(Vector2 position, Color color, Drawer *drawer) {
     // left
     draw_rectangle(
@@ -89,8 +91,6 @@ void cursor_draw(Vector2 position, Color color, Drawer *drawer) {
 }
 
 int main(int argc, const char **argv) {
-    UNUSED(argc, argv);
-
     srand(time(NULL));
 
     #ifdef DEBUG
@@ -99,10 +99,6 @@ int main(int argc, const char **argv) {
         SetTraceLogLevel(LOG_ERROR);
     #endif
 
-    SetConfigFlags(FLAG_VSYNC_HINT);
-    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "The Game");
-    // SetTargetFPS(120);
-
     Geometry_Joint joints[] = {
         [0] = {
             .position = vec2(0.f, WINDOW_HEIGHT / 2),
@@ -260,8 +256,6 @@ int main(int argc, const char **argv) {
         },
     };
 
-    Level_Geometry level_geometry = level_geometry_make(sizeof(joints) / sizeof(joints[0]), joints);
-
     Level_Object_Interactable interactables[] = {
         {
             .position = vec2(1600.f, WINDOW_HEIGHT / 2),
@@ -303,14 +297,34 @@ int main(int argc, const char **argv) {
         .objects = interactables
     };
 
+    // NOTE: `re2d --export <path>` writes the level above out to a level
+    //       file and `re2d <path>` plays one.
+    Level_File level_file = {0};
+    Level_Geometry level_geometry;
+    if (argc == 3 && strcmp(argv[1], "--export") == 0) {
+        level_geometry = level_geometry_make(sizeof(joints) / sizeof(joints[0]), joints);
+        bool saved = level_file_save(argv[2], &level_geometry, &level_interactables);
+        level_geometry_free(&level_geometry);
+        return saved ? 0 : 1;
+    } else if (argc == 2) {
+        if (!level_file_open(argv[1], &level_file)) {
+            return 1;
+        }
+        level_geometry = level_file_geometry(&level_file, level_geometry_default_options());
+        level_interactables = level_file_interactables(&level_file);
+    } else {
+        level_geometry = level_geometry_make(sizeof(joints) / sizeof(joints[0]), joints);
+    }
+
+    // NOTE: Opened only once there's a level to play, so exporting one
+    //       works without a display.
+    SetConfigFlags(FLAG_VSYNC_HINT);
+    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "The Game");
+    // SetTargetFPS(120);
+
     Inventory player_inventory = {0};
     Vector2 player_start_position = lerpv(level_geometry.joints[0].position, level_geometry.joints[1].position, 0.5f);
-    Player player = {
-        .flags = 0,
-        .position = player_start_position,
-        .current_floor = level_find_floor(&level_geometry, player_start_position),
-        .inventory = &player_inventory
-    };
+    Player player = player_spawn(&level_geometry, player_start_position, &player_inventory);
 
     Camera2D player_camera;
     player_camera.target = player.position;
@@ -320,13 +334,26 @@ int main(int argc, const char **argv) {
     player_camera.zoom = CAMERA_NORMAL_ZOOM;
 
 
+    // NOTE: One of each kind of walker that's still stopped by locks.
     Vec_Enemy enemies = {0};
     for (int i = 0; i < 3; ++i) {
         Vector2 start_position = level_geometry_random_position(&level_geometry);
-        Enemy e = enemy_spawn(start_position);
+        Enemy e = enemy_spawn(&level_geometry, start_position, (Pathfind_Profile)i);
         vec_append(&enemies, e);
     }
 
+    Level_Occupancy occupancy = level_occupancy_make(&level_geometry);
+    for (size_t i = 0; i < level_interactables.num_objects; ++i) {
+        // NOTE: Interactables float about the player's height off the
+        //       floor they're on.
+        Floor_Position floor_position;
+        if (level_snap_to_floor(&level_geometry, level_interactables.objects[i].position, PLAYER_HEIGHT, &floor_position)) {
+            level_occupancy_update(&occupancy, &level_geometry, Level_Occupant_INTERACTABLE, i, floor_position);
+        }
+    }
+
+    Enemy_Crowd enemy_crowd = enemy_crowd_make(&player.floor_position, &occupancy);
+
     Input input = {0};
 
     HideCursor();
@@ -359,15 +386,27 @@ int main(int argc, const char **argv) {
 
         if (IsKeyPressed(KEY_O)) {
             bool is_locked = level_geometry.joints[7].connections[JOINT_RIGHT].locked.straight;
-            level_geometry.joints[7].connections[JOINT_RIGHT].locked.straight = !is_locked;
+            level_geometry_set_locked(&level_geometry, 7, JOINT_RIGHT, CONN_STRAIGHT, !is_locked);
         }
 
+        #ifdef DEBUG
+            if (IsKeyPressed(KEY_P)) {
+                enemy_crowd.planning = enemy_crowd.planning == Enemy_Planning_ASYNC
+                    ? Enemy_Planning_BUDGETED
+                    : Enemy_Planning_ASYNC;
+            }
+        #endif
+
         // Update =============================================================
         player_update_movement(&player, &input, &level_geometry);
-        player_update_aiming(&player, &input, &level_interactables, enemies.count, enemies.items);
+        player_update_aiming(&player, &input, &level_geometry, &level_interactables, enemies.count, enemies.items);
+
+        level_occupancy_update(&occupancy, &level_geometry, Level_Occupant_PLAYER, 0, player.floor_position);
+        enemy_update_all(&enemies, &enemy_crowd, &level_geometry, input.delta_time);
+        for (size_t i = 0; i < level_interactables.num_objects; ++i) {
+            if (level_interactables.objects[i].interacted) level_occupancy_remove(&occupancy, Level_Occupant_INTERACTABLE, i);
+        }
 
-        enemy_update_all(&enemies, &level_geometry, input.delta_time);
-        
         // Late Update ========================================================
         player_camera_update(
             &player_camera,
@@ -381,6 +420,15 @@ int main(int argc, const char **argv) {
         #ifdef DEBUG
             level_geometry_draw_gizmos(&level_geometry, &drawer);
             pathfind_geometry_draw_gizmos(&level_geometry.pathfinding, &drawer);
+            pathfind_hierarchy_draw_gizmos(&level_geometry.hierarchy, &level_geometry, &drawer);
+            debug_draw_text(vec2(30, 55), 16, "path cache: %zu hits, %zu misses, %zu invalidations",
+                level_geometry.path_cache.hits,
+                level_geometry.path_cache.misses,
+                level_geometry.path_cache.invalidations
+            );
+            debug_draw_text(vec2(30, 80), 16, "enemy planning: %s",
+                enemy_crowd.planning == Enemy_Planning_ASYNC ? "async" : "budgeted"
+            );
         #endif
 
         vec_foreach(Enemy, e, enemies) {
@@ -391,8 +439,10 @@ int main(int argc, const char **argv) {
         }
 
         if (is_flags_set(input.flags, Input_Flags_AIMING)) {
-            Vector2 origin = Vector2Add(player.position, BULLET_ORIGIN_OFFSET);
+            Vector2 origin = Vector2Add(player.position, PLAYER_BULLET_ORIGIN_OFFSET);
             Vector2 aiming_position = input.mouse_world_position;
+            Collision collision = level_raycast(&level_geometry, origin, aiming_position);
+            if (collision.hit) aiming_position = collision.point;
             draw_line(&drawer, Draw_Layer_PLAYER, origin, aiming_position, 1.5f, RED);
             draw_circle(&drawer, Draw_Layer_PLAYER, aiming_position, 2.f, RED);
         }
@@ -426,6 +476,16 @@ int main(int argc, const char **argv) {
         EndDrawing();
     }
 
+    vec_foreach(Enemy, e, enemies) {
+        enemy_free(e, &level_geometry);
+    }
+    vec_free(&enemies);
+    enemy_crowd_free(&enemy_crowd);
+    level_occupancy_free(&occupancy);
+    level_geometry_free(&level_geometry);
+    level_file_close(&level_file);
+    pathfind_default_query_free();
+
     drawer_free(&drawer);
     #ifdef DEBUG
         drawer_free(&debug_drawer);
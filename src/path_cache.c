@@ -0,0 +1,80 @@
+#include "path_cache.h"
+
+static bool path_cache_key_equals(Path_Cache_Key a, Path_Cache_Key b) {
+    return a.start_left == b.start_left &&
+           a.start_right == b.start_right &&
+           a.end_left == b.end_left &&
+           a.end_right == b.end_right &&
+           a.profile == b.profile;
+}
+
+int path_cache_key_compare(Path_Cache_Key a, Path_Cache_Key b) {
+    if (a.start_left != b.start_left) return a.start_left < b.start_left ? -1 : 1;
+    if (a.start_right != b.start_right) return a.start_right < b.start_right ? -1 : 1;
+    if (a.end_left != b.end_left) return a.end_left < b.end_left ? -1 : 1;
+    if (a.end_right != b.end_right) return a.end_right < b.end_right ? -1 : 1;
+    if (a.profile != b.profile) return a.profile < b.profile ? -1 : 1;
+    return 0;
+}
+
+Path_Cache_Entry *path_cache_lookup(Path_Cache *cache, unsigned version, Path_Cache_Key key) {
+    if (cache->version != version) {
+        path_cache_clear(cache);
+        cache->version = version;
+        ++cache->invalidations;
+    }
+
+    for (size_t i = 0; i < PATH_CACHE_CAPACITY; ++i) {
+        Path_Cache_Entry *entry = &cache->entries[i];
+        if (entry->occupied && path_cache_key_equals(entry->key, key)) {
+            entry->last_used = ++cache->tick;
+            ++cache->hits;
+            return entry;
+        }
+    }
+
+    ++cache->misses;
+    return NULL;
+}
+
+Path_Cache_Entry *path_cache_insert(Path_Cache *cache, Path_Cache_Key key, bool found, Vec_int joints) {
+    Path_Cache_Entry *victim = &cache->entries[0];
+    for (size_t i = 0; i < PATH_CACHE_CAPACITY; ++i) {
+        Path_Cache_Entry *entry = &cache->entries[i];
+        if (entry->occupied && path_cache_key_equals(entry->key, key)) {
+            victim = entry;
+            break;
+        }
+        // NOTE: Keep looking for `key` even after finding a free entry, two
+        // searches for the same thing can finish one after the other.
+        if (!victim->occupied) {
+            continue;
+        }
+        if (!entry->occupied || entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    vec_free(&victim->joints);
+    *victim = (Path_Cache_Entry){
+        .occupied = true,
+        .found = found,
+        .key = key,
+        .joints = joints,
+        .last_used = ++cache->tick
+    };
+
+    return victim;
+}
+
+void path_cache_clear(Path_Cache *cache) {
+    for (size_t i = 0; i < PATH_CACHE_CAPACITY; ++i) {
+        Path_Cache_Entry *entry = &cache->entries[i];
+        vec_free(&entry->joints);
+        entry->occupied = false;
+    }
+}
+
+void path_cache_free(Path_Cache *cache) {
+    path_cache_clear(cache);
+}
@@ -0,0 +1,51 @@
+#ifndef PATH_CACHE_H_
+#define PATH_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pathfind_query.h"
+#include "vec.h"
+
+#define PATH_CACHE_CAPACITY 64
+
+// A floor is identified by the indexes of its left and right joints.
+typedef struct {
+    int start_left;
+    int start_right;
+    int end_left;
+    int end_right;
+    Pathfind_Profile profile;
+} Path_Cache_Key;
+
+typedef struct {
+    bool occupied;
+    bool found;           // false if the end floor is unreachable
+    Path_Cache_Key key;
+    Vec_int joints;       // joints walked from the start floor to the end floor
+    size_t last_used;
+} Path_Cache_Entry;
+
+// A bounded LRU cache of joint sequences between pairs of floors.
+//
+// Entries are only valid for the `version` of the level they were computed
+// against. Looking something up with a different version empties the cache
+// first, so changing a lock or a connection invalidates it automatically.
+typedef struct {
+    unsigned version;
+    size_t tick;
+    size_t hits;
+    size_t misses;
+    size_t invalidations;
+    Path_Cache_Entry entries[PATH_CACHE_CAPACITY];
+} Path_Cache;
+
+// Orders keys so that equal ones end up next to each other when sorted.
+int path_cache_key_compare(Path_Cache_Key a, Path_Cache_Key b);
+Path_Cache_Entry *path_cache_lookup(Path_Cache *cache, unsigned version, Path_Cache_Key key);
+// Takes ownership of `joints`. Replaces the entry for `key` if there is one.
+Path_Cache_Entry *path_cache_insert(Path_Cache *cache, Path_Cache_Key key, bool found, Vec_int joints);
+void path_cache_clear(Path_Cache *cache);
+void path_cache_free(Path_Cache *cache);
+
+#endif
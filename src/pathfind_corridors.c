@@ -0,0 +1,174 @@
+#include "pathfind_corridors.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <raymath.h>
+
+#include "level_geometry.h"
+
+// A joint can be skipped over if it has exactly two neighbours and can only
+// go on to the one it didn't come from, either both ways (a -- v -- b) or
+// one way (a -> v -> b).
+static bool corridor_joint_is_candidate(Pathfinding *pathfinding, int v) {
+    Pathfind_Node *node = &pathfinding->nodes[v];
+    int begin = pathfinding->predecessor_offsets[v];
+    int num_in = pathfinding->predecessor_offsets[v + 1] - begin;
+    Pathfind_Edge *in = &pathfinding->predecessors[begin];
+
+    if (node->num_neighbours == 1 && num_in == 1) {
+        return node->neighbours[0].node != in[0].node && node->neighbours[0].node != v && in[0].node != v;
+    }
+
+    if (node->num_neighbours == 2 && num_in == 2) {
+        int a = node->neighbours[0].node;
+        int b = node->neighbours[1].node;
+        if (a == b || a == v || b == v) return false;
+        return (in[0].node == a && in[1].node == b) || (in[0].node == b && in[1].node == a);
+    }
+
+    return false;
+}
+
+static void corridor_refresh_lock(Level_Geometry *level, int corridor) {
+    Pathfind_Corridors *corridors = &level->corridors;
+    Pathfind_Corridor *c = &corridors->corridors.items[corridor];
+
+    c->first_locked = pathfind_corridors_first_locked_after(level, corridor, -1);
+}
+
+// Follows the chain that `nodes[from].neighbours[edge]` starts until it
+// comes out at a joint that isn't a candidate.
+static void corridor_walk(Level_Geometry *level, bool *candidate, int from, int edge) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Corridors *corridors = &level->corridors;
+
+    int index = corridors->corridors.count;
+    Pathfind_Corridor corridor = {
+        .from = from,
+        .first = corridors->joints.count,
+        .first_step = corridors->steps.count
+    };
+
+    int previous = from;
+    int current = pathfinding->nodes[from].neighbours[edge].node;
+    vec_append(&corridors->steps, (Corridor_Step){ .joint = from, .neighbour = edge });
+    corridor.length = pathfinding->nodes[from].neighbours[edge].length;
+
+    while (candidate[current]) {
+        int slot = corridors->node_corridors[current * 2] == -1 ? 0 : 1;
+        corridors->node_corridors[current * 2 + slot] = index;
+        corridors->node_positions[current * 2 + slot] = corridor.count++;
+        vec_append(&corridors->joints, current);
+        vec_append(&corridors->offsets, corridor.length);
+
+        Pathfind_Node *node = &pathfinding->nodes[current];
+        int next = node->num_neighbours == 1 || node->neighbours[0].node != previous ? 0 : 1;
+        vec_append(&corridors->steps, (Corridor_Step){ .joint = current, .neighbour = next });
+
+        previous = current;
+        current = node->neighbours[next].node;
+        corridor.length += node->neighbours[next].length;
+    }
+
+    corridor.to = current;
+    vec_append(&corridors->corridors, corridor);
+    corridors->edge_corridor[from * PATHFIND_NODE_NEIGHBOUR_COUNT + edge] = index;
+    corridor_refresh_lock(level, index);
+}
+
+void pathfind_corridors_build(Level_Geometry *level) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Corridors *corridors = &level->corridors;
+    pathfind_corridors_free(corridors);
+
+    size_t num_nodes = pathfinding->num_nodes;
+    if (num_nodes == 0) return;
+
+    bool *candidate = malloc(num_nodes * sizeof(bool));
+    for (size_t i = 0; i < num_nodes; ++i) {
+        candidate[i] = corridor_joint_is_candidate(pathfinding, i);
+    }
+
+    corridors->edge_corridor = malloc(num_nodes * PATHFIND_NODE_NEIGHBOUR_COUNT * sizeof(int));
+    corridors->node_corridors = malloc(num_nodes * 2 * sizeof(int));
+    corridors->node_positions = malloc(num_nodes * 2 * sizeof(int));
+    memset(corridors->edge_corridor, -1, num_nodes * PATHFIND_NODE_NEIGHBOUR_COUNT * sizeof(int));
+    memset(corridors->node_corridors, -1, num_nodes * 2 * sizeof(int));
+    memset(corridors->node_positions, -1, num_nodes * 2 * sizeof(int));
+
+    // NOTE: Corridors are only walked out of joints that aren't candidates.
+    //       A loop made up of nothing but candidates never gets walked and
+    //       its joints are searched like any other.
+    for (size_t i = 0; i < num_nodes; ++i) {
+        if (candidate[i]) continue;
+
+        Pathfind_Node *node = &pathfinding->nodes[i];
+        for (int j = 0; j < node->num_neighbours; ++j) {
+            if (!candidate[node->neighbours[j].node]) continue;
+            corridor_walk(level, candidate, i, j);
+        }
+    }
+
+    free(candidate);
+}
+
+void pathfind_corridors_free(Pathfind_Corridors *corridors) {
+    vec_free(&corridors->corridors);
+    vec_free(&corridors->joints);
+    vec_free(&corridors->offsets);
+    vec_free(&corridors->steps);
+    free(corridors->edge_corridor);
+    free(corridors->node_corridors);
+    free(corridors->node_positions);
+    *corridors = (Pathfind_Corridors){0};
+}
+
+void pathfind_corridors_update_locks(Level_Geometry *level, int joint) {
+    Pathfind_Corridors *corridors = &level->corridors;
+    if (!corridors->edge_corridor) return;
+
+    for (int k = 0; k < 2; ++k) {
+        int corridor = corridors->node_corridors[joint * 2 + k];
+        if (corridor != -1) corridor_refresh_lock(level, corridor);
+    }
+
+    Pathfind_Node *node = &level->pathfinding.nodes[joint];
+    for (int i = 0; i < node->num_neighbours; ++i) {
+        int corridor = corridors->edge_corridor[joint * PATHFIND_NODE_NEIGHBOUR_COUNT + i];
+        if (corridor != -1) corridor_refresh_lock(level, corridor);
+    }
+}
+
+bool pathfind_corridors_is_interior(Pathfind_Corridors *corridors, int joint) {
+    return corridors->node_corridors && corridors->node_corridors[joint * 2] != -1;
+}
+
+int pathfind_corridors_entered_by(Pathfind_Corridors *corridors, int node, int edge) {
+    if (!corridors->edge_corridor) return -1;
+    return corridors->edge_corridor[node * PATHFIND_NODE_NEIGHBOUR_COUNT + edge];
+}
+
+int pathfind_corridors_position(Pathfind_Corridors *corridors, int corridor, int joint) {
+    if (!corridors->node_corridors) return -1;
+
+    for (int k = 0; k < 2; ++k) {
+        if (corridors->node_corridors[joint * 2 + k] == corridor) {
+            return corridors->node_positions[joint * 2 + k];
+        }
+    }
+    return -1;
+}
+
+int pathfind_corridors_first_locked_after(Level_Geometry *level, int corridor, int position) {
+    Pathfind_Corridors *corridors = &level->corridors;
+    Pathfind_Corridor *c = &corridors->corridors.items[corridor];
+
+    // The step out of the joint at `position` is the one after it.
+    for (int i = position + 1; i <= c->count; ++i) {
+        Corridor_Step step = corridors->steps.items[c->first_step + i];
+        Pathfind_Edge edge = level->pathfinding.nodes[step.joint].neighbours[step.neighbour];
+        if (edge.locked) return i;
+    }
+    return c->count + 1;
+}
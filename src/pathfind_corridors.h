@@ -0,0 +1,63 @@
+#ifndef PATHFIND_CORRIDORS_H_
+#define PATHFIND_CORRIDORS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vec.h"
+
+typedef struct Level_Geometry Level_Geometry;
+
+// One connection walked along a corridor: `neighbour` indexes
+// `nodes[joint].neighbours`.
+typedef struct {
+    int joint;
+    int neighbour;
+} Corridor_Step;
+
+DEFINE_VEC_FOR_TYPE(Corridor_Step);
+
+// A maximal chain of joints that only lead to the next joint in the chain,
+// collapsed into a single weighted edge from `from` to `to`. Two way chains
+// get a corridor in each direction.
+typedef struct {
+    int from;
+    int to;
+    float length;
+    int first;      // into `joints` and `offsets`
+    int first_step; // into `steps`
+    int count;      // joints strictly between `from` and `to`
+    int first_locked; // first locked step, `count + 1` if nothing along the way is locked
+} Pathfind_Corridor;
+
+DEFINE_VEC_FOR_TYPE(Pathfind_Corridor);
+
+// NOTE: A joint inside a corridor is never expanded by a search unless it's
+//       where the search starts or ends. Searches hop from one end of a
+//       corridor to the other and the skipped joints are put back in when
+//       the path is read back.
+typedef struct {
+    Vec_Pathfind_Corridor corridors;
+    Vec_int joints;         // the joints inside each corridor, in walking order
+    Vec_float offsets;      // distance from the corridor's `from` to each of `joints`
+    Vec_Corridor_Step steps; // `count + 1` per corridor, starting with the one out of `from`
+
+    int *edge_corridor;     // [node * PATHFIND_NODE_NEIGHBOUR_COUNT + i]: corridor that edge enters, -1 if none
+    int *node_corridors;    // [node * 2 + k]: corridors a joint is inside of, -1 if none
+    int *node_positions;    // [node * 2 + k]: index of the joint in that corridor
+} Pathfind_Corridors;
+
+void pathfind_corridors_build(Level_Geometry *level);
+void pathfind_corridors_free(Pathfind_Corridors *corridors);
+// Refreshes `first_locked` for every corridor a connection of `joint` is part of.
+void pathfind_corridors_update_locks(Level_Geometry *level, int joint);
+
+bool pathfind_corridors_is_interior(Pathfind_Corridors *corridors, int joint);
+// The corridor entered by following `nodes[node].neighbours[edge]`, or -1.
+int pathfind_corridors_entered_by(Pathfind_Corridors *corridors, int node, int edge);
+// Where `joint` is inside `corridor`, or -1 if it isn't.
+int pathfind_corridors_position(Pathfind_Corridors *corridors, int corridor, int joint);
+// The first locked step after the joint at `position`, `count + 1` if none.
+int pathfind_corridors_first_locked_after(Level_Geometry *level, int corridor, int position);
+
+#endif
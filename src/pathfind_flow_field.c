@@ -0,0 +1,204 @@
+#include "pathfind_flow_field.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <raymath.h>
+
+#include "level_geometry.h"
+
+Pathfind_Flow_Field pathfind_flow_field_make(void) {
+    return (Pathfind_Flow_Field){
+        .goal_joints = { -1, -1 },
+        .query = pathfind_query_make()
+    };
+}
+
+void pathfind_flow_field_free(Pathfind_Flow_Field *field) {
+    free(field->next);
+    free(field->distance);
+    pathfind_query_free(&field->query);
+    *field = pathfind_flow_field_make();
+}
+
+static void flow_field_compute(Level_Geometry *level, Pathfind_Flow_Field *field) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Query *query = &field->query;
+
+    if (field->num_nodes != pathfinding->num_nodes) {
+        field->num_nodes = pathfinding->num_nodes;
+        field->next = realloc(field->next, field->num_nodes * sizeof(int));
+        field->distance = realloc(field->distance, field->num_nodes * sizeof(float));
+    }
+
+    pathfind_query_begin(query, pathfinding->num_nodes);
+    for (int i = 0; i < 2; ++i) {
+        int goal = field->goal_joints[i];
+        pathfind_query_touch(query, goal);
+        query->g_score[goal] = 0.f;
+        pathfind_query_open(query, goal);
+    }
+
+    // Walks the edges backwards so `g_score` ends up as the distance from
+    // each joint to the goal and `comes_from` as the joint to go to next.
+    while (query->open_set.entries.count != 0) {
+        int current = pathfind_heap_pop(&query->open_set);
+        ++query->nodes_expanded;
+
+        int begin = pathfinding->predecessor_offsets[current];
+        int end = pathfinding->predecessor_offsets[current + 1];
+        for (int i = begin; i < end; ++i) {
+            Pathfind_Edge edge = pathfinding->predecessors[i];
+            if (edge.locked) continue;
+
+            int predecessor = edge.node;
+            pathfind_query_touch(query, predecessor);
+
+            float tentative_g_score = query->g_score[current] + edge.length;
+            if (tentative_g_score < query->g_score[predecessor]) {
+                query->g_score[predecessor] = tentative_g_score;
+                query->comes_from[predecessor] = current;
+                pathfind_query_open(query, predecessor);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < field->num_nodes; ++i) {
+        field->distance[i] = pathfind_query_g_score(query, i);
+        field->next[i] = field->distance[i] == INFINITY ? -1 : query->comes_from[i];
+    }
+
+    field->version = level->version;
+    ++field->recomputes;
+}
+
+bool pathfind_flow_field_update(Level_Geometry *level, Pathfind_Flow_Field *field, Floor_Position goal) {
+    Floor floor = level_floor_position_floor(level, goal);
+
+    int left = floor.left - level->joints;
+    int right = floor.right - level->joints;
+    field->goal = level_floor_position_point(level, goal);
+
+    bool same_floor =
+        (field->goal_joints[0] == left && field->goal_joints[1] == right) ||
+        (field->goal_joints[0] == right && field->goal_joints[1] == left);
+    if (same_floor && field->version == level->version) {
+        return false;
+    }
+
+    field->goal_joints[0] = left;
+    field->goal_joints[1] = right;
+    flow_field_compute(level, field);
+    return true;
+}
+
+static bool flow_field_is_goal(Pathfind_Flow_Field *field, int joint) {
+    return joint == field->goal_joints[0] || joint == field->goal_joints[1];
+}
+
+// The joint at either end of `floor` that's the shortest way to the goal
+// from `position`, or -1 if neither end can get there.
+static int flow_field_best_exit(Level_Geometry *level, Pathfind_Flow_Field *field, Floor floor, Vector2 position) {
+    int ends[2] = { floor.left - level->joints, floor.right - level->joints };
+    int best = -1;
+    float best_distance = INFINITY;
+
+    for (int i = 0; i < 2; ++i) {
+        float distance = field->distance[ends[i]];
+        if (distance == INFINITY) continue;
+
+        distance += Vector2Distance(position, level->joints[ends[i]].position);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = ends[i];
+        }
+    }
+
+    return best;
+}
+
+// The joint `position` is stood on, or -1 if it's somewhere along its edge.
+static int flow_field_joint_at(Level_Geometry *level, Floor_Position position) {
+    if (position.t <= 0.f) return FLOOR_EDGE_JOINT(position.edge);
+    if (position.t >= 1.f) return level_edge_other(level, position.edge);
+    return -1;
+}
+
+bool pathfind_flow_field_next_waypoint(Level_Geometry *level, Pathfind_Flow_Field *field, Floor_Position position, Vector2 *waypoint) {
+    assert(field->goal_joints[0] != -1 && "flow field hasn't been pointed at a goal");
+
+    Floor floor = level_floor_position_floor(level, position);
+    if (floor_contains_point(floor, field->goal)) {
+        *waypoint = field->goal;
+        return true;
+    }
+
+    int exit = flow_field_best_exit(level, field, floor, level_floor_position_point(level, position));
+    if (exit == -1) return false;
+
+    // Standing on the exit already means it's time for the joint after it.
+    if (exit == flow_field_joint_at(level, position) && !flow_field_is_goal(field, exit)) {
+        exit = field->next[exit];
+    }
+
+    *waypoint = level->joints[exit].position;
+    return true;
+}
+
+Vec_Vector2 pathfind_flow_field_path(Level_Geometry *level, Pathfind_Flow_Field *field, Floor_Position start) {
+    assert(field->goal_joints[0] != -1 && "flow field hasn't been pointed at a goal");
+
+    Vec_Vector2 path = {0};
+
+    Floor floor = level_floor_position_floor(level, start);
+    if (floor_contains_point(floor, field->goal)) {
+        vec_append(&path, field->goal);
+        return path;
+    }
+
+    int joint = flow_field_best_exit(level, field, floor, level_floor_position_point(level, start));
+    if (joint == -1) return path;
+
+    // NOTE: Built from the start and then flipped so the first waypoint
+    //       ends up at the back like every other path.
+    for (; joint != -1; joint = field->next[joint]) {
+        vec_append(&path, level->joints[joint].position);
+    }
+
+    // Both goal joints have a distance of 0 so the walk stops on whichever
+    // it reaches first. If the goal is further along the floor the other
+    // joint is never needed.
+    vec_append(&path, field->goal);
+
+    for (size_t i = 0; i < path.count / 2; ++i) {
+        Vector2 tmp = path.items[i];
+        path.items[i] = path.items[path.count - 1 - i];
+        path.items[path.count - 1 - i] = tmp;
+    }
+
+    return path;
+}
+
+#ifdef DEBUG
+
+void pathfind_flow_field_draw_gizmos(Pathfind_Flow_Field *field, Level_Geometry *level, Drawer *drawer) {
+    if (field->goal_joints[0] == -1) return;
+
+    for (size_t i = 0; i < field->num_nodes; ++i) {
+        int next = field->next[i];
+        if (next == -1) continue;
+
+        Vector2 from = level->joints[i].position;
+        Vector2 to = level->joints[next].position;
+        Vector2 head = lerpv(from, to, 0.8f);
+        draw_line(drawer, Draw_Layer_GIZMOS, from, head, 2.f, SKYBLUE);
+        draw_circle(drawer, Draw_Layer_GIZMOS, head, 3.f, SKYBLUE);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        draw_circle(drawer, Draw_Layer_GIZMOS, level->joints[field->goal_joints[i]].position, 8.f, SKYBLUE);
+    }
+}
+
+#endif // DEBUG
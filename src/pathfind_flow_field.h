@@ -0,0 +1,58 @@
+#ifndef PATHFIND_FLOW_FIELD_H_
+#define PATHFIND_FLOW_FIELD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <raylib.h>
+
+#include "pathfind_query.h"
+#include "utils.h"
+
+typedef struct Level_Geometry Level_Geometry;
+typedef struct Floor_Position Floor_Position;
+
+// The result of one reverse Dijkstra from the two joints of a goal floor.
+// Every joint knows the next joint on its shortest path to the goal floor
+// and how far away it is, so any number of agents heading for the same
+// floor can share the one search.
+//
+// NOTE: Distances are measured to the goal floor's joints rather than the
+//       goal itself so that the goal can move around on its floor without
+//       the field going stale. Agents that make it onto the goal floor
+//       walk straight to the goal.
+typedef struct {
+    int goal_joints[2];  // -1 until the first update
+    Vector2 goal;
+    unsigned version;    // `level->version` the field was computed against
+
+    size_t num_nodes;
+    int *next;           // -1 for goal joints and joints that can't reach the goal
+    float *distance;     // infinite if the goal can't be reached
+    Pathfind_Query query;
+
+    size_t recomputes;   // used for profiling
+} Pathfind_Flow_Field;
+
+Pathfind_Flow_Field pathfind_flow_field_make(void);
+void pathfind_flow_field_free(Pathfind_Flow_Field *field);
+
+// Points the field at `goal`. Only searches again if `goal` is on a
+// different floor or a lock or connection has changed since the last
+// search. Returns true if it searched.
+bool pathfind_flow_field_update(Level_Geometry *level, Pathfind_Flow_Field *field, Floor_Position goal);
+
+// The next point to walk to from `position`. Returns false if the goal
+// can't be reached from there.
+bool pathfind_flow_field_next_waypoint(Level_Geometry *level, Pathfind_Flow_Field *field, Floor_Position position, Vector2 *waypoint);
+
+// Follows the field from `start` all the way to the goal. The path is laid
+// out like `level_geometry_pathfind`'s and is empty if there isn't one.
+Vec_Vector2 pathfind_flow_field_path(Level_Geometry *level, Pathfind_Flow_Field *field, Floor_Position start);
+
+#ifdef DEBUG
+#include "draw.h"
+void pathfind_flow_field_draw_gizmos(Pathfind_Flow_Field *field, Level_Geometry *level, Drawer *drawer);
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+#include "pathfind_heap.h"
+
+#include <assert.h>
+
+static bool pathfind_heap_entry_is_better(Pathfind_Heap_Entry a, Pathfind_Heap_Entry b) {
+    if (a.priority != b.priority) return a.priority < b.priority;
+    return a.tiebreak < b.tiebreak;
+}
+
+static void pathfind_heap_place(Pathfind_Heap *heap, size_t index, Pathfind_Heap_Entry entry) {
+    heap->entries.items[index] = entry;
+    heap->positions[entry.node] = index;
+}
+
+static void pathfind_heap_sift_up(Pathfind_Heap *heap, size_t index) {
+    Pathfind_Heap_Entry entry = heap->entries.items[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!pathfind_heap_entry_is_better(entry, heap->entries.items[parent])) break;
+        pathfind_heap_place(heap, index, heap->entries.items[parent]);
+        index = parent;
+    }
+    pathfind_heap_place(heap, index, entry);
+}
+
+static void pathfind_heap_sift_down(Pathfind_Heap *heap, size_t index) {
+    Pathfind_Heap_Entry entry = heap->entries.items[index];
+    size_t count = heap->entries.count;
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= count) break;
+        if (child + 1 < count &&
+            pathfind_heap_entry_is_better(heap->entries.items[child + 1], heap->entries.items[child]))
+        {
+            ++child;
+        }
+        if (!pathfind_heap_entry_is_better(heap->entries.items[child], entry)) break;
+        pathfind_heap_place(heap, index, heap->entries.items[child]);
+        index = child;
+    }
+    pathfind_heap_place(heap, index, entry);
+}
+
+bool pathfind_heap_contains(Pathfind_Heap *heap, int node) {
+    return heap->positions[node] != -1;
+}
+
+Pathfind_Heap_Entry pathfind_heap_top(Pathfind_Heap *heap) {
+    assert(heap->entries.count != 0);
+    return heap->entries.items[0];
+}
+
+void pathfind_heap_push(Pathfind_Heap *heap, int node, float priority, float tiebreak) {
+    Pathfind_Heap_Entry entry = { .node = node, .priority = priority, .tiebreak = tiebreak };
+
+    int position = heap->positions[node];
+    if (position == -1) {
+        vec_append(&heap->entries, entry);
+        pathfind_heap_sift_up(heap, heap->entries.count - 1);
+        return;
+    }
+
+    Pathfind_Heap_Entry old = heap->entries.items[position];
+    heap->entries.items[position] = entry;
+    if (pathfind_heap_entry_is_better(entry, old)) {
+        pathfind_heap_sift_up(heap, position);
+    } else {
+        pathfind_heap_sift_down(heap, position);
+    }
+}
+
+int pathfind_heap_pop(Pathfind_Heap *heap) {
+    int node = pathfind_heap_top(heap).node;
+    pathfind_heap_remove(heap, node);
+    return node;
+}
+
+void pathfind_heap_remove(Pathfind_Heap *heap, int node) {
+    int position = heap->positions[node];
+    assert(position != -1);
+    heap->positions[node] = -1;
+
+    Pathfind_Heap_Entry last = heap->entries.items[--heap->entries.count];
+    if ((size_t)position == heap->entries.count) return;
+
+    Pathfind_Heap_Entry removed = heap->entries.items[position];
+    pathfind_heap_place(heap, position, last);
+    if (pathfind_heap_entry_is_better(last, removed)) {
+        pathfind_heap_sift_up(heap, position);
+    } else {
+        pathfind_heap_sift_down(heap, position);
+    }
+}
+
+void pathfind_heap_clear(Pathfind_Heap *heap) {
+    for (size_t i = 0; i < heap->entries.count; ++i) {
+        heap->positions[heap->entries.items[i].node] = -1;
+    }
+    vec_clear(&heap->entries);
+}
+
+void pathfind_heap_free(Pathfind_Heap *heap) {
+    vec_free(&heap->entries);
+}
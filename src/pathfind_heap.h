@@ -0,0 +1,41 @@
+#ifndef PATHFIND_HEAP_H_
+#define PATHFIND_HEAP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vec.h"
+
+typedef struct {
+    int node;
+    float priority;
+    float tiebreak;
+} Pathfind_Heap_Entry;
+
+DEFINE_VEC_FOR_TYPE(Pathfind_Heap_Entry);
+
+// A binary min-heap of node indices ordered by (`priority`, `tiebreak`).
+//
+// `positions` maps a node index to where that node lives in `entries`, or
+// -1 if it isn't in the heap. It's owned by whoever owns the heap and must
+// be at least as big as the largest node index pushed. Keeping it around
+// means membership tests are O(1) and a node's priority can be changed in
+// place.
+typedef struct {
+    Vec_Pathfind_Heap_Entry entries;
+    int *positions;
+} Pathfind_Heap;
+
+bool pathfind_heap_contains(Pathfind_Heap *heap, int node);
+Pathfind_Heap_Entry pathfind_heap_top(Pathfind_Heap *heap);
+
+// Inserts `node` or, if it's already in the heap, moves it to its new priority.
+void pathfind_heap_push(Pathfind_Heap *heap, int node, float priority, float tiebreak);
+int pathfind_heap_pop(Pathfind_Heap *heap);
+void pathfind_heap_remove(Pathfind_Heap *heap, int node);
+
+// Empties the heap and resets `positions` for every node that was in it.
+void pathfind_heap_clear(Pathfind_Heap *heap);
+void pathfind_heap_free(Pathfind_Heap *heap);
+
+#endif
@@ -0,0 +1,439 @@
+#include "pathfind_hierarchy.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <raymath.h>
+
+#include "level_geometry.h"
+
+typedef struct {
+    int clusters[2];         // only nodes inside these clusters are expanded
+    bool backward;           // follow predecessors, g becomes the cost to the seeds
+    int target;              // stop once this node is expanded, -1 to flood the clusters
+} Cluster_Search;
+
+static int hierarchy_cluster_at(Pathfind_Hierarchy *hierarchy, Vector2 position) {
+    int column = (position.x - hierarchy->origin.x) / hierarchy->cluster_size;
+    int row = (position.y - hierarchy->origin.y) / hierarchy->cluster_size;
+    column = Clamp(column, 0, hierarchy->columns - 1);
+    row = Clamp(row, 0, hierarchy->rows - 1);
+    return row * hierarchy->columns + column;
+}
+
+static bool cluster_search_allows(Pathfind_Hierarchy *hierarchy, Cluster_Search *search, int node) {
+    int cluster = hierarchy->node_cluster[node];
+    return cluster == search->clusters[0] || cluster == search->clusters[1];
+}
+
+static void cluster_search_seed(Level_Geometry *level, Pathfind_Query *query, Cluster_Search *search, int node, float cost) {
+    if (pathfind_query_touch(query, node) && search->target != -1) {
+        Pathfinding *pathfinding = &level->pathfinding;
+        query->h_score[node] = Vector2Distance(pathfinding->nodes[node].position, pathfinding->nodes[search->target].position);
+    }
+
+    if (cost < query->g_score[node]) {
+        query->g_score[node] = cost;
+        pathfind_query_open(query, node);
+    }
+}
+
+static void cluster_search_relax(Level_Geometry *level, Pathfind_Query *query, Cluster_Search *search, int from, int to, float distance) {
+    Pathfinding *pathfinding = &level->pathfinding;
+
+    if (pathfind_query_touch(query, to) && search->target != -1) {
+        query->h_score[to] = Vector2Distance(pathfinding->nodes[to].position, pathfinding->nodes[search->target].position);
+    }
+
+    float tentative_g_score = query->g_score[from] + distance;
+    if (tentative_g_score < query->g_score[to]) {
+        query->g_score[to] = tentative_g_score;
+        query->comes_from[to] = from;
+        pathfind_query_open(query, to);
+    }
+}
+
+// Dijkstra (or A* when there's a target) that never leaves the search's
+// clusters. The caller begins the query and seeds it.
+static void cluster_search_run(Level_Geometry *level, Pathfind_Query *query, Cluster_Search *search) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Hierarchy *hierarchy = &level->hierarchy;
+
+    while (query->open_set.entries.count != 0) {
+        int current = pathfind_heap_pop(&query->open_set);
+        ++query->nodes_expanded;
+
+        if (current == search->target) break;
+
+        if (search->backward) {
+            int begin = pathfinding->predecessor_offsets[current];
+            int end = pathfinding->predecessor_offsets[current + 1];
+            for (int i = begin; i < end; ++i) {
+                Pathfind_Edge edge = pathfinding->predecessors[i];
+                if (!cluster_search_allows(hierarchy, search, edge.node)) continue;
+                if (edge.locked) continue;
+                cluster_search_relax(level, query, search, current, edge.node, edge.length);
+            }
+        } else {
+            Pathfind_Node *node = &pathfinding->nodes[current];
+            for (int i = 0; i < node->num_neighbours; ++i) {
+                Pathfind_Edge edge = node->neighbours[i];
+                if (!cluster_search_allows(hierarchy, search, edge.node)) continue;
+                if (edge.locked) continue;
+                cluster_search_relax(level, query, search, current, edge.node, edge.length);
+            }
+        }
+    }
+}
+
+static void hierarchy_build_cluster(Level_Geometry *level, Pathfind_Query *query, int cluster) {
+    Pathfind_Hierarchy *hierarchy = &level->hierarchy;
+    Vec_int *entrances = &hierarchy->clusters[cluster].entrances;
+
+    for (size_t i = 0; i < entrances->count; ++i) {
+        Hierarchy_Entrance *from = &hierarchy->entrances.items[entrances->items[i]];
+        vec_clear(&from->intra);
+
+        Cluster_Search search = { .clusters = { cluster, cluster }, .target = -1 };
+        pathfind_query_begin(query, level->pathfinding.num_nodes);
+        cluster_search_seed(level, query, &search, from->joint, 0.f);
+        cluster_search_run(level, query, &search);
+
+        for (size_t j = 0; j < entrances->count; ++j) {
+            if (i == j) continue;
+
+            int to = entrances->items[j];
+            float cost = pathfind_query_g_score(query, hierarchy->entrances.items[to].joint);
+            if (cost == INFINITY) continue;
+
+            vec_append(&from->intra, (Hierarchy_Edge){ .to = to, .cost = cost });
+        }
+    }
+}
+
+void pathfind_hierarchy_build(Level_Geometry *level, float cluster_size) {
+    Pathfind_Hierarchy *hierarchy = &level->hierarchy;
+    pathfind_hierarchy_free(hierarchy);
+
+    if (cluster_size <= 0.f || level->num_joints == 0) return;
+
+    Pathfinding *pathfinding = &level->pathfinding;
+    size_t num_nodes = pathfinding->num_nodes;
+
+    Vector2 min = pathfinding->nodes[0].position;
+    Vector2 max = min;
+    for (size_t i = 1; i < num_nodes; ++i) {
+        Vector2 p = pathfinding->nodes[i].position;
+        min = vec2(fminf(min.x, p.x), fminf(min.y, p.y));
+        max = vec2(fmaxf(max.x, p.x), fmaxf(max.y, p.y));
+    }
+
+    hierarchy->cluster_size = cluster_size;
+    hierarchy->origin = min;
+    hierarchy->columns = (max.x - min.x) / cluster_size + 1;
+    hierarchy->rows = (max.y - min.y) / cluster_size + 1;
+    hierarchy->clusters = calloc(hierarchy->columns * hierarchy->rows, sizeof(Hierarchy_Cluster));
+    hierarchy->node_cluster = malloc(num_nodes * sizeof(int));
+    hierarchy->node_entrance = malloc(num_nodes * sizeof(int));
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        hierarchy->node_cluster[i] = hierarchy_cluster_at(hierarchy, pathfinding->nodes[i].position);
+        hierarchy->node_entrance[i] = -1;
+    }
+
+    // NOTE: Locked connections still make entrances so that unlocking them
+    //       later doesn't change the shape of the abstract graph.
+    for (size_t i = 0; i < num_nodes; ++i) {
+        Pathfind_Node *node = &pathfinding->nodes[i];
+        for (int j = 0; j < node->num_neighbours; ++j) {
+            int neighbour = node->neighbours[j].node;
+            if (hierarchy->node_cluster[i] == hierarchy->node_cluster[neighbour]) continue;
+
+            int ends[2] = { i, neighbour };
+            for (int k = 0; k < 2; ++k) {
+                int joint = ends[k];
+                if (hierarchy->node_entrance[joint] != -1) continue;
+
+                int cluster = hierarchy->node_cluster[joint];
+                hierarchy->node_entrance[joint] = hierarchy->entrances.count;
+                vec_append(&hierarchy->clusters[cluster].entrances, hierarchy->entrances.count);
+                vec_append(&hierarchy->entrances, (Hierarchy_Entrance){ .joint = joint, .cluster = cluster });
+            }
+        }
+    }
+
+    Pathfind_Query query = pathfind_query_make();
+    for (int c = 0; c < hierarchy->columns * hierarchy->rows; ++c) {
+        hierarchy_build_cluster(level, &query, c);
+    }
+    pathfind_query_free(&query);
+}
+
+void pathfind_hierarchy_rebuild_cluster_of(Level_Geometry *level, int joint) {
+    Pathfind_Hierarchy *hierarchy = &level->hierarchy;
+    if (hierarchy->cluster_size <= 0.f) return;
+
+    Pathfind_Query query = pathfind_query_make();
+    hierarchy_build_cluster(level, &query, hierarchy->node_cluster[joint]);
+    pathfind_query_free(&query);
+}
+
+void pathfind_hierarchy_free(Pathfind_Hierarchy *hierarchy) {
+    if (hierarchy->clusters) {
+        for (int c = 0; c < hierarchy->columns * hierarchy->rows; ++c) {
+            vec_free(&hierarchy->clusters[c].entrances);
+        }
+    }
+    vec_foreach(Hierarchy_Entrance, e, hierarchy->entrances) {
+        vec_free(&e->intra);
+    }
+    vec_free(&hierarchy->entrances);
+    free(hierarchy->clusters);
+    free(hierarchy->node_cluster);
+    free(hierarchy->node_entrance);
+    *hierarchy = (Pathfind_Hierarchy){0};
+}
+
+Hierarchy_Query hierarchy_query_make(void) {
+    return (Hierarchy_Query){0};
+}
+
+void hierarchy_query_free(Hierarchy_Query *query) {
+    pathfind_query_free(&query->start_side);
+    pathfind_query_free(&query->end_side);
+    pathfind_query_free(&query->abstract);
+    pathfind_query_free(&query->refine);
+    vec_free(&query->route);
+}
+
+static void abstract_relax(Pathfind_Query *abstract, int from, int to, float cost, float h_score) {
+    if (pathfind_query_touch(abstract, to)) {
+        abstract->h_score[to] = h_score;
+    }
+    if (abstract->h_score[to] == INFINITY) return; // the end can't be reached from here
+
+    float tentative_g_score = abstract->g_score[from] + cost;
+    if (tentative_g_score < abstract->g_score[to]) {
+        abstract->g_score[to] = tentative_g_score;
+        abstract->comes_from[to] = from;
+        pathfind_query_open(abstract, to);
+    }
+}
+
+// Appends the chain `last`, `comes_from[last]`, ... in reverse so it reads
+// from the first joint to `last`. `skip_first` drops the first joint for
+// when it's already been appended.
+static void append_chain_reversed(Vec_int *joints, Pathfind_Query *query, int last, bool skip_first) {
+    size_t begin = joints->count;
+    for (int n = last; n != -1; n = query->comes_from[n]) {
+        vec_append(joints, n);
+    }
+    if (skip_first) --joints->count;
+
+    for (size_t i = 0; i < (joints->count - begin) / 2; ++i) {
+        int tmp = joints->items[begin + i];
+        joints->items[begin + i] = joints->items[joints->count - 1 - i];
+        joints->items[joints->count - 1 - i] = tmp;
+    }
+}
+
+bool pathfind_hierarchy_search_joints(
+    Level_Geometry *level,
+    Hierarchy_Query *query,
+    Vector2 start,
+    int start_joints[2],
+    Vector2 end,
+    int end_joints[2],
+    Vec_int *joints)
+{
+    Pathfinding *pathfinding = &level->pathfinding;
+    Pathfind_Hierarchy *hierarchy = &level->hierarchy;
+    size_t num_nodes = pathfinding->num_nodes;
+    assert(hierarchy->cluster_size > 0.f);
+
+    vec_clear(joints);
+    query->nodes_expanded = 0;
+
+    if (!pathfind_reachability_floors(&level->reachability, start_joints, end_joints)) {
+        return false;
+    }
+
+    // Cost from the start to every joint in the start's clusters.
+    Cluster_Search start_search = {
+        .clusters = { hierarchy->node_cluster[start_joints[0]], hierarchy->node_cluster[start_joints[1]] },
+        .target = -1
+    };
+    pathfind_query_begin(&query->start_side, num_nodes);
+    for (int i = 0; i < 2; ++i) {
+        float cost = Vector2Distance(start, pathfinding->nodes[start_joints[i]].position);
+        cluster_search_seed(level, &query->start_side, &start_search, start_joints[i], cost);
+    }
+    cluster_search_run(level, &query->start_side, &start_search);
+    query->nodes_expanded += query->start_side.nodes_expanded;
+
+    // Cost from every joint in the end's clusters to the end.
+    Cluster_Search end_search = {
+        .clusters = { hierarchy->node_cluster[end_joints[0]], hierarchy->node_cluster[end_joints[1]] },
+        .backward = true,
+        .target = -1
+    };
+    pathfind_query_begin(&query->end_side, num_nodes);
+    for (int i = 0; i < 2; ++i) {
+        float cost = Vector2Distance(pathfinding->nodes[end_joints[i]].position, end);
+        cluster_search_seed(level, &query->end_side, &end_search, end_joints[i], cost);
+    }
+    cluster_search_run(level, &query->end_side, &end_search);
+    query->nodes_expanded += query->end_side.nodes_expanded;
+
+    // If both searches reached one of the floors then the path might not
+    // need to go through any entrances at all.
+    float direct_cost = INFINITY;
+    int direct_joint = -1;
+    int floor_joints[4] = { start_joints[0], start_joints[1], end_joints[0], end_joints[1] };
+    for (int i = 0; i < 4; ++i) {
+        int joint = floor_joints[i];
+        float cost = pathfind_query_g_score(&query->start_side, joint) + pathfind_query_g_score(&query->end_side, joint);
+        if (cost < direct_cost) {
+            direct_cost = cost;
+            direct_joint = joint;
+        }
+    }
+
+    // Abstract search over the entrances. The start and the end get the two
+    // indexes past the last entrance.
+    Pathfind_Query *abstract = &query->abstract;
+    int abstract_start = hierarchy->entrances.count;
+    int abstract_goal = abstract_start + 1;
+
+    pathfind_query_begin(abstract, hierarchy->entrances.count + 2);
+    pathfind_query_touch(abstract, abstract_start);
+    abstract->g_score[abstract_start] = 0.f;
+    pathfind_query_open(abstract, abstract_start);
+
+    bool found = false;
+    while (abstract->open_set.entries.count != 0) {
+        int current = pathfind_heap_pop(&abstract->open_set);
+        ++query->nodes_expanded;
+
+        if (current == abstract_goal) {
+            found = true;
+            break;
+        }
+
+        if (current == abstract_start) {
+            if (direct_joint != -1) {
+                abstract_relax(abstract, current, abstract_goal, direct_cost, 0.f);
+            }
+
+            for (int i = 0; i < 2; ++i) {
+                if (i == 1 && start_search.clusters[1] == start_search.clusters[0]) break;
+
+                Vec_int *entrances = &hierarchy->clusters[start_search.clusters[i]].entrances;
+                for (size_t j = 0; j < entrances->count; ++j) {
+                    Hierarchy_Entrance *entrance = &hierarchy->entrances.items[entrances->items[j]];
+                    float cost = pathfind_query_g_score(&query->start_side, entrance->joint);
+                    if (cost == INFINITY) continue;
+
+                    float h_score = level_geometry_heuristic(level, entrance->joint, end, end_joints);
+                    abstract_relax(abstract, current, entrances->items[j], cost, h_score);
+                }
+            }
+            continue;
+        }
+
+        Hierarchy_Entrance *entrance = &hierarchy->entrances.items[current];
+
+        float cost_to_goal = pathfind_query_g_score(&query->end_side, entrance->joint);
+        if (cost_to_goal != INFINITY) {
+            abstract_relax(abstract, current, abstract_goal, cost_to_goal, 0.f);
+        }
+
+        vec_foreach(Hierarchy_Edge, edge, entrance->intra) {
+            int to_joint = hierarchy->entrances.items[edge->to].joint;
+            float h_score = level_geometry_heuristic(level, to_joint, end, end_joints);
+            abstract_relax(abstract, current, edge->to, edge->cost, h_score);
+        }
+
+        Pathfind_Node *node = &pathfinding->nodes[entrance->joint];
+        for (int i = 0; i < node->num_neighbours; ++i) {
+            Pathfind_Edge edge = node->neighbours[i];
+            if (hierarchy->node_cluster[edge.node] == entrance->cluster) continue;
+            if (edge.locked) continue;
+
+            float h_score = level_geometry_heuristic(level, edge.node, end, end_joints);
+            abstract_relax(abstract, current, hierarchy->node_entrance[edge.node], edge.length, h_score);
+        }
+    }
+
+    if (!found) return false;
+
+    Vec_int *route = &query->route;
+    vec_clear(route);
+    for (int n = abstract_goal; n != -1; n = abstract->comes_from[n]) {
+        vec_append(route, n);
+    }
+
+    // `route` goes from the goal back to the start.
+    if (route->count == 2) {
+        append_chain_reversed(joints, &query->start_side, direct_joint, false);
+        for (int n = query->end_side.comes_from[direct_joint]; n != -1; n = query->end_side.comes_from[n]) {
+            vec_append(joints, n);
+        }
+        return true;
+    }
+
+    int first = hierarchy->entrances.items[route->items[route->count - 2]].joint;
+    append_chain_reversed(joints, &query->start_side, first, false);
+
+    for (size_t i = route->count - 2; i > 1; --i) {
+        Hierarchy_Entrance *from = &hierarchy->entrances.items[route->items[i]];
+        Hierarchy_Entrance *to = &hierarchy->entrances.items[route->items[i - 1]];
+
+        if (from->cluster != to->cluster) {
+            vec_append(joints, to->joint);
+            continue;
+        }
+
+        Cluster_Search refine = { .clusters = { from->cluster, from->cluster }, .target = to->joint };
+        pathfind_query_begin(&query->refine, num_nodes);
+        cluster_search_seed(level, &query->refine, &refine, from->joint, 0.f);
+        cluster_search_run(level, &query->refine, &refine);
+        query->nodes_expanded += query->refine.nodes_expanded;
+
+        if (pathfind_query_g_score(&query->refine, to->joint) == INFINITY) return false;
+        append_chain_reversed(joints, &query->refine, to->joint, true);
+    }
+
+    int last = hierarchy->entrances.items[route->items[1]].joint;
+    for (int n = query->end_side.comes_from[last]; n != -1; n = query->end_side.comes_from[n]) {
+        vec_append(joints, n);
+    }
+
+    return true;
+}
+
+#ifdef DEBUG
+
+void pathfind_hierarchy_draw_gizmos(Pathfind_Hierarchy *hierarchy, Level_Geometry *level, Drawer *drawer) {
+    if (hierarchy->cluster_size <= 0.f) return;
+
+    for (int r = 0; r < hierarchy->rows; ++r) {
+        for (int c = 0; c < hierarchy->columns; ++c) {
+            Rectangle rect = {
+                .x = hierarchy->origin.x + c * hierarchy->cluster_size,
+                .y = hierarchy->origin.y + r * hierarchy->cluster_size,
+                .width = hierarchy->cluster_size,
+                .height = hierarchy->cluster_size
+            };
+            draw_rectangle_outline(drawer, Draw_Layer_GIZMOS, rect, 1.f, DARKGRAY);
+        }
+    }
+
+    vec_foreach(Hierarchy_Entrance, e, hierarchy->entrances) {
+        draw_circle(drawer, Draw_Layer_GIZMOS, level->joints[e->joint].position, 6.f, ORANGE);
+    }
+}
+
+#endif // DEBUG
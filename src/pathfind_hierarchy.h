@@ -0,0 +1,91 @@
+#ifndef PATHFIND_HIERARCHY_H_
+#define PATHFIND_HIERARCHY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <raylib.h>
+
+#include "pathfind_query.h"
+#include "vec.h"
+
+typedef struct Level_Geometry Level_Geometry;
+
+#define PATHFIND_DEFAULT_CLUSTER_SIZE 1000.f
+
+typedef struct {
+    int to;      // entrance index
+    float cost;
+} Hierarchy_Edge;
+
+DEFINE_VEC_FOR_TYPE(Hierarchy_Edge);
+
+// A joint with a connection into or out of a neighbouring cluster. These
+// are the nodes of the abstract graph. Connections between clusters are
+// read straight from the pathfinding graph, only the costs of getting
+// across a cluster are stored here.
+typedef struct {
+    int joint;
+    int cluster;
+    Vec_Hierarchy_Edge intra;
+} Hierarchy_Entrance;
+
+DEFINE_VEC_FOR_TYPE(Hierarchy_Entrance);
+
+typedef struct {
+    Vec_int entrances;
+} Hierarchy_Cluster;
+
+// The level split into a grid of square clusters for hierarchical (HPA*)
+// searches.
+//
+// RESEARCH: https://webdocs.cs.ualberta.ca/~mmueller/ps/hpastar.pdf
+typedef struct {
+    float cluster_size; // 0 if the hierarchy hasn't been built
+    Vector2 origin;
+    int columns;
+    int rows;
+    Hierarchy_Cluster *clusters;
+    int *node_cluster;
+    int *node_entrance; // -1 if the joint isn't an entrance
+    Vec_Hierarchy_Entrance entrances;
+} Pathfind_Hierarchy;
+
+typedef struct {
+    Pathfind_Query start_side;
+    Pathfind_Query end_side;
+    Pathfind_Query abstract;
+    Pathfind_Query refine;
+    Vec_int route;
+
+    size_t nodes_expanded; // by the last search, across every stage
+} Hierarchy_Query;
+
+void pathfind_hierarchy_build(Level_Geometry *level, float cluster_size);
+// Recomputes the crossing costs of the cluster `joint` is in.
+void pathfind_hierarchy_rebuild_cluster_of(Level_Geometry *level, int joint);
+void pathfind_hierarchy_free(Pathfind_Hierarchy *hierarchy);
+
+Hierarchy_Query hierarchy_query_make(void);
+void hierarchy_query_free(Hierarchy_Query *query);
+
+// Searches the abstract graph between clusters and then refines only the
+// clusters along the chosen route. The result isn't guaranteed to be the
+// shortest path but it's close, and the search only touches a fraction of
+// the joints on big levels.
+bool pathfind_hierarchy_search_joints(
+    Level_Geometry *level,
+    Hierarchy_Query *query,
+    Vector2 start,
+    int start_joints[2],
+    Vector2 end,
+    int end_joints[2],
+    Vec_int *joints
+);
+
+#ifdef DEBUG
+#include "draw.h"
+void pathfind_hierarchy_draw_gizmos(Pathfind_Hierarchy *hierarchy, Level_Geometry *level, Drawer *drawer);
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+#include "pathfind_landmarks.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <raymath.h>
+
+#include "level_geometry.h"
+
+// Fills `distances` with the distance from (or, going `backward`, to)
+// `source` for every node, ignoring locks.
+static void landmark_dijkstra(Level_Geometry *level, Pathfind_Query *query, int source, bool backward, float *distances) {
+    Pathfinding *pathfinding = &level->pathfinding;
+
+    pathfind_query_begin(query, pathfinding->num_nodes);
+    pathfind_query_touch(query, source);
+    query->g_score[source] = 0.f;
+    pathfind_query_open(query, source);
+
+    while (query->open_set.entries.count != 0) {
+        int current = pathfind_heap_pop(&query->open_set);
+
+        Pathfind_Edge *edges;
+        int num_edges;
+        if (backward) {
+            edges = &pathfinding->predecessors[pathfinding->predecessor_offsets[current]];
+            num_edges = pathfinding->predecessor_offsets[current + 1] - pathfinding->predecessor_offsets[current];
+        } else {
+            edges = pathfinding->nodes[current].neighbours;
+            num_edges = pathfinding->nodes[current].num_neighbours;
+        }
+
+        for (int i = 0; i < num_edges; ++i) {
+            int neighbour = edges[i].node;
+            pathfind_query_touch(query, neighbour);
+
+            float tentative_g_score = query->g_score[current] + edges[i].length;
+            if (tentative_g_score < query->g_score[neighbour]) {
+                query->g_score[neighbour] = tentative_g_score;
+                pathfind_query_open(query, neighbour);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < pathfinding->num_nodes; ++i) {
+        distances[i] = pathfind_query_g_score(query, i);
+    }
+}
+
+void pathfind_landmarks_build(Level_Geometry *level, int count) {
+    Pathfind_Landmarks *landmarks = &level->landmarks;
+    pathfind_landmarks_free(landmarks);
+
+    size_t num_nodes = level->pathfinding.num_nodes;
+    if (count <= 0 || num_nodes == 0) return;
+    if ((size_t)count > num_nodes) count = num_nodes;
+
+    landmarks->joints = malloc(count * sizeof(int));
+    landmarks->from = malloc(count * num_nodes * sizeof(float));
+    landmarks->to = malloc(count * num_nodes * sizeof(float));
+
+    // NOTE: Landmarks are picked one at a time as the joint furthest from
+    //       every landmark picked so far, which spreads them out towards
+    //       the edges of the level where they give the tightest bounds.
+    float *closest = malloc(num_nodes * sizeof(float));
+    for (size_t i = 0; i < num_nodes; ++i) {
+        closest[i] = INFINITY;
+    }
+
+    Pathfind_Query query = pathfind_query_make();
+    int next = 0;
+
+    for (int l = 0; l < count; ++l) {
+        float *from = &landmarks->from[l * num_nodes];
+        float *to = &landmarks->to[l * num_nodes];
+
+        landmarks->joints[l] = next;
+        landmark_dijkstra(level, &query, next, false, from);
+        landmark_dijkstra(level, &query, next, true, to);
+        landmarks->count = l + 1;
+
+        float furthest = -1.f;
+        for (size_t i = 0; i < num_nodes; ++i) {
+            float distance = fminf(from[i], to[i]);
+            if (distance < closest[i]) closest[i] = distance;
+
+            // Joints that can't reach or be reached by any landmark yet are
+            // infinitely far away and get picked first.
+            if (closest[i] > furthest) {
+                furthest = closest[i];
+                next = i;
+            }
+        }
+    }
+
+    pathfind_query_free(&query);
+    free(closest);
+}
+
+void pathfind_landmarks_free(Pathfind_Landmarks *landmarks) {
+    if (!landmarks->mapped) {
+        free(landmarks->joints);
+        free(landmarks->from);
+        free(landmarks->to);
+    }
+    *landmarks = (Pathfind_Landmarks){0};
+}
+
+float pathfind_landmarks_bound(Pathfind_Landmarks *landmarks, size_t num_nodes, int from, int to) {
+    float bound = 0.f;
+
+    for (int l = 0; l < landmarks->count; ++l) {
+        float *landmark_from = &landmarks->from[l * num_nodes];
+        float *landmark_to = &landmarks->to[l * num_nodes];
+
+        // d(L, to) <= d(L, from) + d(from, to)
+        // d(from, L) <= d(from, to) + d(to, L)
+        //
+        // NOTE: Infinities fall out right: if `L` reaches `from` but not
+        //       `to`, then `from` can't reach `to` either and the bound is
+        //       infinite. When both are infinite there's nothing to learn
+        //       and the NaN fails the comparison.
+        float a = landmark_from[to] - landmark_from[from];
+        float b = landmark_to[from] - landmark_to[to];
+
+        if (a > bound) bound = a;
+        if (b > bound) bound = b;
+    }
+
+    return bound;
+}
@@ -0,0 +1,34 @@
+#ifndef PATHFIND_LANDMARKS_H_
+#define PATHFIND_LANDMARKS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct Level_Geometry Level_Geometry;
+
+#define PATHFIND_DEFAULT_LANDMARK_COUNT 4
+
+// Graph distances to and from a handful of landmark joints, used to bound
+// the distance between any two joints with the triangle inequality (ALT).
+//
+// NOTE: Distances are measured with every lock open. Locking a connection
+//       can only make paths longer so the bounds stay admissible no matter
+//       what's locked, and only changing a connection needs a rebuild.
+//
+// RESEARCH: https://www.microsoft.com/en-us/research/publication/computing-the-shortest-path-a-search-meets-graph-theory/
+typedef struct {
+    int count;
+    int *joints;
+    float *from; // from[l * num_nodes + v]: distance from landmark `l` to `v`
+    float *to;   // to[l * num_nodes + v]: distance from `v` to landmark `l`
+    bool mapped; // the arrays point into a level file and aren't ours to free
+} Pathfind_Landmarks;
+
+void pathfind_landmarks_build(Level_Geometry *level, int count);
+void pathfind_landmarks_free(Pathfind_Landmarks *landmarks);
+
+// A lower bound on the distance from `from` to `to`. Infinite if `to` can't
+// be reached from `from` at all.
+float pathfind_landmarks_bound(Pathfind_Landmarks *landmarks, size_t num_nodes, int from, int to);
+
+#endif
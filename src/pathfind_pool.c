@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pathfind_pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "level_geometry.h"
+
+static void pathfind_pool_work(Pathfind_Pool *pool, Pathfind_Query *query) {
+    for (;;) {
+        size_t index = atomic_fetch_add(&pool->next, 1);
+        if (index >= pool->count) break;
+        pool->job(pool->data, query, index);
+    }
+}
+
+static void *pathfind_worker_main(void *arg) {
+    Pathfind_Worker *worker = arg;
+    Pathfind_Pool *pool = worker->pool;
+    unsigned seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->quitting && pool->batch == seen) {
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->quitting) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen = pool->batch;
+        pthread_mutex_unlock(&pool->mutex);
+
+        pathfind_pool_work(pool, &worker->query);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    // Jobs may have searched with the thread's own scratch as well.
+    pathfind_default_query_free();
+    return NULL;
+}
+
+Pathfind_Pool *pathfind_pool_make(int num_workers) {
+    if (num_workers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = cores > 1 ? cores - 1 : 0;
+    }
+
+    Pathfind_Pool *pool = calloc(1, sizeof(Pathfind_Pool));
+    pool->caller_query = pathfind_query_make();
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    atomic_init(&pool->next, 0);
+
+    pool->workers = calloc(num_workers, sizeof(Pathfind_Worker));
+    for (int i = 0; i < num_workers; ++i) {
+        Pathfind_Worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->query = pathfind_query_make();
+        if (pthread_create(&worker->thread, NULL, pathfind_worker_main, worker) != 0) {
+            // Whoever did start can carry the load.
+            break;
+        }
+        pool->num_workers = i + 1;
+    }
+
+    return pool;
+}
+
+void pathfind_pool_free(Pathfind_Pool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->quitting = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->num_workers; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+        pathfind_query_free(&pool->workers[i].query);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+    pathfind_query_free(&pool->caller_query);
+    free(pool->workers);
+    free(pool);
+}
+
+void pathfind_pool_run(Pathfind_Pool *pool, size_t count, Pathfind_Pool_Job job, void *data) {
+    if (count == 0) return;
+
+    // NOTE: Waking the workers costs more than a search or two, so small
+    //       batches stay on the calling thread.
+    if (pool->num_workers == 0 || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            job(data, &pool->caller_query, i);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    assert(pool->busy == 0 && "pathfind pool is already running a batch");
+    pool->job = job;
+    pool->data = data;
+    pool->count = count;
+    atomic_store(&pool->next, 0);
+    pool->busy = pool->num_workers;
+    ++pool->batch;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pathfind_pool_work(pool, &pool->caller_query);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->busy != 0) {
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,52 @@
+#ifndef PATHFIND_POOL_H_
+#define PATHFIND_POOL_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pathfind_query.h"
+
+// Called once for every index of a batch, from whichever thread picks it
+// up. `query` is that thread's own scratch state.
+typedef void (*Pathfind_Pool_Job)(void *data, Pathfind_Query *query, size_t index);
+
+typedef struct Pathfind_Pool Pathfind_Pool;
+
+typedef struct {
+    Pathfind_Pool *pool;
+    pthread_t thread;
+    Pathfind_Query query;
+} Pathfind_Worker;
+
+// A fixed set of threads that split the indices of a batch between them.
+// The thread that runs the batch works through it too, so a pool with no
+// workers just runs everything inline.
+struct Pathfind_Pool {
+    int num_workers;
+    Pathfind_Worker *workers;
+    Pathfind_Query caller_query;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    unsigned batch;   // bumped to wake the workers for a new batch
+    int busy;         // workers that haven't finished the current batch
+    bool quitting;
+
+    Pathfind_Pool_Job job;
+    void *data;
+    size_t count;
+    atomic_size_t next;
+};
+
+// `num_workers` of 0 picks one less than the number of cores.
+Pathfind_Pool *pathfind_pool_make(int num_workers);
+void pathfind_pool_free(Pathfind_Pool *pool);
+
+// Calls `job` for every index in `0..count` and returns once they're all
+// done. Only one thread may run a batch on a pool at a time.
+void pathfind_pool_run(Pathfind_Pool *pool, size_t count, Pathfind_Pool_Job job, void *data);
+
+#endif
@@ -0,0 +1,68 @@
+#include "pathfind_query.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+Pathfind_Query pathfind_query_make(void) {
+    return (Pathfind_Query){0};
+}
+
+void pathfind_query_free(Pathfind_Query *query) {
+    free(query->stamps);
+    free(query->g_score);
+    free(query->h_score);
+    free(query->comes_from);
+    free(query->comes_via);
+    free(query->open_set.positions);
+    pathfind_heap_free(&query->open_set);
+    *query = (Pathfind_Query){0};
+}
+
+void pathfind_query_begin(Pathfind_Query *query, size_t num_nodes) {
+    if (query->capacity < num_nodes) {
+        query->stamps = realloc(query->stamps, num_nodes * sizeof(*query->stamps));
+        query->g_score = realloc(query->g_score, num_nodes * sizeof(*query->g_score));
+        query->h_score = realloc(query->h_score, num_nodes * sizeof(*query->h_score));
+        query->comes_from = realloc(query->comes_from, num_nodes * sizeof(*query->comes_from));
+        query->comes_via = realloc(query->comes_via, num_nodes * sizeof(*query->comes_via));
+        query->open_set.positions = realloc(query->open_set.positions, num_nodes * sizeof(int));
+
+        memset(query->stamps, 0, num_nodes * sizeof(*query->stamps));
+        memset(query->open_set.positions, -1, num_nodes * sizeof(int));
+        query->capacity = num_nodes;
+        query->generation = 0;
+    }
+
+    pathfind_heap_clear(&query->open_set);
+
+    // NOTE: A stamp of 0 always means "untouched", so when the generation
+    //       wraps around every stamp has to be cleared for real.
+    if (++query->generation == 0) {
+        memset(query->stamps, 0, query->capacity * sizeof(*query->stamps));
+        query->generation = 1;
+    }
+
+    query->nodes_expanded = 0;
+}
+
+bool pathfind_query_touch(Pathfind_Query *query, int node) {
+    if (query->stamps[node] == query->generation) return false;
+
+    query->stamps[node] = query->generation;
+    query->g_score[node] = INFINITY;
+    query->h_score[node] = 0.f;
+    query->comes_from[node] = -1;
+    query->comes_via[node] = -1;
+    return true;
+}
+
+float pathfind_query_g_score(Pathfind_Query *query, int node) {
+    if (query->stamps[node] != query->generation) return INFINITY;
+    return query->g_score[node];
+}
+
+void pathfind_query_open(Pathfind_Query *query, int node) {
+    float f_score = query->g_score[node] + query->h_score[node];
+    pathfind_heap_push(&query->open_set, node, f_score, query->h_score[node]);
+}
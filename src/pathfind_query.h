@@ -0,0 +1,58 @@
+#ifndef PATHFIND_QUERY_H_
+#define PATHFIND_QUERY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pathfind_heap.h"
+
+typedef enum {
+    Pathfind_Status_IN_PROGRESS,
+    Pathfind_Status_FOUND,
+    Pathfind_Status_NOT_FOUND
+} Pathfind_Status;
+
+// How an agent gets around, which decides what each edge costs it.
+typedef enum {
+    Pathfind_Profile_DEFAULT,       // walks, slides and falls but is stopped by locks
+    Pathfind_Profile_NO_FALLS,      // never takes a fall
+    Pathfind_Profile_AVOIDS_SLOPES, // pays `PATHFIND_SLOPE_COST_FACTOR` times the length of a slope
+    Pathfind_Profile_HAS_KEY,       // goes through locked connections
+    Pathfind_Profile_COUNT
+} Pathfind_Profile;
+
+#define PATHFIND_SLOPE_COST_FACTOR 2.f
+
+// Scratch state for a single search at a time. Nodes are only initialized
+// when a search first touches them (`stamps[i] != generation`), so starting
+// a search costs nothing no matter how big the graph is.
+typedef struct {
+    size_t capacity;
+    unsigned generation;
+    unsigned *stamps;
+    float *g_score;
+    float *h_score;
+    int *comes_from;
+    int *comes_via;   // corridor taken from `comes_from`, -1 for a plain connection
+    Pathfind_Heap open_set;
+    size_t max_expansions; // the search gives up after this many, 0 for no limit
+
+    size_t nodes_expanded; // by the last search, used for profiling
+} Pathfind_Query;
+
+Pathfind_Query pathfind_query_make(void);
+void pathfind_query_free(Pathfind_Query *query);
+
+// Starts a new search over a graph of `num_nodes` nodes.
+void pathfind_query_begin(Pathfind_Query *query, size_t num_nodes);
+// Returns true if this is the first time the current search has touched
+// `node`, in which case its g score is infinite, its h score is 0 and it
+// doesn't come from anywhere (or through any corridor).
+bool pathfind_query_touch(Pathfind_Query *query, int node);
+// The g score of `node` in the current search, infinite if it hasn't been
+// touched yet.
+float pathfind_query_g_score(Pathfind_Query *query, int node);
+// Pushes `node` onto the open set using its current f score.
+void pathfind_query_open(Pathfind_Query *query, int node);
+
+#endif
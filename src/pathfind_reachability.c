@@ -0,0 +1,359 @@
+#include "pathfind_reachability.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "level_geometry.h"
+
+typedef struct {
+    int node;
+    int edge; // next neighbour of `node` to look at
+} Tarjan_Frame;
+
+// Tarjan's algorithm over the joints in components `lo` to `hi`, leaving
+// out connections to any others, or over every joint if there aren't any
+// components yet. Each joint's component is written to `components`,
+// numbered from 0 in the order they finish, and how many there are is
+// returned.
+//
+// NOTE: Iterative so big levels can't blow the stack.
+static size_t reachability_find_components(Level_Geometry *level, Pathfind_Reachability *reachability, int lo, int hi, int *components) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    size_t num_nodes = pathfinding->num_nodes;
+    int *node_component = reachability->node_component;
+
+    int *roots = node_component ? &reachability->component_joints[reachability->component_offsets[lo]] : NULL;
+    size_t num_roots = node_component ? (size_t)(reachability->component_offsets[hi + 1] - reachability->component_offsets[lo]) : num_nodes;
+
+    // Only ever looked at for the joints being searched, so only those
+    // have to be set up.
+    int *index = malloc(num_nodes * sizeof(int));
+    int *lowlink = malloc(num_nodes * sizeof(int));
+    bool *on_stack = malloc(num_nodes * sizeof(bool));
+    int *stack = malloc(num_roots * sizeof(int));
+    Tarjan_Frame *frames = malloc(num_roots * sizeof(Tarjan_Frame));
+    int stack_count = 0;
+    int next_index = 0;
+    size_t num_components = 0;
+
+    for (size_t i = 0; i < num_roots; ++i) {
+        int v = roots ? roots[i] : (int)i;
+        index[v] = -1;
+        on_stack[v] = false;
+    }
+
+    for (size_t i = 0; i < num_roots; ++i) {
+        int root = roots ? roots[i] : (int)i;
+        if (index[root] != -1) continue;
+
+        int num_frames = 0;
+        frames[num_frames++] = (Tarjan_Frame){ .node = root };
+        index[root] = lowlink[root] = next_index++;
+        stack[stack_count++] = root;
+        on_stack[root] = true;
+
+        while (num_frames != 0) {
+            Tarjan_Frame *frame = &frames[num_frames - 1];
+            int v = frame->node;
+            Pathfind_Node *node = &pathfinding->nodes[v];
+
+            if (frame->edge < node->num_neighbours) {
+                Pathfind_Edge edge = node->neighbours[frame->edge++];
+                if (edge.locked) continue;
+
+                int w = edge.node;
+                if (node_component && (node_component[w] < lo || node_component[w] > hi)) continue;
+
+                if (index[w] == -1) {
+                    index[w] = lowlink[w] = next_index++;
+                    stack[stack_count++] = w;
+                    on_stack[w] = true;
+                    frames[num_frames++] = (Tarjan_Frame){ .node = w };
+                } else if (on_stack[w] && index[w] < lowlink[v]) {
+                    lowlink[v] = index[w];
+                }
+                continue;
+            }
+
+            if (lowlink[v] == index[v]) {
+                int w;
+                do {
+                    w = stack[--stack_count];
+                    on_stack[w] = false;
+                    components[w] = num_components;
+                } while (w != v);
+                ++num_components;
+            }
+
+            --num_frames;
+            if (num_frames != 0) {
+                int parent = frames[num_frames - 1].node;
+                if (lowlink[v] < lowlink[parent]) lowlink[parent] = lowlink[v];
+            }
+        }
+    }
+
+    free(index);
+    free(lowlink);
+    free(on_stack);
+    free(stack);
+    free(frames);
+    return num_components;
+}
+
+static void reachability_group_joints(Pathfind_Reachability *reachability, size_t num_nodes) {
+    size_t num_components = reachability->num_components;
+    int *offsets = calloc(num_components + 1, sizeof(int));
+    int *joints = malloc(num_nodes * sizeof(int));
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        ++offsets[reachability->node_component[i] + 1];
+    }
+    for (size_t c = 0; c < num_components; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+
+    int *fill = calloc(num_components, sizeof(int));
+    for (size_t i = 0; i < num_nodes; ++i) {
+        int c = reachability->node_component[i];
+        joints[offsets[c] + fill[c]++] = i;
+    }
+    free(fill);
+
+    reachability->component_offsets = offsets;
+    reachability->component_joints = joints;
+}
+
+static bool reachability_row_has(Pathfind_Reachability *reachability, size_t c, size_t d) {
+    uint64_t *row = &reachability->closure[c * reachability->words_per_component];
+    return row[d / 64] & ((uint64_t)1 << (d % 64));
+}
+
+// Needs the rows of every component `c` can get to first, which all have
+// lower numbers.
+static void reachability_build_row(Level_Geometry *level, Pathfind_Reachability *reachability, size_t c) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    size_t words = reachability->words_per_component;
+    uint64_t *row = &reachability->closure[c * words];
+    memset(row, 0, words * sizeof(uint64_t));
+    row[c / 64] |= (uint64_t)1 << (c % 64);
+
+    for (int i = reachability->component_offsets[c]; i < reachability->component_offsets[c + 1]; ++i) {
+        int v = reachability->component_joints[i];
+        Pathfind_Node *node = &pathfinding->nodes[v];
+        for (int j = 0; j < node->num_neighbours; ++j) {
+            Pathfind_Edge edge = node->neighbours[j];
+            if (edge.locked) continue;
+
+            size_t d = reachability->node_component[edge.node];
+            if (d == c) continue;
+
+            // Already merged in through another connection.
+            if (row[d / 64] & ((uint64_t)1 << (d % 64))) continue;
+
+            uint64_t *other = &reachability->closure[d * words];
+            for (size_t w = 0; w < words; ++w) {
+                row[w] |= other[w];
+            }
+        }
+    }
+}
+
+// Rows before `first` are kept from the closure there was, if there was one.
+static void reachability_build_closure(Level_Geometry *level, Pathfind_Reachability *reachability, size_t first) {
+    size_t num_components = reachability->num_components;
+    size_t words = (num_components + 63) / 64;
+    uint64_t *old = reachability->closure;
+    size_t old_words = reachability->words_per_component;
+    reachability->closure = NULL;
+    reachability->words_per_component = 0;
+
+    if (num_components * words * sizeof(uint64_t) > PATHFIND_REACHABILITY_MAX_CLOSURE_BYTES) {
+        TraceLog(LOG_WARNING, "Level has too many components (%zu) to keep a reachability closure.", num_components);
+        free(old);
+        return;
+    }
+
+    reachability->words_per_component = words;
+    reachability->closure = calloc(num_components * words, sizeof(uint64_t));
+
+    if (!old) first = 0;
+    for (size_t c = 0; c < first; ++c) {
+        // NOTE: Rows only have bits for lower numbers, so nothing is lost
+        //       if there are fewer words than there were.
+        memcpy(&reachability->closure[c * words], &old[c * old_words], (words < old_words ? words : old_words) * sizeof(uint64_t));
+    }
+    free(old);
+
+    for (size_t c = first; c < num_components; ++c) {
+        reachability_build_row(level, reachability, c);
+    }
+}
+
+// Finds the components again for the joints in components `lo` to `hi`
+// after a connection between two of them changed, and fits whatever comes
+// out back in between the components either side. Nothing outside of them
+// can have changed: every connection into the range comes from a higher
+// number and every one out of it goes to a lower one, so the order still
+// holds with the new ones numbered from `lo`.
+static bool reachability_renumber(Level_Geometry *level, Pathfind_Reachability *reachability, int lo, int hi, Pathfind_Reachability_Renumbering *renumbering) {
+    size_t num_nodes = level->pathfinding.num_nodes;
+    int *pieces = malloc(num_nodes * sizeof(int));
+    size_t num_pieces = reachability_find_components(level, reachability, lo, hi, pieces);
+    size_t num_old = hi - lo + 1;
+
+    if (num_old == 1 && num_pieces == 1) {
+        free(pieces);
+        return false;
+    }
+
+    size_t num_components = reachability->num_components - num_old + num_pieces;
+    int shift = (int)num_pieces - (int)num_old;
+    int *old_offsets = reachability->component_offsets;
+    int *joints = reachability->component_joints;
+    int begin = old_offsets[lo];
+    int end = old_offsets[hi + 1];
+
+    // The joints of the components after the range stay where they are in
+    // `component_joints`, only their numbers move.
+    for (size_t i = end; i < num_nodes; ++i) {
+        reachability->node_component[joints[i]] += shift;
+    }
+
+    int *offsets = malloc((num_components + 1) * sizeof(int));
+    memcpy(offsets, old_offsets, (lo + 1) * sizeof(int));
+    memcpy(&offsets[lo + num_pieces], &old_offsets[hi + 1], (reachability->num_components - hi) * sizeof(int));
+
+    int *counts = calloc(num_pieces + 1, sizeof(int));
+    for (int i = begin; i < end; ++i) {
+        ++counts[pieces[joints[i]] + 1];
+    }
+    for (size_t p = 0; p < num_pieces; ++p) {
+        counts[p + 1] += counts[p];
+        offsets[lo + p] = begin + counts[p];
+    }
+
+    int *range = malloc((end - begin) * sizeof(int));
+    memcpy(range, &joints[begin], (end - begin) * sizeof(int));
+    for (int i = 0; i < end - begin; ++i) {
+        int v = range[i];
+        int p = pieces[v];
+        joints[begin + counts[p]++] = v;
+        reachability->node_component[v] = lo + p;
+    }
+
+    free(range);
+    free(counts);
+    free(pieces);
+    free(old_offsets);
+    reachability->component_offsets = offsets;
+    reachability->num_components = num_components;
+
+    if (reachability->closure) {
+        reachability_build_closure(level, reachability, lo);
+    }
+
+    *renumbering = (Pathfind_Reachability_Renumbering){ .first = lo, .old_last = hi, .new_last = lo + num_pieces - 1 };
+    return true;
+}
+
+void pathfind_reachability_build(Level_Geometry *level) {
+    Pathfind_Reachability *reachability = &level->reachability;
+    pathfind_reachability_free(reachability);
+
+    size_t num_nodes = level->pathfinding.num_nodes;
+    if (num_nodes == 0) return;
+
+    int *components = malloc(num_nodes * sizeof(int));
+    reachability->num_components = reachability_find_components(level, reachability, 0, 0, components);
+    reachability->node_component = components;
+    reachability_group_joints(reachability, num_nodes);
+    reachability_build_closure(level, reachability, 0);
+}
+
+bool pathfind_reachability_update_connection(Level_Geometry *level, int from, int to, bool locked, Pathfind_Reachability_Renumbering *renumbering) {
+    Pathfind_Reachability *reachability = &level->reachability;
+    if (!reachability->node_component) return false;
+
+    int c = reachability->node_component[from];
+    int d = reachability->node_component[to];
+
+    if (locked) {
+        // NOTE: The only way it can split `c` up is into pieces that were
+        //       all in it.
+        if (c == d) return reachability_renumber(level, reachability, c, c, renumbering);
+
+        // One of the ways out of `c` is gone, which can only have made it
+        // and whatever gets to it reach less. If `c` still reaches the same
+        // components, so does everything else.
+        if (!reachability->closure) return false;
+
+        size_t words = reachability->words_per_component;
+        uint64_t *before = malloc(words * sizeof(uint64_t));
+        memcpy(before, &reachability->closure[c * words], words * sizeof(uint64_t));
+        reachability_build_row(level, reachability, c);
+        bool changed = memcmp(before, &reachability->closure[c * words], words * sizeof(uint64_t)) != 0;
+        free(before);
+        if (!changed) return false;
+
+        for (size_t e = c + 1; e < reachability->num_components; ++e) {
+            if (reachability_row_has(reachability, e, c)) reachability_build_row(level, reachability, e);
+        }
+        return false;
+    }
+
+    if (c == d) return false;
+
+    // A connection to a lower number keeps the order, and can't close a
+    // cycle since `d` can't get back up to `c`. Whatever reaches `c` now
+    // reaches everything `d` does.
+    if (c > d) {
+        if (!reachability->closure || reachability_row_has(reachability, c, d)) return false;
+
+        size_t words = reachability->words_per_component;
+        uint64_t *other = &reachability->closure[d * words];
+        for (size_t e = c; e < reachability->num_components; ++e) {
+            if (!reachability_row_has(reachability, e, c)) continue;
+
+            uint64_t *row = &reachability->closure[e * words];
+            for (size_t w = 0; w < words; ++w) {
+                row[w] |= other[w];
+            }
+        }
+        return false;
+    }
+
+    // Either it closes a cycle through everything between `d` and `c`
+    // or the components in between need putting in a new order, which
+    // only those components can be part of.
+    return reachability_renumber(level, reachability, c, d, renumbering);
+}
+
+void pathfind_reachability_free(Pathfind_Reachability *reachability) {
+    free(reachability->node_component);
+    free(reachability->component_offsets);
+    free(reachability->component_joints);
+    free(reachability->closure);
+    *reachability = (Pathfind_Reachability){0};
+}
+
+bool pathfind_reachability_joints(Pathfind_Reachability *reachability, int from, int to) {
+    if (!reachability->node_component) return true;
+
+    size_t c = reachability->node_component[from];
+    size_t d = reachability->node_component[to];
+    if (c == d) return true;
+    if (!reachability->closure) return true;
+
+    uint64_t *row = &reachability->closure[c * reachability->words_per_component];
+    return row[d / 64] & ((uint64_t)1 << (d % 64));
+}
+
+bool pathfind_reachability_floors(Pathfind_Reachability *reachability, int from_joints[2], int to_joints[2]) {
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            if (pathfind_reachability_joints(reachability, from_joints[i], to_joints[j])) return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#ifndef PATHFIND_REACHABILITY_H_
+#define PATHFIND_REACHABILITY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct Level_Geometry Level_Geometry;
+
+// Past this the closure isn't kept and every pair of joints is assumed to
+// be reachable, leaving it to the search to find out.
+#define PATHFIND_REACHABILITY_MAX_CLOSURE_BYTES (32 * 1024 * 1024)
+
+// The strongly connected components of the pathfinding graph with locked
+// connections left out, plus which components can reach which. Falls only
+// go one way, so a joint can reach a component it can't get back from.
+//
+// NOTE: Components are numbered in the order Tarjan's algorithm finishes
+//       them, so every connection between two components leads to a lower
+//       number. That makes the closure a single pass over the components.
+//
+// RESEARCH: https://en.wikipedia.org/wiki/Tarjan%27s_strongly_connected_components_algorithm
+typedef struct {
+    size_t num_components;
+    int *node_component;
+    int *component_offsets; // `component_joints[component_offsets[c]..component_offsets[c + 1]]` are in `c`
+    int *component_joints;
+
+    size_t words_per_component;
+    uint64_t *closure;      // bit `d` of row `c` is set if `c` can reach `d`, NULL if too big
+} Pathfind_Reachability;
+
+// Which components an update found again: `first` to `old_last` were
+// replaced by `first` to `new_last`, and every one after them moved along
+// to make room.
+typedef struct {
+    int first;
+    int old_last;
+    int new_last;
+} Pathfind_Reachability_Renumbering;
+
+void pathfind_reachability_build(Level_Geometry *level);
+// Brings the reachability up to date after the connection from joint
+// `from` to joint `to` was locked or unlocked, looking again only at the
+// components it can have changed rather than building it all again.
+// Returns true, filling in `renumbering`, if any components changed.
+bool pathfind_reachability_update_connection(Level_Geometry *level, int from, int to, bool locked, Pathfind_Reachability_Renumbering *renumbering);
+void pathfind_reachability_free(Pathfind_Reachability *reachability);
+
+bool pathfind_reachability_joints(Pathfind_Reachability *reachability, int from, int to);
+// Whether either joint of one floor can reach either joint of another.
+bool pathfind_reachability_floors(Pathfind_Reachability *reachability, int from_joints[2], int to_joints[2]);
+
+#endif
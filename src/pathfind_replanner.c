@@ -0,0 +1,308 @@
+#include "pathfind_replanner.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <raymath.h>
+
+#include "level_geometry.h"
+
+Pathfind_Replanner pathfind_replanner_make(Pathfind_Profile profile) {
+    assert(profile >= 0 && profile < Pathfind_Profile_COUNT);
+    return (Pathfind_Replanner){
+        .profile = profile,
+        .goal_joints = { -1, -1 },
+        .start_joints = { -1, -1 }
+    };
+}
+
+void pathfind_replanner_free(Pathfind_Replanner *replanner) {
+    free(replanner->g_score);
+    free(replanner->rhs);
+    free(replanner->open_set.positions);
+    pathfind_heap_free(&replanner->open_set);
+    *replanner = pathfind_replanner_make(replanner->profile);
+}
+
+typedef struct {
+    float primary;
+    float secondary;
+} Replanner_Key;
+
+static bool replanner_key_is_less(Replanner_Key a, Replanner_Key b) {
+    if (a.primary != b.primary) return a.primary < b.primary;
+    return a.secondary < b.secondary;
+}
+
+// What taking `node`'s `i`th edge costs, infinite if it can't be taken.
+static float replanner_edge_cost(Level_Geometry *level, Pathfind_Replanner *replanner, int node, int i) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    if (pathfinding->nodes[node].neighbours[i].locked && pathfind_profile_respects_locks(replanner->profile)) {
+        return INFINITY;
+    }
+    return pathfinding->profile_costs[(replanner->profile * pathfinding->num_nodes + node) * PATHFIND_NODE_NEIGHBOUR_COUNT + i];
+}
+
+static bool replanner_is_goal(Pathfind_Replanner *replanner, int node) {
+    return node == replanner->goal_joints[0] || node == replanner->goal_joints[1];
+}
+
+// Straight line distance to the closer start joint.
+static float replanner_heuristic(Level_Geometry *level, Pathfind_Replanner *replanner, int node) {
+    Vector2 position = level->pathfinding.nodes[node].position;
+    float a = Vector2Distance(position, level->pathfinding.nodes[replanner->start_joints[0]].position);
+    float b = Vector2Distance(position, level->pathfinding.nodes[replanner->start_joints[1]].position);
+    return fminf(a, b);
+}
+
+static Replanner_Key replanner_key(Level_Geometry *level, Pathfind_Replanner *replanner, int node) {
+    float best = fminf(replanner->g_score[node], replanner->rhs[node]);
+    return (Replanner_Key){
+        .primary = best + replanner_heuristic(level, replanner, node) + replanner->km,
+        .secondary = best
+    };
+}
+
+static void replanner_update_node(Level_Geometry *level, Pathfind_Replanner *replanner, int node) {
+    Pathfinding *pathfinding = &level->pathfinding;
+
+    if (!replanner_is_goal(replanner, node)) {
+        Pathfind_Node *n = &pathfinding->nodes[node];
+        float rhs = INFINITY;
+        for (int i = 0; i < n->num_neighbours; ++i) {
+            rhs = fminf(rhs, replanner_edge_cost(level, replanner, node, i) + replanner->g_score[n->neighbours[i].node]);
+        }
+        replanner->rhs[node] = rhs;
+    }
+
+    if (replanner->g_score[node] != replanner->rhs[node]) {
+        Replanner_Key key = replanner_key(level, replanner, node);
+        pathfind_heap_push(&replanner->open_set, node, key.primary, key.secondary);
+    } else if (pathfind_heap_contains(&replanner->open_set, node)) {
+        pathfind_heap_remove(&replanner->open_set, node);
+    }
+}
+
+static void replanner_update_predecessors(Level_Geometry *level, Pathfind_Replanner *replanner, int node) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    int begin = pathfinding->predecessor_offsets[node];
+    int end = pathfinding->predecessor_offsets[node + 1];
+    for (int i = begin; i < end; ++i) {
+        replanner_update_node(level, replanner, pathfinding->predecessors[i].node);
+    }
+}
+
+static void replanner_reset(Level_Geometry *level, Pathfind_Replanner *replanner, int goal_joints[2]) {
+    size_t num_nodes = level->pathfinding.num_nodes;
+
+    if (replanner->num_nodes != num_nodes) {
+        replanner->g_score = realloc(replanner->g_score, num_nodes * sizeof(float));
+        replanner->rhs = realloc(replanner->rhs, num_nodes * sizeof(float));
+        replanner->open_set.positions = realloc(replanner->open_set.positions, num_nodes * sizeof(int));
+        memset(replanner->open_set.positions, -1, num_nodes * sizeof(int));
+        vec_clear(&replanner->open_set.entries);
+        replanner->num_nodes = num_nodes;
+    }
+
+    pathfind_heap_clear(&replanner->open_set);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        replanner->g_score[i] = INFINITY;
+        replanner->rhs[i] = INFINITY;
+    }
+
+    replanner->goal_joints[0] = goal_joints[0];
+    replanner->goal_joints[1] = goal_joints[1];
+    replanner->km = 0.f;
+    replanner->version = level->version;
+    ++replanner->resets;
+
+    for (int i = 0; i < 2; ++i) {
+        replanner->rhs[goal_joints[i]] = 0.f;
+        replanner_update_node(level, replanner, goal_joints[i]);
+    }
+}
+
+static bool replanner_start_is_settled(Level_Geometry *level, Pathfind_Replanner *replanner) {
+    if (replanner->open_set.entries.count == 0) return true;
+
+    Pathfind_Heap_Entry top = pathfind_heap_top(&replanner->open_set);
+    Replanner_Key top_key = { top.priority, top.tiebreak };
+
+    for (int i = 0; i < 2; ++i) {
+        int start = replanner->start_joints[i];
+        if (replanner_key_is_less(top_key, replanner_key(level, replanner, start))) return false;
+        if (replanner->rhs[start] > replanner->g_score[start]) return false;
+    }
+
+    return true;
+}
+
+static void replanner_compute(Level_Geometry *level, Pathfind_Replanner *replanner) {
+    while (!replanner_start_is_settled(level, replanner)) {
+        Pathfind_Heap_Entry top = pathfind_heap_top(&replanner->open_set);
+        Replanner_Key old_key = { top.priority, top.tiebreak };
+        int node = top.node;
+        ++replanner->nodes_expanded;
+
+        Replanner_Key new_key = replanner_key(level, replanner, node);
+        if (replanner_key_is_less(old_key, new_key)) {
+            // The start moved since this node was queued.
+            pathfind_heap_push(&replanner->open_set, node, new_key.primary, new_key.secondary);
+        } else if (replanner->g_score[node] > replanner->rhs[node]) {
+            replanner->g_score[node] = replanner->rhs[node];
+            pathfind_heap_remove(&replanner->open_set, node);
+            replanner_update_predecessors(level, replanner, node);
+        } else {
+            replanner->g_score[node] = INFINITY;
+            replanner_update_node(level, replanner, node);
+            replanner_update_predecessors(level, replanner, node);
+        }
+    }
+}
+
+// Brings the search up to date with every lock and connection change since
+// it last ran. Only the joint the changed connection leaves from can have
+// a different lookahead, the rest follows from there.
+static bool replanner_catch_up(Level_Geometry *level, Pathfind_Replanner *replanner) {
+    size_t first;
+    if (!level_geometry_changes_since(level, replanner->version, &first)) {
+        return false;
+    }
+
+    for (size_t i = first; i < level->changes.count; ++i) {
+        replanner_update_node(level, replanner, level->changes.items[i].joint);
+    }
+
+    replanner->version = level->version;
+    return true;
+}
+
+static void replanner_move_start(Level_Geometry *level, Pathfind_Replanner *replanner, int start_joints[2]) {
+    Pathfinding *pathfinding = &level->pathfinding;
+
+    // NOTE: The heuristic is the distance to the closer start joint, so
+    //       moving the start lowers it by at most how far the new joints
+    //       are from the old ones. Adding that to `km` keeps every key in
+    //       the open set a lower bound.
+    if (replanner->start_joints[0] != -1) {
+        float moved = 0.f;
+        for (int i = 0; i < 2; ++i) {
+            Vector2 position = pathfinding->nodes[start_joints[i]].position;
+            float a = Vector2Distance(position, pathfinding->nodes[replanner->start_joints[0]].position);
+            float b = Vector2Distance(position, pathfinding->nodes[replanner->start_joints[1]].position);
+            moved = fmaxf(moved, fminf(a, b));
+        }
+        replanner->km += moved;
+    }
+
+    replanner->start_joints[0] = start_joints[0];
+    replanner->start_joints[1] = start_joints[1];
+}
+
+// Brings the search up to date for a start on `starting_floor`, repairing
+// it if the goal is still on `ending_floor` and starting it over if not.
+// Returns false if the goal can't be reached.
+static bool replanner_prepare(Level_Geometry *level, Pathfind_Replanner *replanner, Floor starting_floor, Floor ending_floor) {
+    int start_joints[2] = { starting_floor.left - level->joints, starting_floor.right - level->joints };
+    int goal_joints[2] = { ending_floor.left - level->joints, ending_floor.right - level->joints };
+
+    // The search is left as it is, the change log catches it up next time.
+    if (pathfind_profile_respects_locks(replanner->profile) &&
+        !pathfind_reachability_floors(&level->reachability, start_joints, goal_joints))
+    {
+        return false;
+    }
+
+    bool same_goal =
+        (replanner->goal_joints[0] == goal_joints[0] && replanner->goal_joints[1] == goal_joints[1]) ||
+        (replanner->goal_joints[0] == goal_joints[1] && replanner->goal_joints[1] == goal_joints[0]);
+
+    replanner->nodes_expanded = 0;
+    replanner_move_start(level, replanner, start_joints);
+    if (!same_goal || replanner->num_nodes != level->pathfinding.num_nodes || !replanner_catch_up(level, replanner)) {
+        replanner_reset(level, replanner, goal_joints);
+    }
+    replanner_compute(level, replanner);
+    return true;
+}
+
+static bool replanner_plan(Level_Geometry *level, Pathfind_Replanner *replanner, Vector2 start, Floor starting_floor, Vector2 end, Vec_Vector2 *path) {
+    Pathfinding *pathfinding = &level->pathfinding;
+    vec_clear(path);
+
+    Floor ending_floor = level_find_floor(level, end);
+    assert(ending_floor.left && ending_floor.right);
+
+    if (floor_contains_point(starting_floor, end)) {
+        vec_append(path, end);
+        return true;
+    }
+
+    if (!replanner_prepare(level, replanner, starting_floor, ending_floor)) {
+        return false;
+    }
+
+    int start_joints[2] = { starting_floor.left - level->joints, starting_floor.right - level->joints };
+    int current = -1;
+    float best = INFINITY;
+    for (int i = 0; i < 2; ++i) {
+        int joint = start_joints[i];
+        float distance = Vector2Distance(start, pathfinding->nodes[joint].position) + replanner->g_score[joint];
+        if (distance < best) {
+            best = distance;
+            current = joint;
+        }
+    }
+    if (current == -1) return false;
+
+    // Walk downhill on `g_score` from the start to the goal.
+    Vec_int joints = {0};
+    vec_append(&joints, current);
+    while (!replanner_is_goal(replanner, current)) {
+        // A path never visits a joint twice, so a walk this long is going
+        // round in circles rather than getting anywhere.
+        if (joints.count > pathfinding->num_nodes) {
+            vec_free(&joints);
+            return false;
+        }
+
+        Pathfind_Node *node = &pathfinding->nodes[current];
+        int next = -1;
+        float next_distance = INFINITY;
+        for (int i = 0; i < node->num_neighbours; ++i) {
+            float distance = replanner_edge_cost(level, replanner, current, i) + replanner->g_score[node->neighbours[i].node];
+            if (distance < next_distance) {
+                next_distance = distance;
+                next = node->neighbours[i].node;
+            }
+        }
+
+        if (next == -1) {
+            vec_free(&joints);
+            return false;
+        }
+
+        current = next;
+        vec_append(&joints, current);
+    }
+
+    Vec_Vector2 found = level_geometry_path_from_joints_on_floors(level, starting_floor, ending_floor, end, joints.count, joints.items);
+    vec_free(path);
+    *path = found;
+    vec_free(&joints);
+    return true;
+}
+
+bool pathfind_replanner_plan(Level_Geometry *level, Pathfind_Replanner *replanner, Vector2 start, Vector2 end, Vec_Vector2 *path) {
+    Floor starting_floor = level_find_floor(level, start);
+    assert(starting_floor.left && starting_floor.right);
+
+    return replanner_plan(level, replanner, start, starting_floor, end, path);
+}
+
+bool pathfind_replanner_plan_from(Level_Geometry *level, Pathfind_Replanner *replanner, Floor_Position start, Vector2 end, Vec_Vector2 *path) {
+    Vector2 point = level_floor_position_point(level, start);
+    return replanner_plan(level, replanner, point, level_floor_position_floor(level, start), end, path);
+}
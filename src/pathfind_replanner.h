@@ -0,0 +1,54 @@
+#ifndef PATHFIND_REPLANNER_H_
+#define PATHFIND_REPLANNER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <raylib.h>
+
+#include "pathfind_heap.h"
+#include "pathfind_query.h"
+#include "utils.h"
+
+typedef struct Level_Geometry Level_Geometry;
+typedef struct Floor_Position Floor_Position;
+
+// D* Lite search state kept between plans for one agent and goal floor.
+// The search runs backwards from the goal, so the agent can move and locks
+// can change without starting over: only joints whose distance to the goal
+// is affected by a change get looked at again.
+//
+// NOTE: Everything is sized to the whole level so this is a fair bit of
+//       memory per agent. It's meant for the few agents that hold long
+//       paths, not for every one-off query.
+//
+// RESEARCH: http://idm-lab.org/bib/abstracts/papers/aaai02b.pdf
+typedef struct {
+    size_t num_nodes;
+    Pathfind_Profile profile; // whose edge costs the search uses
+    float *g_score;    // distance to the goal as of the last expansion
+    float *rhs;        // one step lookahead of `g_score`
+    Pathfind_Heap open_set;
+
+    int goal_joints[2];  // -1 until the first plan
+    int start_joints[2];
+    float km;            // how far the start has moved, keeps old keys valid
+    unsigned version;    // `level->version` the search has caught up to
+
+    size_t nodes_expanded; // by the last plan, used for profiling
+    size_t resets;
+} Pathfind_Replanner;
+
+Pathfind_Replanner pathfind_replanner_make(Pathfind_Profile profile);
+void pathfind_replanner_free(Pathfind_Replanner *replanner);
+
+// Plans from `start` to `end` into `path`, laid out like
+// `level_geometry_pathfind`'s. The search starts over if `end` is on a
+// different floor than last time, otherwise it repairs the previous one.
+// Returns false if there's no path.
+bool pathfind_replanner_plan(Level_Geometry *level, Pathfind_Replanner *replanner, Vector2 start, Vector2 end, Vec_Vector2 *path);
+// Plans from where an agent stands on the floors instead of looking its
+// floor up from a point.
+bool pathfind_replanner_plan_from(Level_Geometry *level, Pathfind_Replanner *replanner, Floor_Position start, Vector2 end, Vec_Vector2 *path);
+
+#endif
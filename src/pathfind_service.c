@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pathfind_service.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "level_geometry.h"
+
+typedef enum {
+    Pathfind_Request_QUEUED,
+    Pathfind_Request_RUNNING,
+    Pathfind_Request_DONE
+} Pathfind_Request_State;
+
+typedef struct {
+    Pathfind_Ticket ticket;
+    Floor_Position start;
+    Vector2 end;
+    Pathfind_Profile profile;
+    Pathfind_Request_State state;
+    Pathfind_Status status;  // once it's done
+    unsigned version;        // `level->version` the result holds for
+    Vec_Vector2 path;
+    bool cacheable;          // `key` and `joints` hold what the search found
+    Path_Cache_Key key;
+    Vec_int joints;
+} Pathfind_Request;
+
+DEFINE_VEC_FOR_TYPE(Pathfind_Request);
+
+struct Pathfind_Service {
+    Level_Geometry *level;
+    pthread_t thread;
+    bool started;
+
+    pthread_rwlock_t level_lock;
+    pthread_mutex_t mutex;   // guards everything below
+    pthread_cond_t wake;
+    bool quitting;
+    bool cancel_running;     // the request being worked on was cancelled
+    Pathfind_Ticket next_ticket;
+    Vec_Pathfind_Request requests; // oldest first
+};
+
+static Pathfind_Request *pathfind_service_find(Pathfind_Service *service, Pathfind_Ticket ticket, size_t *index) {
+    for (size_t i = 0; i < service->requests.count; ++i) {
+        if (service->requests.items[i].ticket == ticket) {
+            if (index) *index = i;
+            return &service->requests.items[i];
+        }
+    }
+    return NULL;
+}
+
+static Pathfind_Request *pathfind_service_next_queued(Pathfind_Service *service) {
+    vec_foreach(Pathfind_Request, request, service->requests) {
+        if (request->state == Pathfind_Request_QUEUED) return request;
+    }
+    return NULL;
+}
+
+static void pathfind_service_remove(Pathfind_Service *service, size_t index) {
+    vec_free(&service->requests.items[index].path);
+    vec_free(&service->requests.items[index].joints);
+    vec_remove_ordered(&service->requests, index);
+}
+
+static void *pathfind_service_main(void *arg) {
+    Pathfind_Service *service = arg;
+    Level_Geometry *level = service->level;
+    Pathfind_Plan plan = pathfind_plan_make();
+
+    for (;;) {
+        pthread_mutex_lock(&service->mutex);
+        Pathfind_Request *request = NULL;
+        while (!service->quitting && !(request = pathfind_service_next_queued(service))) {
+            pthread_cond_wait(&service->wake, &service->mutex);
+        }
+        if (service->quitting) {
+            pthread_mutex_unlock(&service->mutex);
+            break;
+        }
+
+        request->state = Pathfind_Request_RUNNING;
+        service->cancel_running = false;
+        Pathfind_Ticket ticket = request->ticket;
+        pathfind_plan_begin_from(&plan, request->start, request->end, request->profile);
+        pthread_mutex_unlock(&service->mutex);
+
+        Vec_Vector2 path = {0};
+        Pathfind_Status status;
+        unsigned version;
+        bool cancelled;
+        do {
+            pthread_rwlock_rdlock(&service->level_lock);
+            status = level_geometry_plan_step(level, &plan, PATHFIND_SERVICE_STEP_EXPANSIONS, 0.0, &path);
+            version = level->version;
+            pthread_rwlock_unlock(&service->level_lock);
+
+            pthread_mutex_lock(&service->mutex);
+            cancelled = service->cancel_running || service->quitting;
+            pthread_mutex_unlock(&service->mutex);
+        } while (status == Pathfind_Status_IN_PROGRESS && !cancelled);
+
+        pthread_mutex_lock(&service->mutex);
+        size_t index;
+        request = pathfind_service_find(service, ticket, &index);
+        assert(request && "running request went missing");
+        if (service->cancel_running) {
+            vec_free(&path);
+            pathfind_service_remove(service, index);
+        } else if (status == Pathfind_Status_IN_PROGRESS) {
+            // Only when quitting, nobody is going to collect it.
+            vec_free(&path);
+        } else {
+            request->state = Pathfind_Request_DONE;
+            request->status = status;
+            request->version = version;
+            request->path = path;
+            request->cacheable = plan.cacheable;
+            request->key = plan.key;
+            request->joints = plan.joints;
+            plan.joints = (Vec_int){0};
+            plan.cacheable = false;
+        }
+        pthread_mutex_unlock(&service->mutex);
+    }
+
+    pathfind_plan_free(&plan);
+    pathfind_default_query_free();
+    return NULL;
+}
+
+Pathfind_Service *pathfind_service_make(Level_Geometry *level) {
+    Pathfind_Service *service = calloc(1, sizeof(Pathfind_Service));
+    service->level = level;
+    service->next_ticket = PATHFIND_NO_TICKET + 1;
+    pthread_rwlock_init(&service->level_lock, NULL);
+    pthread_mutex_init(&service->mutex, NULL);
+    pthread_cond_init(&service->wake, NULL);
+
+    service->started = pthread_create(&service->thread, NULL, pathfind_service_main, service) == 0;
+    if (!service->started) {
+        TraceLog(LOG_WARNING, "Failed to start the pathfinding service, async requests will never finish.");
+    }
+
+    return service;
+}
+
+void pathfind_service_free(Pathfind_Service *service) {
+    if (!service) return;
+
+    pthread_mutex_lock(&service->mutex);
+    service->quitting = true;
+    pthread_cond_signal(&service->wake);
+    pthread_mutex_unlock(&service->mutex);
+
+    if (service->started) {
+        pthread_join(service->thread, NULL);
+    }
+
+    vec_foreach(Pathfind_Request, request, service->requests) {
+        vec_free(&request->path);
+        vec_free(&request->joints);
+    }
+    vec_free(&service->requests);
+
+    pthread_cond_destroy(&service->wake);
+    pthread_mutex_destroy(&service->mutex);
+    pthread_rwlock_destroy(&service->level_lock);
+    free(service);
+}
+
+Pathfind_Ticket pathfind_service_request(Pathfind_Service *service, Floor_Position start, Vector2 end, Pathfind_Profile profile) {
+    pthread_mutex_lock(&service->mutex);
+
+    Pathfind_Ticket ticket = service->next_ticket++;
+    if (service->next_ticket == PATHFIND_NO_TICKET) ++service->next_ticket;
+
+    Pathfind_Request request = {
+        .ticket = ticket,
+        .start = start,
+        .end = end,
+        .profile = profile,
+        .state = Pathfind_Request_QUEUED
+    };
+    vec_append(&service->requests, request);
+
+    pthread_cond_signal(&service->wake);
+    pthread_mutex_unlock(&service->mutex);
+    return ticket;
+}
+
+Pathfind_Ticket pathfind_service_request_done(Pathfind_Service *service, Pathfind_Status status, Vec_Vector2 path) {
+    assert(status != Pathfind_Status_IN_PROGRESS);
+    pthread_mutex_lock(&service->mutex);
+
+    Pathfind_Ticket ticket = service->next_ticket++;
+    if (service->next_ticket == PATHFIND_NO_TICKET) ++service->next_ticket;
+
+    Pathfind_Request request = {
+        .ticket = ticket,
+        .state = Pathfind_Request_DONE,
+        .status = status,
+        .version = service->level->version,
+        .path = path
+    };
+    vec_append(&service->requests, request);
+
+    pthread_mutex_unlock(&service->mutex);
+    return ticket;
+}
+
+Pathfind_Status pathfind_service_poll(Pathfind_Service *service, Pathfind_Ticket ticket, Vec_Vector2 *path) {
+    pthread_mutex_lock(&service->mutex);
+
+    size_t index;
+    Pathfind_Request *request = pathfind_service_find(service, ticket, &index);
+    if (!request) {
+        pthread_mutex_unlock(&service->mutex);
+        return Pathfind_Status_NOT_FOUND;
+    }
+
+    if (request->state != Pathfind_Request_DONE) {
+        pthread_mutex_unlock(&service->mutex);
+        return Pathfind_Status_IN_PROGRESS;
+    }
+
+    // NOTE: Only the thread polling changes the level, so its version
+    //       can be read here without taking the level lock.
+    if (request->version != service->level->version) {
+        vec_free(&request->path);
+        vec_free(&request->joints);
+        request->cacheable = false;
+        request->state = Pathfind_Request_QUEUED;
+        pthread_cond_signal(&service->wake);
+        pthread_mutex_unlock(&service->mutex);
+        return Pathfind_Status_IN_PROGRESS;
+    }
+
+    Pathfind_Status status = request->status;
+    *path = request->path;
+    request->path = (Vec_Vector2){0};
+    if (request->cacheable) {
+        path_cache_insert(&service->level->path_cache, request->key, request->joints.count != 0, request->joints);
+        request->joints = (Vec_int){0};
+    }
+    pathfind_service_remove(service, index);
+
+    pthread_mutex_unlock(&service->mutex);
+    return status;
+}
+
+void pathfind_service_cancel(Pathfind_Service *service, Pathfind_Ticket ticket) {
+    pthread_mutex_lock(&service->mutex);
+
+    size_t index;
+    Pathfind_Request *request = pathfind_service_find(service, ticket, &index);
+    if (request) {
+        if (request->state == Pathfind_Request_RUNNING) {
+            // The worker owns it until it notices.
+            service->cancel_running = true;
+        } else {
+            pathfind_service_remove(service, index);
+        }
+    }
+
+    pthread_mutex_unlock(&service->mutex);
+}
+
+void pathfind_service_lock_level(Pathfind_Service *service) {
+    pthread_rwlock_wrlock(&service->level_lock);
+}
+
+void pathfind_service_unlock_level(Pathfind_Service *service) {
+    pthread_rwlock_unlock(&service->level_lock);
+}
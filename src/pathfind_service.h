@@ -0,0 +1,52 @@
+#ifndef PATHFIND_SERVICE_H_
+#define PATHFIND_SERVICE_H_
+
+#include <stdbool.h>
+
+#include <raylib.h>
+
+#include "pathfind_query.h"
+#include "utils.h"
+
+typedef struct Level_Geometry Level_Geometry;
+typedef struct Floor_Position Floor_Position;
+
+// Stands in for a path that's been asked for but not collected yet.
+typedef unsigned Pathfind_Ticket;
+
+#define PATHFIND_NO_TICKET 0
+
+// Expansions between letting go of the level, which is as long as a lock
+// or connection change has to wait on a search in progress.
+#define PATHFIND_SERVICE_STEP_EXPANSIONS 1024
+
+// A queue of path requests worked through by a thread of its own, so none
+// of the searching happens on the main loop.
+//
+// NOTE: The worker only ever reads the level and it holds the service's
+//       level lock while it does. Changing a lock or connection takes the
+//       same lock for writing so the worker always sees the level as it
+//       was between two changes. Searches let go of it every
+//       `PATHFIND_SERVICE_STEP_EXPANSIONS` and start over if the level
+//       changed in the meantime.
+typedef struct Pathfind_Service Pathfind_Service;
+
+Pathfind_Service *pathfind_service_make(Level_Geometry *level);
+void pathfind_service_free(Pathfind_Service *service);
+
+Pathfind_Ticket pathfind_service_request(Pathfind_Service *service, Floor_Position start, Vector2 end, Pathfind_Profile profile);
+// For a request answered without searching, e.g. out of the path cache.
+// Takes ownership of `path`, which holds for the level's current version.
+Pathfind_Ticket pathfind_service_request_done(Pathfind_Service *service, Pathfind_Status status, Vec_Vector2 path);
+// Hands over the path once it's been found at the level's current version,
+// putting it in `level->path_cache` on the way.
+// Unknown tickets, including ones that were already collected or
+// cancelled, are `Pathfind_Status_NOT_FOUND`.
+Pathfind_Status pathfind_service_poll(Pathfind_Service *service, Pathfind_Ticket ticket, Vec_Vector2 *path);
+void pathfind_service_cancel(Pathfind_Service *service, Pathfind_Ticket ticket);
+
+// Around anything that changes the level while the service is running.
+void pathfind_service_lock_level(Pathfind_Service *service);
+void pathfind_service_unlock_level(Pathfind_Service *service);
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <raymath.h>
 
+#include "collisions.h"
 #include "input.h"
 #include "level_geometry.h"
 #include "utils.h"
@@ -27,6 +28,18 @@ void player_poll_input(Input *input) {
     }
 }
 
+Player player_spawn(Level_Geometry *level, Vector2 position, Inventory *inventory) {
+    Floor_Position floor_position;
+    bool on_floor = level_snap_to_floor(level, position, LEVEL_FLOOR_SNAP_TOLERANCE, &floor_position);
+    assert(on_floor && "player has to start on a floor");
+
+    return (Player){
+        .floor_position = floor_position,
+        .position = level_floor_position_point(level, floor_position),
+        .inventory = inventory
+    };
+}
+
 void player_update_movement(Player *player, Input *input, Level_Geometry *level) {
     if (is_flags_set(player->flags, Player_Flags_FALLING)) {
         float normalized_falling_time = fminf(
@@ -35,41 +48,40 @@ void player_update_movement(Player *player, Input *input, Level_Geometry *level)
         );
         float desired_falling_speed = PLAYER_MAX_FALL_SPEED * ease_in_expo(normalized_falling_time);
         float clamped_falling_speed = fminf(desired_falling_speed, PLAYER_MAX_FALL_SPEED);
-        player->position.y += clamped_falling_speed * input->delta_time;
 
-        if (player->position.y >= player->falling_position.y) {
+        if (level_floor_fall(level, &player->floor_position, clamped_falling_speed * input->delta_time)) {
             unset_flags(&player->flags, Player_Flags_FALLING);
-            player->position = player->falling_position;
-            player->current_floor = player->falling_floor;
         }
     } else {
         player->velocity = lerp(player->velocity, input->player_movement.x, PLAYER_ACCELERATION * input->delta_time);
-        player->position.x += player->velocity * PLAYER_SPEED * input->delta_time;
 
-        Floor_Movement movement = calculate_floor_movement(
+        Floor_Step step =
+            input->player_movement.y < 0.f ? Floor_Step_UP :
+            input->player_movement.y > 0.f ? Floor_Step_DOWN :
+            Floor_Step_AHEAD;
+
+        Floor_Movement movement = level_floor_walk(
             level,
-            player->position,
-            player->current_floor,
-            vec2(player->velocity, input->player_movement.y)
+            player->floor_position,
+            player->velocity * PLAYER_SPEED * input->delta_time,
+            step
         );
 
+        player->floor_position = movement.position;
         if (movement.falling) {
             set_flags(&player->flags, Player_Flags_FALLING);
-            player->position.x = movement.desired_position.x;
             player->velocity = 0.f;
-            player->falling_position = movement.desired_position;
-            player->falling_floor = movement.new_floor;
             player->start_falling_time = GetTime();
-        } else {
-            player->position = movement.desired_position;
-            player->current_floor = movement.new_floor;
         }
     }
+
+    player->position = level_floor_position_point(level, player->floor_position);
 }
 
 void player_update_aiming(
     Player *player,
     Input *input,
+    Level_Geometry *level_geometry,
     Level_Interactables *level,
     size_t num_enemies,
     Enemy *enemies)
@@ -83,6 +95,11 @@ void player_update_aiming(
     }
 
     if (is_flags_set(input->flags, Input_Flags_AIMING)) {
+        Vector2 origin = Vector2Add(player->position, PLAYER_BULLET_ORIGIN_OFFSET);
+        if (!level_line_of_sight(level_geometry, origin, input->mouse_world_position)) {
+            return;
+        }
+
         for (size_t i = 0; i < num_enemies; ++i) {
             Enemy *e = &enemies[i];
             
@@ -17,6 +17,7 @@
 #define PLAYER_ACCELERATION 5.f
 #define PLAYER_MAX_FALL_SPEED 800.f
 #define PLAYER_TIME_TO_MAX_FALL_SPEED 0.25f
+#define PLAYER_BULLET_ORIGIN_OFFSET (Vector2){ .x = 0, .y = -(PLAYER_HEIGHT * 0.65f) }
 
 #define MAX_PICKUP_DISTANCE 200.f
 
@@ -27,18 +28,19 @@ typedef enum {
 
 typedef struct {
     Player_Flags flags;
-    Vector2 position;
+    Floor_Position floor_position; // on a fall while falling
+    Vector2 position;              // worked out from `floor_position` after moving
     float velocity;
-    Floor current_floor;
-    Vector2 falling_position;
-    Floor falling_floor;
     double start_falling_time;
     Inventory *inventory;
 } Player;
 
+// `position` is snapped onto the nearest floor.
+Player player_spawn(Level_Geometry *level, Vector2 position, Inventory *inventory);
+
 void player_poll_input(Input *input);
 void player_update_movement(Player *player, Input *input, Level_Geometry *level);
-void player_update_aiming(Player *player, Input *input, Level_Interactables* level, size_t num_enemies, Enemy *enemies);
+void player_update_aiming(Player *player, Input *input, Level_Geometry *level_geometry, Level_Interactables* level, size_t num_enemies, Enemy *enemies);
 void player_draw(Player *player, Drawer *drawer);
 
 #endif